@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Run the directory workloads in bin/bench_dir at increasing directory sizes
+# and emit CSV on stdout.
+#
+# Usage: bench_dir.sh [ENTRIES...]
+
+# Constants
+
+ENTRIES=${@:-1000 10000 100000}
+
+# Main execution
+
+echo "workload,entries,seconds,block_reads,reads_per_entry,directory_blocks"
+for entries in $ENTRIES; do
+    ./bin/bench_dir $entries | awk '
+    	$1 == "result" {
+    	    printf "%s,%d,%.6f,%d,%.2f,%d\n", $2, $3, $4, $5, $5 / $3, $6
+    	}'
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
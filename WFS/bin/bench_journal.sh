@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Run the synchronous workloads in bin/bench_journal with and without the
+# journal at increasing file counts and emit CSV on stdout.
+#
+# Usage: bench_journal.sh [FILES...]
+
+# Constants
+
+FILES=${@:-1000 5000}
+
+# Main execution
+
+echo "mode,workload,files,seconds,block_writes,write_calls,calls_per_file"
+for files in $FILES; do
+    ./bin/bench_journal $files | awk '
+    	$1 == "result" {
+    	    printf "%s,%s,%d,%.6f,%d,%d,%.2f\n", $2, $3, $4, $5, $6, $7, $7 / $4
+    	}'
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Run the multithreaded workloads in bin/bench_mt at 1..N threads and emit CSV
+# on stdout.
+#
+# Usage: bench_mt.sh [MAX_THREADS]
+
+# Constants
+
+WORKLOADS="read shared-read write"
+MAX_THREADS=${1:-$(nproc)}
+
+# Functions
+
+thread-counts() {
+    threads=1
+    while [ $threads -lt $MAX_THREADS ]; do
+    	echo $threads
+    	threads=$((threads * 2))
+    done
+    echo $MAX_THREADS
+}
+
+# Main execution
+
+echo "workload,threads,bytes,seconds,mb_per_sec,efficiency"
+for workload in $WORKLOADS; do
+    baseline=""
+    for threads in $(thread-counts | sort -nu); do
+    	row=$(./bin/bench_mt $workload $threads | awk -v baseline="$baseline" '
+    	    $1 == "result" { workload = $2; threads = $3; bytes = $4; seconds = $5 }
+    	    END {
+    	    	rate = seconds > 0 ? bytes / seconds / 1e6 : 0
+    	    	if (baseline == "") baseline = rate
+    	    	efficiency = baseline > 0 ? rate / (threads * baseline) : 0
+    	    	printf "%s,%d,%d,%.6f,%.0f,%.3f\n", workload, threads, bytes, seconds, rate, efficiency
+    	    }')
+    	echo "$row"
+    	if [ -z "$baseline" ]; then
+    	    baseline=$(echo "$row" | cut -d , -f 5)
+    	fi
+    done
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
@@ -0,0 +1,62 @@
+/* cache.h: SimpleFS block buffer cache */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "sfs/disk.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Cache Constants */
+
+#define CACHE_BLOCKS        (64)                /* Default number of cached blocks */
+#define CACHE_MIN_BLOCKS    (4)                 /* Minimum number of cached blocks */
+#define CACHE_BLOCKS_ENV    "SFS_CACHE_BLOCKS"  /* Override number of cached blocks */
+
+/* Cache Structures */
+
+typedef struct CacheEntry CacheEntry;
+struct CacheEntry {
+    size_t      block;                          /* Block number of cached data */
+    size_t      pins;                           /* Number of outstanding pins */
+    bool        dirty;                          /* Whether data must be written back */
+    CacheEntry *chain;                          /* Next entry in hash bucket */
+    CacheEntry *prev;                           /* Previous (more recently used) entry */
+    CacheEntry *next;                           /* Next (less recently used) entry */
+    char        data[BLOCK_SIZE];               /* Cached block data */
+};
+
+typedef struct Cache Cache;
+struct Cache {
+    size_t      capacity;                       /* Maximum number of entries */
+    size_t      count;                          /* Number of entries in use */
+    size_t      dirty;                          /* Number of dirty entries */
+    size_t      hits;                           /* Number of lookups found in cache */
+    size_t      misses;                         /* Number of lookups not in cache */
+    size_t      nbuckets;                       /* Number of hash buckets (power of two) */
+    CacheEntry **buckets;                       /* Hash table of entries by block number */
+    CacheEntry *entries;                        /* Storage for all entries */
+    CacheEntry *unused;                         /* Stack of unused entries (linked by chain) */
+    CacheEntry  lru;                            /* LRU list sentinel (next is most recent) */
+};
+
+/* Cache Functions */
+
+Cache *	    cache_create(size_t capacity);
+void	    cache_delete(Cache *cache);
+
+CacheEntry *cache_find(Cache *cache, size_t block);
+CacheEntry *cache_lookup(Cache *cache, size_t block);
+CacheEntry *cache_insert(Cache *cache, size_t block);
+void        cache_remove(Cache *cache, size_t block);
+
+void        cache_pin(CacheEntry *entry);
+void        cache_unpin(CacheEntry *entry);
+
+void        cache_dirty(Cache *cache, CacheEntry *entry);
+void        cache_clean(Cache *cache, CacheEntry *entry);
+
+#endif
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -3,6 +3,9 @@
 #ifndef DISK_H
 #define DISK_H
 
+#include "sfs/uring.h"
+
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -10,6 +13,16 @@
 
 #define BLOCK_SIZE      (1<<12)
 #define DISK_FAILURE    (-1)
+#define DISK_IOV_BLOCKS (256)   /* Maximum number of blocks per vectored I/O call */
+#define DISK_BACKEND_ENV "SFS_DISK_BACKEND" /* Select backend ("fd", "mmap", or "uring") */
+
+/* Disk Backends */
+
+typedef enum {
+    DISK_FD,                    /* Positional I/O through the block cache */
+    DISK_MMAP,                  /* Blocks accessed in place in mapped image */
+    DISK_URING,                 /* DISK_FD with asynchronous batches on io_uring */
+} DiskBackend;
 
 /* Disk Structure */
 
@@ -20,16 +33,47 @@ struct Disk {
     size_t  blocks;     /* Number of blocks in disk image	*/
     size_t  reads;      /* Number of reads to disk image	*/
     size_t  writes;     /* Number of writes to disk image	*/
+    struct Cache *cache;/* Block buffer cache			*/
+    size_t  readahead_hits;  /* Number of prefetched blocks read	*/
+    size_t  readahead_waste; /* Number of prefetched blocks unused	*/
+    pthread_mutex_t lock;    /* Protects cache (I/O is positional)	*/
+    char   *map;        /* Mapped image (DISK_MMAP only)	*/
+    Uring  *uring;      /* Asynchronous I/O queue (DISK_URING only) */
 }; 
 
+/* Disk Request Structure */
+
+typedef struct DiskRequest DiskRequest;
+
+struct DiskRequest {
+    size_t  block;      /* First block to read			*/
+    size_t  count;      /* Number of blocks to read		*/
+    char   *data;       /* Buffer for count blocks		*/
+    UringRequest io;    /* Asynchronous request state		*/
+};
+
 /* Disk Functions */
 
 Disk *	disk_open(const char *path, size_t blocks);
+Disk *	disk_open_backend(const char *path, size_t blocks, DiskBackend backend);
 void	disk_close(Disk *disk);
 
 ssize_t	disk_read(Disk *disk, size_t block, char *data);
 ssize_t	disk_write(Disk *disk, size_t block, char *data);
 
+ssize_t disk_readv(Disk *disk, size_t block, char **data, size_t count);
+ssize_t disk_writev(Disk *disk, size_t block, char **data, size_t count);
+
+bool    disk_sync(Disk *disk);
+
+char *  disk_pin(Disk *disk, size_t block);
+void    disk_unpin(Disk *disk, char *data);
+
+const char *disk_map(Disk *disk, size_t block, size_t count);
+
+bool    disk_read_async(Disk *disk, DiskRequest *requests, size_t count);
+ssize_t disk_wait(Disk *disk, DiskRequest *request);
+
 #endif
 
 /* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
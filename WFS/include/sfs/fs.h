@@ -5,6 +5,7 @@
 
 #include "sfs/disk.h"
 
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -12,9 +13,36 @@
 /* File System Constants */
 
 #define MAGIC_NUMBER        (0xf0f03410)
+#define FS_VERSION_POINTERS (1)                 /* Inodes map blocks with direct and indirect pointers */
+#define FS_VERSION_EXTENTS  (2)                 /* Inodes map blocks with extents */
+#define FS_VERSION_JOURNAL  (3)                 /* FS_VERSION_EXTENTS with metadata journal */
 #define INODES_PER_BLOCK    (128)               /* Number of inodes per block */
 #define POINTERS_PER_INODE  (5)                 /* Number of direct pointers per inode */
 #define POINTERS_PER_BLOCK  (1024)              /* Number of pointers per block */
+#define EXTENTS_PER_INODE   (2)                 /* Number of extents per inode */
+#define EXTENTS_PER_BLOCK   (512)               /* Number of extents per spill block */
+#define WORDS_PER_BLOCK     (BLOCK_SIZE / 8)    /* Number of bitmap words per block */
+#define BITS_PER_WORD       (64)                /* Number of blocks tracked per bitmap word */
+#define BITS_PER_BLOCK      (BLOCK_SIZE * 8)    /* Number of blocks tracked per bitmap block */
+#define READAHEAD_MIN       (4)                 /* Initial readahead window in blocks (16 KB) */
+#define READAHEAD_MAX       (512)               /* Maximum readahead window in blocks (2 MB) */
+#define PREALLOC_BLOCKS     (64)                /* Blocks reserved past the end of a growing file */
+#define GOAL_SEARCH_RUNS    (64)                /* Free runs examined for a goal allocation */
+#define FS_INODE_LOCKS      (64)                /* Number of reader/writer locks inodes are striped over */
+#define OPEN_WRITTEN        (1U << 31)          /* Open count flag: a File handle wrote to the inode */
+#define JOURNAL_MAGIC       (0x4a4e4c53)        /* Journal transaction header magic number */
+#define JOURNAL_TAGS        (BLOCK_SIZE / 4 - 4)    /* Number of block tags per transaction header */
+#define JOURNAL_MIN_BLOCKS  (16)                /* Smallest journal (disks too small get none) */
+#define JOURNAL_MAX_BLOCKS  (1024)              /* Largest journal in blocks (4 MB) */
+#define JOURNAL_BATCH       (128)               /* Logged blocks that trigger a group commit */
+#define JOURNAL_INODE_CREDITS (2)               /* Blocks logged writing back an inode (inode table and spill blocks) */
+#define JOURNAL_DIR_CREDITS (7)                 /* Blocks logged adding a directory entry (leaves, index blocks, root, and inode) */
+#define INODE_FILE          (1)                 /* Inode is a regular file */
+#define INODE_DIRECTORY     (2)                 /* Inode is a directory */
+#define DIR_MAGIC           (0x44495258)        /* Directory index block magic number */
+#define DIR_NAME_MAX        (55)                /* Size of directory entry name (including NUL) */
+#define DIR_ENTRIES         (BLOCK_SIZE / 64)   /* Number of entries per directory leaf block */
+#define DIR_CHILDREN        (BLOCK_SIZE / 8 - 2)    /* Number of children per directory index block */
 
 /* File System Structures */
 
@@ -24,14 +52,67 @@ struct SuperBlock {
     uint32_t    blocks;                         /* Number of blocks in file system */
     uint32_t    inode_blocks;                   /* Number of blocks reserved for inodes */
     uint32_t    inodes;                         /* Number of inodes in file system */
+    uint32_t    bitmap_blocks;                  /* Number of blocks reserved for free block bitmap (at end of disk) */
+    uint32_t    clean;                          /* Whether file system was cleanly unmounted (bitmap is valid) */
+    uint32_t    version;                        /* On-disk format version (0 is FS_VERSION_POINTERS) */
+    uint32_t    journal_blocks;                 /* Number of blocks reserved for journal (before bitmap) */
+    uint32_t    journal_sequence;               /* Sequence number of first transaction to replay */
+    uint32_t    root;                           /* Root directory inode number plus one (0 until created) */
+};
+
+typedef struct Extent     Extent;
+struct Extent {
+    uint32_t    start;                          /* First block of extent */
+    uint32_t    length;                         /* Number of blocks in extent */
 };
 
 typedef struct Inode      Inode;
 struct Inode {
-    uint32_t    valid;                          /* Whether or not inode is valid */
+    uint32_t    valid;                          /* Whether or not inode is valid (INODE_FILE or INODE_DIRECTORY) */
     uint32_t    size;                           /* Size of file */
-    uint32_t    direct[POINTERS_PER_INODE];     /* Direct pointers */
-    uint32_t    indirect;                       /* Indirect pointers */
+    union {
+        struct {                                /* FS_VERSION_POINTERS */
+            uint32_t    direct[POINTERS_PER_INODE]; /* Direct pointers */
+            uint32_t    indirect;               /* Indirect pointers */
+        };
+        struct {                                /* FS_VERSION_EXTENTS */
+            Extent      extents[EXTENTS_PER_INODE]; /* Extents (in file order) */
+            uint32_t    nextents;               /* Number of extents (including spill block) */
+            uint32_t    spill;                  /* Spill block with remaining extents */
+        };
+    };
+};
+
+typedef struct JournalHeader JournalHeader;
+struct JournalHeader {
+    uint32_t    magic;                          /* JOURNAL_MAGIC */
+    uint32_t    sequence;                       /* Transaction sequence number */
+    uint32_t    count;                          /* Number of logged blocks following header */
+    uint32_t    checksum;                       /* Checksum of sequence, tags, and logged blocks */
+    uint32_t    tags[JOURNAL_TAGS];             /* Home block of each logged block */
+};
+
+typedef struct DirEntry DirEntry;
+struct DirEntry {
+    uint32_t    inode;                          /* Inode number */
+    uint32_t    hash;                           /* Hash of name */
+    uint8_t     type;                           /* INODE_FILE or INODE_DIRECTORY (0 if entry is free) */
+    char        name[DIR_NAME_MAX];             /* Name (NUL terminated) */
+};
+
+typedef struct DirChild DirChild;
+struct DirChild {
+    uint32_t    hash;                           /* Lowest name hash stored under child */
+    uint32_t    block;                          /* Logical block of child (index or leaf block) */
+};
+
+typedef struct DirIndex DirIndex;
+struct DirIndex {
+    uint32_t    magic;                          /* DIR_MAGIC */
+    uint32_t    levels;                         /* Index block levels below root (root only, 0 or 1) */
+    uint32_t    count;                          /* Number of children (sorted by hash) */
+    uint32_t    entries;                        /* Number of names in directory (root only) */
+    DirChild    children[DIR_CHILDREN];         /* Children covering consecutive hash ranges */
 };
 
 typedef union  Block      Block;
@@ -39,14 +120,72 @@ union Block {
     SuperBlock  super;                          /* View block as superblock */
     Inode       inodes[INODES_PER_BLOCK];       /* View block as inode */
     uint32_t    pointers[POINTERS_PER_BLOCK];   /* View block as pointers */
+    uint64_t    bitmap[WORDS_PER_BLOCK];        /* View block as free block bitmap */
+    Extent      extents[EXTENTS_PER_BLOCK];     /* View block as extents */
+    JournalHeader journal;                      /* View block as journal transaction header */
+    DirEntry    dirents[DIR_ENTRIES];           /* View block as directory leaf */
+    DirIndex    index;                          /* View block as directory index */
     char        data[BLOCK_SIZE];               /* View block as data */
 };
 
 typedef struct FileSystem FileSystem;
 struct FileSystem {
     Disk        *disk;                          /* Disk file system is mounted on */
-    bool        *free_blocks;                   /* Free block bitmap */
+    uint64_t    *free_blocks;                   /* Free block bitmap (set bit means free) */
+    size_t       free_words;                    /* Number of words in free block bitmap */
+    size_t       free_hint;                     /* No free blocks before this bitmap word */
     SuperBlock   meta_data;                     /* File system meta data */
+    pthread_mutex_t  alloc_lock;                /* Protects free block bitmap and hint */
+    pthread_mutex_t  table_lock;                /* Protects updates to inode table blocks and inode hint */
+    pthread_rwlock_t inode_locks[FS_INODE_LOCKS];   /* Inode reader/writer locks (by inode number) */
+    pthread_rwlock_t dir_lock;                  /* Protects directory contents (taken before inode locks) */
+    size_t       inode_hint;                    /* No free inodes before this inode block */
+    uint32_t    *open_counts;                   /* Number of File handles open on each inode (and OPEN_WRITTEN) */
+    pthread_mutex_t  journal_lock;              /* Protects running transaction and journal head */
+    pthread_cond_t   journal_idle;              /* Signalled when no operation is running in the transaction */
+    Block       *journal;                       /* Running transaction (header followed by logged blocks) */
+    size_t       journal_count;                 /* Number of blocks logged by running transaction */
+    size_t       journal_capacity;              /* Number of logged blocks transaction buffer holds */
+    size_t       journal_handles;               /* Number of operations running in the transaction */
+    size_t       journal_reserved;              /* Blocks reserved by operations since none was running */
+    size_t       journal_waiting;               /* Number of threads waiting to commit the transaction */
+    size_t       journal_head;                  /* Next unused block in journal */
+    uint32_t     journal_sequence;              /* Sequence number of running transaction */
+    Extent      *journal_freed;                 /* Runs of blocks freed by running transaction (released on commit) */
+    size_t       journal_nfreed;                /* Number of runs freed by running transaction */
+    size_t       journal_freed_max;             /* Number of runs freed array holds */
+    Extent      *journal_revoked;               /* Logged blocks freed since last checkpoint */
+    size_t       journal_nrevoked;              /* Number of logged runs freed since last checkpoint */
+    size_t       journal_nretired;              /* Number of those runs freed by committed transactions */
+    size_t       journal_revoked_max;           /* Number of runs revoked array holds */
+    size_t       journal_commits;               /* Number of transactions committed */
+};
+
+typedef struct File File;
+struct File {
+    FileSystem  *fs;                            /* File system file belongs to */
+    size_t       inode_number;                  /* Inode number of file */
+    Inode        inode;                         /* Cached inode */
+    Block        spill;                         /* Cached indirect (or extent spill) block */
+    bool         inode_dirty;                   /* Whether inode must be written back */
+    bool         spill_dirty;                   /* Whether indirect (or spill) block must be written back */
+    Extent      *map;                           /* Logical to physical block map (runs starting at 0 are holes) */
+    size_t       nmap;                          /* Number of runs in block map */
+    size_t       cursor;                        /* Index of last run used in block map */
+    size_t       cursor_block;                  /* Logical block at start of cursor run */
+    size_t       ra_next;                       /* Offset expected for next sequential read */
+    size_t       ra_window;                     /* Readahead window in blocks (0 for random access) */
+    char        *ra_data;                       /* Readahead buffer */
+    size_t       ra_start;                      /* Logical block at start of readahead buffer */
+    size_t       ra_count;                      /* Number of blocks in readahead buffer */
+    size_t       ra_used;                       /* Number of readahead blocks copied out */
+    char        *ra_async;                      /* Buffer for asynchronous readahead of next window */
+    DiskRequest *ra_requests;                   /* Reads filling asynchronous readahead buffer */
+    size_t       ra_nrequests;                  /* Number of reads filling asynchronous readahead buffer */
+    size_t       ra_async_start;                /* Logical block at start of asynchronous readahead buffer */
+    size_t       ra_async_count;                /* Number of blocks in asynchronous readahead buffer */
+    size_t       prealloc_start;                /* First block reserved for file growth */
+    size_t       prealloc_count;                /* Number of blocks reserved for file growth */
 };
 
 /* File System Functions */
@@ -56,14 +195,27 @@ bool    fs_format(FileSystem *fs, Disk *disk);
 
 bool    fs_mount(FileSystem *fs, Disk *disk);
 void    fs_unmount(FileSystem *fs);
+bool    fs_sync(FileSystem *fs);
 
 ssize_t fs_create(FileSystem *fs);
 bool    fs_remove(FileSystem *fs, size_t inode_number);
 ssize_t fs_stat(FileSystem *fs, size_t inode_number);
+bool    fs_is_free_block(FileSystem *fs, size_t block);
 
 ssize_t fs_read(FileSystem *fs, size_t inode_number, char *data, size_t length, size_t offset);
 ssize_t fs_write(FileSystem *fs, size_t inode_number, char *data, size_t length, size_t offset);
 
+File *  fs_open(FileSystem *fs, size_t inode_number);
+bool    fs_close(File *file);
+ssize_t fs_file_read(File *file, char *data, size_t length, size_t offset);
+ssize_t fs_file_write(File *file, char *data, size_t length, size_t offset);
+
+ssize_t fs_lookup(FileSystem *fs, const char *path);
+ssize_t fs_mkdir(FileSystem *fs, const char *path);
+ssize_t fs_create_path(FileSystem *fs, const char *path);
+bool    fs_unlink(FileSystem *fs, const char *path);
+DirEntry *fs_readdir(FileSystem *fs, const char *path, size_t *count);
+
 #endif
 
 /* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
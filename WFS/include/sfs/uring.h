@@ -0,0 +1,74 @@
+/* uring.h: SimpleFS asynchronous I/O queue (io_uring) */
+
+#ifndef URING_H
+#define URING_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/* Uring Constants */
+
+#define URING_DEPTH         (32)                /* Default queue depth */
+#define URING_MAX_DEPTH     (4096)              /* Maximum queue depth */
+#define URING_DEPTH_ENV     "SFS_URING_DEPTH"   /* Override queue depth (0 disables io_uring) */
+
+/* Uring Structures */
+
+typedef struct UringRequest UringRequest;
+typedef void (*UringCallback)(UringRequest *request);
+
+struct UringRequest {
+    struct iovec   *iov;                        /* Buffers (advanced past data already transferred) */
+    size_t          niov;                       /* Number of buffers left to transfer */
+    off_t           offset;                     /* File offset of next byte to transfer */
+    bool            write;                      /* Whether to write (otherwise read) buffers */
+    UringCallback   callback;                   /* Called on completion (may be NULL) */
+    void           *arg;                        /* Argument for callback */
+    struct iovec    vec;                        /* Storage for single buffer requests */
+    ssize_t         result;                     /* Bytes transferred (-1 on failure) */
+    bool            complete;                   /* Whether request has completed */
+};
+
+typedef struct Uring Uring;
+struct Uring {
+    int             fd;                         /* io_uring file descriptor */
+    int             target;                     /* File descriptor requests are performed on */
+    size_t          depth;                      /* Maximum number of requests in flight */
+    size_t          inflight;                   /* Number of requests queued or in flight */
+    size_t          queued;                     /* Number of requests not yet passed to kernel */
+    size_t          enters;                     /* Number of io_uring_enter calls */
+    size_t          completions;                /* Number of completions reaped */
+    bool            waiting;                    /* Whether a thread is blocked in the kernel */
+    unsigned       *sq_head;                    /* Submission queue head (consumed by kernel) */
+    unsigned       *sq_tail;                    /* Submission queue tail */
+    unsigned       *sq_mask;                    /* Submission queue index mask */
+    unsigned       *sq_array;                   /* Submission queue entry indices */
+    unsigned       *cq_head;                    /* Completion queue head */
+    unsigned       *cq_tail;                    /* Completion queue tail (produced by kernel) */
+    unsigned       *cq_mask;                    /* Completion queue index mask */
+    struct io_uring_sqe *sqes;                  /* Submission queue entries */
+    struct io_uring_cqe *cqes;                  /* Completion queue entries */
+    void           *sq_ring;                    /* Mapped submission queue ring */
+    void           *cq_ring;                    /* Mapped completion queue ring */
+    size_t          sq_size;                    /* Size of mapped submission queue ring */
+    size_t          cq_size;                    /* Size of mapped completion queue ring */
+    size_t          sqes_size;                  /* Size of mapped submission queue entries */
+    pthread_mutex_t lock;                       /* Protects queues and counters */
+    pthread_cond_t  cond;                       /* Signalled when completions are reaped */
+};
+
+/* Uring Functions */
+
+Uring *     uring_create(int target, size_t depth);
+void        uring_delete(Uring *ring);
+
+bool        uring_queue(Uring *ring, UringRequest *request);
+bool        uring_submit(Uring *ring);
+ssize_t     uring_wait(Uring *ring, UringRequest *request);
+
+#endif
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
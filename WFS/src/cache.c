@@ -0,0 +1,276 @@
+/* cache.c: SimpleFS block buffer cache */
+
+#include "sfs/cache.h"
+#include "sfs/logging.h"
+#include "sfs/utils.h"
+
+#include <string.h>
+
+/* Internal Prototyes */
+
+CacheEntry **cache_bucket(Cache *cache, size_t block);
+void        cache_unlink(Cache *cache, CacheEntry *entry);
+void        cache_push(Cache *cache, CacheEntry *entry);
+
+/* External Functions */
+
+/**
+ * Create block buffer cache by doing the following:
+ *
+ *  1. Allocate Cache structure and storage for all of its entries.
+ *
+ *  2. Allocate hash table with at least twice as many buckets as entries.
+ *
+ *  3. Initialize empty LRU list and stack of unused entries.
+ *
+ * @param       capacity    Maximum number of blocks to cache.
+ *
+ * @return      Pointer to newly allocated Cache structure (NULL on failure).
+ **/
+Cache *	cache_create(size_t capacity) {
+
+    // allocate cache structure and entries
+    Cache *cache = calloc(1, sizeof(Cache));
+    if (!cache)
+        return NULL;
+
+    cache->capacity = max(capacity, CACHE_MIN_BLOCKS);
+    cache->entries  = calloc(cache->capacity, sizeof(CacheEntry));
+
+    // allocate hash table
+    cache->nbuckets = 1;
+    while (cache->nbuckets < 2 * cache->capacity)
+        cache->nbuckets <<= 1;
+    cache->buckets  = calloc(cache->nbuckets, sizeof(CacheEntry *));
+
+    if (!cache->entries || !cache->buckets) {
+        cache_delete(cache);
+        return NULL;
+    }
+
+    // initialize lru list and unused entries
+    cache->lru.prev = &cache->lru;
+    cache->lru.next = &cache->lru;
+
+    for (size_t i = 0; i < cache->capacity; i++) {
+        cache->entries[i].chain = cache->unused;
+        cache->unused           = &cache->entries[i];
+    }
+    return cache;
+}
+
+/**
+ * Release block buffer cache and all of its entries.
+ *
+ * @param       cache       Pointer to Cache structure.
+ **/
+void	cache_delete(Cache *cache) {
+    if (!cache)
+        return;
+
+    free(cache->buckets);
+    free(cache->entries);
+    free(cache);
+}
+
+/**
+ * Find specified block in cache (without recording a hit or miss or updating
+ * the LRU list).
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       block       Block number to find.
+ *
+ * @return      Pointer to cached entry (NULL if block is not cached).
+ **/
+CacheEntry *cache_find(Cache *cache, size_t block) {
+    for (CacheEntry *entry = *cache_bucket(cache, block); entry; entry = entry->chain) {
+        if (entry->block == block)
+            return entry;
+    }
+
+    return NULL;
+}
+
+/**
+ * Lookup specified block in cache by doing the following:
+ *
+ *  1. Search hash bucket for entry.
+ *
+ *  2. Move entry to the front of the LRU list and record hit (or record miss).
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       block       Block number to lookup.
+ *
+ * @return      Pointer to cached entry (NULL if block is not cached).
+ **/
+CacheEntry *cache_lookup(Cache *cache, size_t block) {
+    CacheEntry *entry = cache_find(cache, block);
+
+    if (entry) {
+        cache_unlink(cache, entry);
+        cache_push(cache, entry);
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+
+    return entry;
+}
+
+/**
+ * Insert specified block into cache by doing the following:
+ *
+ *  1. Use an unused entry, otherwise evict the least recently used entry that
+ *  is neither pinned nor dirty.
+ *
+ *  2. Add entry to hash bucket and front of LRU list.
+ *
+ * Note: The caller must fill in the data of the returned entry.
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       block       Block number to insert (must not already be cached).
+ *
+ * @return      Pointer to new entry (NULL if every entry is pinned or dirty).
+ **/
+CacheEntry *cache_insert(Cache *cache, size_t block) {
+    if (!cache->unused) {
+        // evict least recently used entry that is not pinned or dirty
+        CacheEntry *victim = cache->lru.prev;
+        while (victim != &cache->lru && (victim->pins || victim->dirty))
+            victim = victim->prev;
+
+        if (victim == &cache->lru)
+            return NULL;
+
+        cache_remove(cache, victim->block);
+    }
+
+    CacheEntry *entry = cache->unused;
+    cache->unused = entry->chain;
+    cache->count++;
+
+    entry->block = block;
+    entry->pins  = 0;
+    entry->dirty = false;
+
+    CacheEntry **bucket = cache_bucket(cache, block);
+    entry->chain = *bucket;
+    *bucket      = entry;
+
+    cache_push(cache, entry);
+    return entry;
+}
+
+/**
+ * Remove specified block from cache (if it is cached and not pinned).
+ *
+ * Note: Any dirty data in the removed entry is discarded.
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       block       Block number to remove.
+ **/
+void        cache_remove(Cache *cache, size_t block) {
+    for (CacheEntry **curr = cache_bucket(cache, block); *curr; curr = &(*curr)->chain) {
+        CacheEntry *entry = *curr;
+        if (entry->block == block) {
+            if (entry->pins)
+                return;
+
+            *curr = entry->chain;
+            cache_unlink(cache, entry);
+            cache_clean(cache, entry);
+
+            entry->chain  = cache->unused;
+            cache->unused = entry;
+            cache->count--;
+            return;
+        }
+    }
+}
+
+/**
+ * Pin cache entry so that it cannot be evicted.
+ *
+ * @param       entry       Pointer to CacheEntry structure.
+ **/
+void        cache_pin(CacheEntry *entry) {
+    entry->pins++;
+}
+
+/**
+ * Unpin cache entry so that it can be evicted once it has no more pins.
+ *
+ * @param       entry       Pointer to CacheEntry structure.
+ **/
+void        cache_unpin(CacheEntry *entry) {
+    if (entry->pins)
+        entry->pins--;
+}
+
+/**
+ * Mark cache entry as dirty so that it is written back before it is evicted.
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       entry       Pointer to CacheEntry structure.
+ **/
+void        cache_dirty(Cache *cache, CacheEntry *entry) {
+    if (!entry->dirty) {
+        entry->dirty = true;
+        cache->dirty++;
+    }
+}
+
+/**
+ * Mark cache entry as clean (ie. its data matches the disk image).
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       entry       Pointer to CacheEntry structure.
+ **/
+void        cache_clean(Cache *cache, CacheEntry *entry) {
+    if (entry->dirty) {
+        entry->dirty = false;
+        cache->dirty--;
+    }
+}
+
+/* Internal Functions */
+
+/**
+ * Return hash bucket for specified block.
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       block       Block number to hash.
+ *
+ * @return      Pointer to head of hash bucket chain.
+ **/
+CacheEntry **cache_bucket(Cache *cache, size_t block) {
+    return &cache->buckets[block & (cache->nbuckets - 1)];
+}
+
+/**
+ * Remove entry from LRU list.
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       entry       Pointer to CacheEntry structure.
+ **/
+void        cache_unlink(Cache *cache, CacheEntry *entry) {
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->prev = entry;
+    entry->next = entry;
+}
+
+/**
+ * Insert entry at the front (most recently used end) of LRU list.
+ *
+ * @param       cache       Pointer to Cache structure.
+ * @param       entry       Pointer to CacheEntry structure.
+ **/
+void        cache_push(Cache *cache, CacheEntry *entry) {
+    entry->prev           = &cache->lru;
+    entry->next           = cache->lru.next;
+    cache->lru.next->prev = entry;
+    cache->lru.next       = entry;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -1,21 +1,63 @@
 /* disk.c: SimpleFS disk emulator */
 
+#include "sfs/cache.h"
 #include "sfs/disk.h"
 #include "sfs/logging.h"
+#include "sfs/utils.h"
 
 #include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 
 /* Internal Prototyes */
 
 bool    disk_sanity_check(Disk *disk, size_t blocknum, const char *data);
+ssize_t disk_read_block(Disk *disk, size_t block, char *data);
+ssize_t disk_write_block(Disk *disk, size_t block, char *data);
+ssize_t disk_io_blocks(Disk *disk, size_t block, char **data, size_t count, bool write);
+ssize_t disk_cached_read(Disk *disk, size_t block, char *data);
+ssize_t disk_cached_write(Disk *disk, size_t block, char *data);
+bool    disk_flush(Disk *disk);
+bool    disk_flush_async(Disk *disk, CacheEntry **dirty, size_t ndirty);
+size_t  disk_dirty_run(CacheEntry **dirty, size_t ndirty, size_t i);
+bool    disk_range_cached(Disk *disk, size_t block, size_t count);
+ssize_t disk_mapped_io(Disk *disk, size_t block, char **data, size_t count, bool write);
+bool    disk_vector_check(Disk *disk, size_t block, char **data, size_t count);
+CacheEntry *disk_cache_insert(Disk *disk, size_t block);
+int     disk_entry_compare(const void *a, const void *b);
 
 /* External Functions */
 
 /**
+ * Opens disk at specified path with the specified number of blocks using the
+ * backend selected by DISK_BACKEND_ENV ("mmap" for DISK_MMAP, "uring" for
+ * DISK_URING, otherwise DISK_FD).
  *
- * Opens disk at specified path with the specified number of blocks by doing
- * the following:
+ * @param       path        Path to disk image to create.
+ * @param       blocks      Number of blocks to allocate for disk image.
+ *
+ * @return      Pointer to newly allocated and configured Disk structure (NULL
+ *              on failure).
+ **/
+Disk *	disk_open(const char *path, size_t blocks) {
+    char       *name    = getenv(DISK_BACKEND_ENV);
+    DiskBackend backend = DISK_FD;
+
+    if (name && strcmp(name, "mmap") == 0)
+        backend = DISK_MMAP;
+    else if (name && strcmp(name, "uring") == 0)
+        backend = DISK_URING;
+
+    return disk_open_backend(path, blocks, backend);
+}
+
+/**
+ *
+ * Opens disk at specified path with the specified number of blocks and
+ * backend by doing the following:
  *
  *  1. Allocate Disk structure and sets appropriate attributes.
  *
@@ -23,13 +65,25 @@ bool    disk_sanity_check(Disk *disk, size_t blocknum, const char *data);
  *
  *  3. Truncate file to desired file size (blocks * BLOCK_SIZE).
  *
+ *  4. For DISK_MMAP, map the whole image (blocks are accessed in place and
+ *  the page cache takes the place of the block cache).
+ *
+ *  5. Otherwise, create block buffer cache (CACHE_BLOCKS_ENV overrides its
+ *  capacity) and the lock protecting it.
+ *
+ *  6. For DISK_URING, create asynchronous I/O queue (URING_DEPTH_ENV
+ *  overrides its depth).  If io_uring is unavailable, the disk falls back to
+ *  synchronous positional I/O (the same as DISK_FD).
+ *
  * @param       path        Path to disk image to create.
  * @param       blocks      Number of blocks to allocate for disk image.
+ * @param       backend     DISK_FD, DISK_MMAP, or DISK_URING.
  *
  * @return      Pointer to newly allocated and configured Disk structure (NULL
  *              on failure).
  **/
-Disk *	disk_open(const char *path, size_t blocks) {
+Disk *	disk_open_backend(const char *path, size_t blocks, DiskBackend backend) {
+
 
     // allocate disk structure
     Disk* d = calloc(1, sizeof(Disk));
@@ -56,6 +110,34 @@ Disk *	disk_open(const char *path, size_t blocks) {
         return NULL;
     }
 
+    // map whole image
+    if (backend == DISK_MMAP) {
+        d->map = mmap(NULL, blocks * BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (d->map == MAP_FAILED) {
+            close(fd);
+            free(d);
+            return NULL;
+        }
+        pthread_mutex_init(&d->lock, NULL);
+        return d;
+    }
+
+    // create block buffer cache
+    char *capacity = getenv(CACHE_BLOCKS_ENV);
+    d->cache = cache_create(capacity ? strtoul(capacity, NULL, 10) : CACHE_BLOCKS);
+    if (!d->cache) {
+        close(fd);
+        free(d);
+        return NULL;
+    }
+    pthread_mutex_init(&d->lock, NULL);
+
+    // create asynchronous i/o queue
+    if (backend == DISK_URING) {
+        char *depth = getenv(URING_DEPTH_ENV);
+        d->uring = uring_create(fd, depth ? strtoul(depth, NULL, 10) : URING_DEPTH);
+    }
+
     return d;
 
 }
@@ -63,24 +145,36 @@ Disk *	disk_open(const char *path, size_t blocks) {
 /**
  * Close disk structure by doing the following:
  *
- *  1. Close disk file descriptor.
+ *  1. Write back dirty blocks (and unmap image or release asynchronous I/O
+ *  queue) and close disk file descriptor.
  *
- *  2. Report number of disk reads and writes.
+ *  2. Report number of disk reads and writes (and cache and readahead
+ *  statistics).
  *
- *  3. Release disk structure memory.
+ *  3. Release cache and disk structure memory.
  *
  * @param       disk        Pointer to Disk structure.
  */
 void	disk_close(Disk *disk) {
 
-    // close disk file descriptor
+    // write back dirty blocks (and unmap image) and close disk file descriptor
+    disk_sync(disk);
+    if (disk->map)
+        munmap(disk->map, disk->blocks * BLOCK_SIZE);
+    uring_delete(disk->uring);
     close(disk->fd);
 
     // report number of disk reads and writes
     printf("%lu disk block reads\n", disk->reads);
     printf("%lu disk block writes\n", disk->writes);
+    printf("%lu disk block cache hits\n", disk->cache ? disk->cache->hits : 0);
+    printf("%lu disk block cache misses\n", disk->cache ? disk->cache->misses : 0);
+    printf("%lu disk block readahead hits\n", disk->readahead_hits);
+    printf("%lu disk block readahead waste\n", disk->readahead_waste);
 
-    // release disk structure memory
+    // release cache and disk structure memory
+    pthread_mutex_destroy(&disk->lock);
+    cache_delete(disk->cache);
     free(disk);
 
 }
@@ -91,9 +185,10 @@ void	disk_close(Disk *disk) {
  *
  *  1. Perform sanity check.
  *
- *  2. Seek to specified block.
+ *  2. Copy block from cache if it is cached.
  *
- *  3. Read from block to data buffer (must be BLOCK_SIZE).
+ *  3. Otherwise, read block from disk image into data buffer (must be
+ *  BLOCK_SIZE), without holding the disk lock, and insert it into the cache.
  *
  * @param       disk        Pointer to Disk structure.
  * @param       block       Block number to perform operation on.
@@ -110,23 +205,14 @@ ssize_t disk_read(Disk *disk, size_t block, char *data) {
         return DISK_FAILURE;
     }
 
-    int fd = disk->fd;
-    
-    // seek to specifed block
-    lseek(fd, (block * BLOCK_SIZE), SEEK_SET);
+    // copy from mapped image
+    if (disk->map)
+        return disk_mapped_io(disk, block, &data, 1, false);
 
-    // read from block to data (must be BLOCK_SIZE)
-    size_t count = read(fd, data, BLOCK_SIZE);
-
-    disk->reads += 1;
-
-    // return number of bytes read
-    if (count == BLOCK_SIZE) {
-        return BLOCK_SIZE;
-    } else {
-
-        return DISK_FAILURE;
-    }
+    pthread_mutex_lock(&disk->lock);
+    ssize_t result = disk_cached_read(disk, block, data);
+    pthread_mutex_unlock(&disk->lock);
+    return result;
 }
 
 /**
@@ -135,9 +221,11 @@ ssize_t disk_read(Disk *disk, size_t block, char *data) {
  *
  *  1. Perform sanity check.
  *
- *  2. Seek to specified block.
+ *  2. Copy data buffer (must be BLOCK_SIZE) into the cached copy of the block
+ *  and mark it dirty (it is written back by disk_sync or cache pressure).
  *
- *  3. Write data buffer (must be BLOCK_SIZE) to disk block.
+ *  3. Otherwise, if every cache entry is pinned, write data buffer directly to
+ *  disk block.
  *
  * @param       disk        Pointer to Disk structure.
  * @param       block       Block number to perform operation on.
@@ -152,27 +240,752 @@ ssize_t disk_write(Disk *disk, size_t block, char *data) {
     if (!disk_sanity_check(disk, block, data))
         return DISK_FAILURE;
 
-    int fd = disk->fd;
+    // copy to mapped image
+    if (disk->map)
+        return disk_mapped_io(disk, block, &data, 1, true);
+
+    pthread_mutex_lock(&disk->lock);
+    ssize_t result = disk_cached_write(disk, block, data);
+    pthread_mutex_unlock(&disk->lock);
+    return result;
+}
+
+/**
+ * Write back all dirty blocks in the cache (or the mapped image with msync).
+ *
+ * @param       disk        Pointer to Disk structure.
+ *
+ * @return      Whether or not all dirty blocks were written (false on failure).
+ **/
+bool    disk_sync(Disk *disk) {
+    if (!disk)
+        return false;
+
+    if (disk->map)
+        return msync(disk->map, disk->blocks * BLOCK_SIZE, MS_SYNC) == 0;
+
+    pthread_mutex_lock(&disk->lock);
+    bool result = disk_flush(disk);
+    pthread_mutex_unlock(&disk->lock);
+    return result;
+}
+
+/**
+ * Read count contiguous blocks starting at specified block into data buffers
+ * by doing the following:
+ *
+ *  1. Perform sanity check.
+ *
+ *  2. Copy each cached block from the cache.
+ *
+ *  3. Read each run of uncached blocks with a single positional vectored read
+ *  (the blocks are not inserted into the cache, and the disk lock is dropped
+ *  during the read so readers of different blocks proceed in parallel).
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       First block number to perform operation on.
+ * @param       data        Array of count data buffers (each BLOCK_SIZE).
+ * @param       count       Number of blocks to read.
+ *
+ * @return      Number of bytes read.
+ *              (count * BLOCK_SIZE on success, DISK_FAILURE on failure).
+ **/
+ssize_t disk_readv(Disk *disk, size_t block, char **data, size_t count) {
+
+    // perform sanity check
+    if (!disk_vector_check(disk, block, data, count))
+        return DISK_FAILURE;
+
+    // copy from mapped image
+    if (disk->map)
+        return disk_mapped_io(disk, block, data, count, false);
+
+    pthread_mutex_lock(&disk->lock);
+    for (size_t i = 0; i < count; ) {
+
+        // copy from cache
+        CacheEntry *entry = cache_lookup(disk->cache, block + i);
+        if (entry) {
+            memcpy(data[i], entry->data, BLOCK_SIZE);
+            i++;
+            continue;
+        }
+
+        // read run of uncached blocks from disk (without holding the lock)
+        size_t n = 1;
+        while (i + n < count && n < DISK_IOV_BLOCKS && !cache_find(disk->cache, block + i + n))
+            n++;
+        disk->cache->misses += n - 1;
+
+        pthread_mutex_unlock(&disk->lock);
+        if (disk_io_blocks(disk, block + i, data + i, n, false) == DISK_FAILURE)
+            return DISK_FAILURE;
+        pthread_mutex_lock(&disk->lock);
+        i += n;
+    }
+    pthread_mutex_unlock(&disk->lock);
+
+    return count * BLOCK_SIZE;
+}
+
+/**
+ * Write count contiguous blocks starting at specified block from data buffers
+ * by doing the following:
+ *
+ *  1. Perform sanity check.
+ *
+ *  2. Write blocks with positional vectored writes (DISK_IOV_BLOCKS at a
+ *  time), bypassing the cache.
+ *
+ *  3. Update any cached copies of the blocks (which are now clean).
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       First block number to perform operation on.
+ * @param       data        Array of count data buffers (each BLOCK_SIZE).
+ * @param       count       Number of blocks to write.
+ *
+ * @return      Number of bytes written.
+ *              (count * BLOCK_SIZE on success, DISK_FAILURE on failure).
+ **/
+ssize_t disk_writev(Disk *disk, size_t block, char **data, size_t count) {
+
+    // perform sanity check
+    if (!disk_vector_check(disk, block, data, count))
+        return DISK_FAILURE;
+
+    // copy to mapped image
+    if (disk->map)
+        return disk_mapped_io(disk, block, data, count, true);
+
+    pthread_mutex_lock(&disk->lock);
+    for (size_t i = 0; i < count; i += DISK_IOV_BLOCKS) {
+        size_t n = min(count - i, DISK_IOV_BLOCKS);
+
+        // write blocks to disk
+        if (disk_io_blocks(disk, block + i, data + i, n, true) == DISK_FAILURE) {
+            pthread_mutex_unlock(&disk->lock);
+            return DISK_FAILURE;
+        }
+
+        // update cached copies
+        for (size_t j = i; j < i + n; j++) {
+            CacheEntry *entry = cache_find(disk->cache, block + j);
+            if (entry) {
+                if (entry->data != data[j])
+                    memcpy(entry->data, data[j], BLOCK_SIZE);
+                cache_clean(disk->cache, entry);
+            }
+        }
+    }
+    pthread_mutex_unlock(&disk->lock);
+
+    return count * BLOCK_SIZE;
+}
+
+/**
+ * Pin specified block in the cache and return its cached data by doing the
+ * following:
+ *
+ *  1. Perform sanity check.
+ *
+ *  2. Lookup block in cache (reading it from disk image on a miss).
+ *
+ *  3. Pin the cache entry so it stays valid until disk_unpin.
+ *
+ * Note: The returned data must not be written to directly; use disk_write.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       Block number to pin.
+ *
+ * @return      Pointer to cached block data (NULL on failure).
+ **/
+char *  disk_pin(Disk *disk, size_t block) {
+
+    // perform sanity check
+    if (!disk_sanity_check(disk, block, "")) 
+        return NULL;
+
+    // return block in mapped image
+    if (disk->map)
+        return disk->map + block * BLOCK_SIZE;
+
+    // lookup block in cache (or read it from disk)
+    pthread_mutex_lock(&disk->lock);
+    CacheEntry *entry = cache_lookup(disk->cache, block);
+    if (!entry) {
+        entry = disk_cache_insert(disk, block);
+        if (entry && disk_read_block(disk, block, entry->data) == DISK_FAILURE) {
+            cache_remove(disk->cache, block);
+            entry = NULL;
+        }
+    }
+
+    // pin cache entry
+    if (entry)
+        cache_pin(entry);
+    pthread_mutex_unlock(&disk->lock);
+    return entry ? entry->data : NULL;
+}
+
+/**
+ * Unpin cached block data previously returned by disk_pin.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       data        Pointer to cached block data.
+ **/
+void    disk_unpin(Disk *disk, char *data) {
+    if (!data || disk->map)
+        return;
+
+    pthread_mutex_lock(&disk->lock);
+    cache_unpin((CacheEntry *)(data - offsetof(CacheEntry, data)));
+    pthread_mutex_unlock(&disk->lock);
+}
+
+/**
+ * Return pointer to count contiguous blocks starting at specified block in the
+ * mapped image (for DISK_MMAP disks).
+ *
+ * Note: The returned data must not be written to directly; use disk_write.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       First block number.
+ * @param       count       Number of blocks.
+ *
+ * @return      Pointer to mapped block data (NULL if the disk is not mapped
+ *              or the blocks are out of range).
+ **/
+const char *disk_map(Disk *disk, size_t block, size_t count) {
+    if (!disk || !disk->map || block >= disk->blocks || count > disk->blocks - block)
+        return NULL;
+
+    __atomic_add_fetch(&disk->reads, count, __ATOMIC_RELAXED);
+    return disk->map + block * BLOCK_SIZE;
+}
+
+/**
+ * Start reading count requests (each a range of contiguous blocks into a
+ * contiguous buffer) by doing the following:
+ *
+ *  1. Perform sanity check on every request.
+ *
+ *  2. Read requests synchronously if the disk has no asynchronous I/O queue
+ *  or any of their blocks are cached (so dirty cached blocks are seen).
+ *
+ *  3. Otherwise, queue requests and submit them to the kernel in one batch.
+ *
+ * Each request's io.callback (if set) is called with io.arg when it
+ * completes, possibly from another thread waiting on the same disk.
+ *
+ * Note: Every request (and its buffer) must stay valid until disk_wait.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       requests    Array of requests (block, count, data, and
+ *                          optionally io.callback and io.arg must be set).
+ * @param       count       Number of requests.
+ *
+ * @return      Whether or not all requests were started (requests that
+ *              failed to start complete with DISK_FAILURE).
+ **/
+bool    disk_read_async(Disk *disk, DiskRequest *requests, size_t count) {
+
+    // perform sanity check
+    if (!disk || !requests)
+        return false;
+
+    for (size_t r = 0; r < count; r++) {
+        DiskRequest *request = &requests[r];
+        if (!request->data || !request->count || request->block >= disk->blocks || request->count > disk->blocks - request->block)
+            return false;
+    }
+
+    bool result = true;
+    for (size_t r = 0; r < count; r++) {
+        DiskRequest  *request = &requests[r];
+        UringRequest *io      = &request->io;
+
+        // read synchronously
+        if (!disk->uring || disk_range_cached(disk, request->block, request->count)) {
+            io->result = request->count * BLOCK_SIZE;
+            for (size_t i = 0; i < request->count; i += DISK_IOV_BLOCKS) {
+                char  *buffers[DISK_IOV_BLOCKS];
+                size_t n = min(request->count - i, DISK_IOV_BLOCKS);
+                for (size_t j = 0; j < n; j++)
+                    buffers[j] = request->data + (i + j) * BLOCK_SIZE;
+
+                if (disk_readv(disk, request->block + i, buffers, n) == DISK_FAILURE) {
+                    io->result = DISK_FAILURE;
+                    break;
+                }
+            }
+
+            io->complete = true;
+            if (io->callback)
+                io->callback(io);
+            continue;
+        }
+
+        // queue asynchronous read
+        io->vec.iov_base = request->data;
+        io->vec.iov_len  = request->count * BLOCK_SIZE;
+        io->iov          = &io->vec;
+        io->niov         = 1;
+        io->offset       = request->block * BLOCK_SIZE;
+        io->write        = false;
+        __atomic_add_fetch(&disk->reads, request->count, __ATOMIC_RELAXED);
+
+        if (!uring_queue(disk->uring, io)) {
+            io->result   = DISK_FAILURE;
+            io->complete = true;
+            result       = false;
+        }
+    }
+
+    // submit queued reads
+    if (disk->uring && !uring_submit(disk->uring))
+        result = false;
+
+    return result;
+}
+
+/**
+ * Wait for request started by disk_read_async to complete.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       request     Pointer to DiskRequest structure.
+ *
+ * @return      Number of bytes read.
+ *              (count * BLOCK_SIZE on success, DISK_FAILURE on failure).
+ **/
+ssize_t disk_wait(Disk *disk, DiskRequest *request) {
+    if (!disk || !request)
+        return DISK_FAILURE;
+
+    ssize_t result = disk->uring ? uring_wait(disk->uring, &request->io) : request->io.result;
+    return result == (ssize_t)(request->count * BLOCK_SIZE) ? result : DISK_FAILURE;
+}
+
+/* Internal Functions */
+
+/**
+ * Read block through the cache (the disk lock must be held):
+ *
+ *  1. Copy block from cache if it is cached.
+ *
+ *  2. Otherwise, read block from disk image into data buffer (dropping the
+ *  disk lock during the read, so readers of different blocks proceed in
+ *  parallel).
+ *
+ *  3. Copy block from cache if another thread cached it in the meantime, or
+ *  else insert it into the cache (if a clean entry can be evicted and no
+ *  block was written while the lock was dropped, so a stale copy is never
+ *  cached).
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       Block number to perform operation on.
+ * @param       data        Data buffer.
+ *
+ * @return      Number of bytes read.
+ *              (BLOCK_SIZE on success, DISK_FAILURE on failure).
+ **/
+ssize_t disk_cached_read(Disk *disk, size_t block, char *data) {
+
+    // copy from cache
+    CacheEntry *entry = cache_lookup(disk->cache, block);
+    if (entry) {
+        memcpy(data, entry->data, BLOCK_SIZE);
+        return BLOCK_SIZE;
+    }
 
-    // seek to specified block
-    off_t off = lseek(fd, (block * BLOCK_SIZE), SEEK_SET);
-    if (off < 0)
+    // read from disk (without holding the lock)
+    size_t writes = __atomic_load_n(&disk->writes, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&disk->lock);
+    ssize_t result = disk_read_block(disk, block, data);
+    pthread_mutex_lock(&disk->lock);
+    if (result == DISK_FAILURE)
         return DISK_FAILURE;
 
+    // copy from cache or insert into cache
+    entry = cache_find(disk->cache, block);
+    if (entry) {
+        memcpy(data, entry->data, BLOCK_SIZE);
+    } else if (__atomic_load_n(&disk->writes, __ATOMIC_RELAXED) == writes && (entry = cache_insert(disk->cache, block))) {
+        memcpy(entry->data, data, BLOCK_SIZE);
+    }
+
+    return BLOCK_SIZE;
+}
+
+/**
+ * Write block through the cache (the disk lock must be held), falling back to
+ * writing directly to the disk image if every cache entry is pinned.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       Block number to perform operation on.
+ * @param       data        Data buffer.
+ *
+ * @return      Number of bytes written.
+ *              (BLOCK_SIZE on success, DISK_FAILURE on failure).
+ **/
+ssize_t disk_cached_write(Disk *disk, size_t block, char *data) {
+
+    // update cached copy and mark it dirty
+    CacheEntry *entry = cache_find(disk->cache, block);
+    if (!entry)
+        entry = disk_cache_insert(disk, block);
+
+    if (entry) {
+        if (entry->data != data)
+            memcpy(entry->data, data, BLOCK_SIZE);
+        cache_dirty(disk->cache, entry);
+        return BLOCK_SIZE;
+    }
+
     // write data buffer to disk block
-    size_t count = write(fd, data, BLOCK_SIZE);
+    return disk_write_block(disk, block, data);
+}
+
+/**
+ * Write back all dirty blocks in the cache (the disk lock must be held) by
+ * doing the following:
+ *
+ *  1. Collect dirty cache entries and sort them by block number.
+ *
+ *  2. Write each run of contiguous dirty blocks to the disk image (all at
+ *  once with the asynchronous I/O queue, if any) and mark them clean.
+ *
+ * @param       disk        Pointer to Disk structure.
+ *
+ * @return      Whether or not all dirty blocks were written (false on failure).
+ **/
+bool    disk_flush(Disk *disk) {
+    Cache *cache = disk->cache;
+    if (!cache->dirty)
+        return true;
+
+    // collect dirty entries in block order
+    CacheEntry **dirty = calloc(cache->dirty, sizeof(CacheEntry *));
+    if (!dirty)
+        return false;
+
+    size_t ndirty = 0;
+    for (size_t i = 0; i < cache->capacity; i++) {
+        if (cache->entries[i].dirty)
+            dirty[ndirty++] = &cache->entries[i];
+    }
+    qsort(dirty, ndirty, sizeof(CacheEntry *), disk_entry_compare);
+
+    if (disk->uring) {
+        bool result = disk_flush_async(disk, dirty, ndirty);
+        free(dirty);
+        return result;
+    }
+
+    // write back dirty blocks (a run of contiguous blocks at a time)
+    bool result = true;
+    for (size_t i = 0; i < ndirty; ) {
+        char  *data[DISK_IOV_BLOCKS];
+        size_t n = disk_dirty_run(dirty, ndirty, i);
+        for (size_t j = 0; j < n; j++)
+            data[j] = dirty[i + j]->data;
+
+        if (disk_io_blocks(disk, dirty[i]->block, data, n, true) == DISK_FAILURE) {
+            result = false;
+        } else {
+            for (size_t j = 0; j < n; j++)
+                cache_clean(cache, dirty[i + j]);
+        }
+        i += n;
+    }
+
+    free(dirty);
+    return result;
+}
+
+/**
+ * Write back dirty cache entries on the asynchronous I/O queue (the disk
+ * lock must be held) by doing the following:
+ *
+ *  1. Queue a vectored write for each run of contiguous dirty blocks (at most
+ *  the queue depth are in flight at once) and submit them.
+ *
+ *  2. Wait for each write and mark its blocks clean.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       dirty       Dirty cache entries sorted by block number.
+ * @param       ndirty      Number of dirty cache entries.
+ *
+ * @return      Whether or not all dirty blocks were written (false on failure).
+ **/
+bool    disk_flush_async(Disk *disk, CacheEntry **dirty, size_t ndirty) {
+    struct iovec *iov      = calloc(ndirty, sizeof(struct iovec));
+    UringRequest *requests = calloc(ndirty, sizeof(UringRequest));
+    if (!iov || !requests) {
+        free(iov);
+        free(requests);
+        return false;
+    }
+
+    // queue write for each run of contiguous dirty blocks
+    for (size_t i = 0, r = 0; i < ndirty; r++) {
+        size_t n = disk_dirty_run(dirty, ndirty, i);
+        for (size_t j = 0; j < n; j++) {
+            iov[i + j].iov_base = dirty[i + j]->data;
+            iov[i + j].iov_len  = BLOCK_SIZE;
+        }
+
+        requests[r].iov    = iov + i;
+        requests[r].niov   = n;
+        requests[r].offset = dirty[i]->block * BLOCK_SIZE;
+        requests[r].write  = true;
+        if (!uring_queue(disk->uring, &requests[r])) {
+            requests[r].result   = DISK_FAILURE;
+            requests[r].complete = true;
+        }
+
+        __atomic_add_fetch(&disk->writes, n, __ATOMIC_RELAXED);
+        i += n;
+    }
+    // wait for writes (even if submitting failed, which fails those still
+    // queued) and mark written blocks clean
+    bool result = uring_submit(disk->uring);
+    for (size_t i = 0, r = 0; i < ndirty; r++) {
+        size_t n = disk_dirty_run(dirty, ndirty, i);
+        if (uring_wait(disk->uring, &requests[r]) == (ssize_t)(n * BLOCK_SIZE)) {
+            for (size_t j = 0; j < n; j++)
+                cache_clean(disk->cache, dirty[i + j]);
+        } else {
+            result = false;
+        }
+        i += n;
+    }
+
+    free(requests);
+    free(iov);
+    return result;
+}
+
+/**
+ * Return length of run of contiguous dirty blocks starting at index i (at
+ * most DISK_IOV_BLOCKS).
+ *
+ * @param       dirty       Dirty cache entries sorted by block number.
+ * @param       ndirty      Number of dirty cache entries.
+ * @param       i           Index of first entry in run.
+ *
+ * @return      Number of entries in run.
+ **/
+size_t  disk_dirty_run(CacheEntry **dirty, size_t ndirty, size_t i) {
+    size_t n = 1;
+    while (i + n < ndirty && n < DISK_IOV_BLOCKS && dirty[i + n]->block == dirty[i]->block + n)
+        n++;
+    return n;
+}
+
+/**
+ * Check whether any of count contiguous blocks starting at specified block
+ * are in the cache.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       First block number.
+ * @param       count       Number of blocks.
+ *
+ * @return      Whether or not any of the blocks are cached.
+ **/
+bool    disk_range_cached(Disk *disk, size_t block, size_t count) {
+    bool cached = false;
+
+    pthread_mutex_lock(&disk->lock);
+    for (size_t i = 0; i < count && !cached; i++)
+        cached = cache_find(disk->cache, block + i) != NULL;
+    pthread_mutex_unlock(&disk->lock);
+    return cached;
+}
+
+/**
+ * Read block from disk image into data buffer (bypassing the cache).
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       Block number to perform operation on.
+ * @param       data        Data buffer.
+ *
+ * @return      Number of bytes read.
+ *              (BLOCK_SIZE on success, DISK_FAILURE on failure).
+ **/
+ssize_t disk_read_block(Disk *disk, size_t block, char *data) {
+
+    // read from block to data (must be BLOCK_SIZE)
+    ssize_t count = pread(disk->fd, data, BLOCK_SIZE, block * BLOCK_SIZE);
 
-    disk->writes += 1;
+    __atomic_add_fetch(&disk->reads, 1, __ATOMIC_RELAXED);
 
     // return number of bytes read
+    if (count == BLOCK_SIZE) {
+        return BLOCK_SIZE;
+    } else {
+
+        return DISK_FAILURE;
+    }
+}
+
+/**
+ * Write data buffer to block in disk image (bypassing the cache).
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       Block number to perform operation on.
+ * @param       data        Data buffer.
+ *
+ * @return      Number of bytes written.
+ *              (BLOCK_SIZE on success, DISK_FAILURE on failure).
+ **/
+ssize_t disk_write_block(Disk *disk, size_t block, char *data) {
+
+    // write data buffer to disk block
+    ssize_t count = pwrite(disk->fd, data, BLOCK_SIZE, block * BLOCK_SIZE);
+
+    __atomic_add_fetch(&disk->writes, 1, __ATOMIC_RELAXED);
+
+    // return number of bytes written
     if (count == BLOCK_SIZE)
         return BLOCK_SIZE;
     else
         return DISK_FAILURE;
+}
+
+/**
+ * Read or write count contiguous blocks with positional vectored I/O
+ * (bypassing the cache), resuming after short transfers.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       First block number to perform operation on.
+ * @param       data        Array of count data buffers (each BLOCK_SIZE).
+ * @param       count       Number of blocks (at most DISK_IOV_BLOCKS).
+ * @param       write       Whether to write (otherwise read) the blocks.
+ *
+ * @return      Number of bytes transferred.
+ *              (count * BLOCK_SIZE on success, DISK_FAILURE on failure).
+ **/
+ssize_t disk_io_blocks(Disk *disk, size_t block, char **data, size_t count, bool write) {
+    struct iovec iov[DISK_IOV_BLOCKS];
+    for (size_t i = 0; i < count; i++) {
+        iov[i].iov_base = data[i];
+        iov[i].iov_len  = BLOCK_SIZE;
+    }
+
+    if (write)
+        __atomic_add_fetch(&disk->writes, count, __ATOMIC_RELAXED);
+    else
+        __atomic_add_fetch(&disk->reads,  count, __ATOMIC_RELAXED);
+
+    // transfer blocks (resuming after short transfers)
+    struct iovec *curr  = iov;
+    int           niov  = count;
+    off_t         off   = block * BLOCK_SIZE;
+    while (niov > 0) {
+        ssize_t n = write ? pwritev(disk->fd, curr, niov, off)
+                          : preadv(disk->fd, curr, niov, off);
+        if (n <= 0)
+            return DISK_FAILURE;
 
+        off += n;
+        while (niov > 0 && (size_t)n >= curr->iov_len) {
+            n -= curr->iov_len;
+            curr++;
+            niov--;
+        }
+        if (niov > 0) {
+            curr->iov_base  = (char *)curr->iov_base + n;
+            curr->iov_len  -= n;
+        }
+    }
+
+    return count * BLOCK_SIZE;
 }
 
-/* Internal Functions */
+/**
+ * Copy count contiguous blocks between data buffers and the mapped image.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       First block number to perform operation on.
+ * @param       data        Array of count data buffers (each BLOCK_SIZE).
+ * @param       count       Number of blocks.
+ * @param       write       Whether to write (otherwise read) the blocks.
+ *
+ * @return      Number of bytes transferred (count * BLOCK_SIZE).
+ **/
+ssize_t disk_mapped_io(Disk *disk, size_t block, char **data, size_t count, bool write) {
+    for (size_t i = 0; i < count; i++) {
+        char *mapped = disk->map + (block + i) * BLOCK_SIZE;
+        if (write)
+            memcpy(mapped, data[i], BLOCK_SIZE);
+        else
+            memcpy(data[i], mapped, BLOCK_SIZE);
+    }
+
+    if (write)
+        __atomic_add_fetch(&disk->writes, count, __ATOMIC_RELAXED);
+    else
+        __atomic_add_fetch(&disk->reads,  count, __ATOMIC_RELAXED);
+
+    return count * BLOCK_SIZE;
+}
+
+/**
+ * Perform sanity check before vectored read or write operation.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       First block number to perform operation on.
+ * @param       data        Array of count data buffers.
+ * @param       count       Number of blocks.
+ *
+ * @return      Whether or not it is safe to perform the operation.
+ **/
+bool    disk_vector_check(Disk *disk, size_t block, char **data, size_t count) {
+    if (!disk || !data)
+        return false;
+
+    if (block >= disk->blocks || count > disk->blocks - block)
+        return false;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!data[i])
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Insert block into the cache, writing back dirty blocks first if every
+ * evictable entry is dirty.
+ *
+ * @param       disk        Pointer to Disk structure.
+ * @param       block       Block number to insert.
+ *
+ * @return      Pointer to new cache entry (NULL if every entry is pinned).
+ **/
+CacheEntry *disk_cache_insert(Disk *disk, size_t block) {
+    CacheEntry *entry = cache_insert(disk->cache, block);
+
+    if (!entry && disk->cache->dirty && disk_flush(disk))
+        entry = cache_insert(disk->cache, block);
+
+    return entry;
+}
+
+/**
+ * Compare cache entries by block number (for qsort).
+ *
+ * @param       a           Pointer to first CacheEntry pointer.
+ * @param       b           Pointer to second CacheEntry pointer.
+ *
+ * @return      Negative, zero, or positive if a is before, equal to, or after b.
+ **/
+int     disk_entry_compare(const void *a, const void *b) {
+    size_t ablock = (*(CacheEntry **)a)->block;
+    size_t bblock = (*(CacheEntry **)b)->block;
+    return (ablock > bblock) - (ablock < bblock);
+}
 
 /**
  * Perform sanity check before read or write operation by doing the following:
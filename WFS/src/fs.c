@@ -8,6 +8,84 @@
 #include <string.h>
 
 size_t gimme_block(FileSystem *fs);
+void   claim_block(FileSystem *fs, size_t block);
+void   release_block(FileSystem *fs, size_t block);
+
+uint64_t *bitmap_create(const SuperBlock *super, size_t *words);
+bool   bitmap_store(Disk *disk, const SuperBlock *super, uint64_t *bitmap);
+bool   bitmap_load(FileSystem *fs);
+bool   bitmap_scan(FileSystem *fs);
+bool   superblock_store(FileSystem *fs);
+
+size_t gimme_goal(FileSystem *fs, size_t goal, size_t need, size_t want, size_t *got);
+size_t bitmap_next(FileSystem *fs, size_t from, size_t end);
+size_t bitmap_run(FileSystem *fs, size_t block, size_t want);
+Extent *extent_at(Inode *inode, Block *spill, size_t index);
+size_t extent_blocks(Inode *inode, Block *spill);
+bool   extent_append(FileSystem *fs, Inode *inode, Block *spill, size_t start, size_t length);
+
+void   inode_lock(FileSystem *fs, size_t inode_number, bool write);
+void   inode_unlock(FileSystem *fs, size_t inode_number);
+bool   inode_opened(FileSystem *fs, size_t inode_number);
+
+ssize_t inode_create(FileSystem *fs, uint32_t type);
+bool   inode_remove(FileSystem *fs, size_t inode_number);
+bool   inode_delete(FileSystem *fs, size_t inode_number);
+
+bool   journal_create(FileSystem *fs);
+void   journal_delete(FileSystem *fs);
+bool   journal_start(FileSystem *fs, size_t credits);
+void   journal_stop(FileSystem *fs);
+bool   journal_read(FileSystem *fs, size_t block, char *data);
+bool   journal_write(FileSystem *fs, size_t block, char *data);
+bool   journal_commit(FileSystem *fs);
+void   journal_release(FileSystem *fs);
+bool   journal_checkpoint(FileSystem *fs);
+bool   journal_replay(FileSystem *fs);
+void   journal_free(FileSystem *fs, size_t start, size_t length, bool logged);
+void   journal_reuse(FileSystem *fs, size_t start, size_t length);
+bool   journal_append(Extent **runs, size_t *nruns, size_t *capacity, size_t start, size_t length);
+bool   journal_overlaps(Extent *runs, size_t nruns, size_t start, size_t length);
+uint32_t journal_checksum(Block *transaction, size_t count);
+
+File * file_open(FileSystem *fs, size_t inode_number);
+bool   file_close(File *file);
+ssize_t file_read(File *file, char *data, size_t length, size_t offset);
+ssize_t file_write(File *file, char *data, size_t length, size_t offset);
+bool   file_decode(File *file);
+size_t file_map(File *file, size_t lblock, size_t *run);
+bool   file_flush(File *file);
+ssize_t file_read_blocks(File *file, char *data, size_t length, size_t offset);
+bool   file_readahead(File *file, size_t lblock);
+void   file_readahead_drop(File *file);
+void   file_readahead_async(File *file, size_t lblock);
+bool   file_readahead_wait(File *file);
+void   file_readahead_cancel(File *file);
+size_t file_alloc(File *file, size_t goal, size_t want, size_t *got);
+void   file_prealloc_drop(File *file);
+ssize_t file_write_pointers(File *file, char *data, size_t length, size_t offset);
+ssize_t file_write_extents(File *file, char *data, size_t length, size_t offset);
+
+ssize_t dir_root(FileSystem *fs, bool create);
+ssize_t dir_walk(FileSystem *fs, const char *path, char *name, bool create);
+ssize_t dir_resolve(FileSystem *fs, const char *path, uint32_t *type);
+ssize_t dir_make(FileSystem *fs);
+ssize_t dir_lookup(FileSystem *fs, size_t dir, const char *name, uint32_t *type);
+bool   dir_insert(FileSystem *fs, size_t dir, const char *name, size_t inode_number, uint32_t type);
+bool   dir_add(File *dir, Block *root, const char *name, size_t inode_number, uint32_t type);
+bool   dir_delete(FileSystem *fs, size_t dir, const char *name);
+ssize_t dir_count(FileSystem *fs, size_t dir);
+File * dir_open(FileSystem *fs, size_t dir, Block *root);
+ssize_t dir_leaf(File *dir, Block *root, uint32_t hash, Block *leaf);
+bool   dir_read(File *dir, size_t lblock, Block *block);
+bool   dir_write(File *dir, size_t lblock, Block *block);
+ssize_t dir_grow(File *dir);
+bool   dir_shrink(File *dir, Inode *inode, Block *spill);
+size_t dir_find(DirIndex *index, uint32_t hash);
+void   dir_link(DirIndex *index, size_t position, uint32_t hash, size_t lblock);
+DirEntry *dir_search(Block *leaf, const char *name, uint32_t hash);
+int    dir_compare(const void *a, const void *b);
+uint32_t dir_hash(const char *name);
 
 /* External Functions */
 
@@ -18,6 +96,8 @@ size_t gimme_block(FileSystem *fs);
  *
  *  2. Read Inode Table and report information about each Inode.
  *
+ *  3. Report fragmentation (extents per file) of extent-mapped files.
+ *
  * @param       disk        Pointer to Disk structure.
  **/
 void    fs_debug(Disk *disk) {
@@ -35,6 +115,9 @@ void    fs_debug(Disk *disk) {
     printf("    %u inode blocks\n"   , block.super.inode_blocks);
     printf("    %u inodes\n"         , block.super.inodes);
 
+    bool extents = block.super.version >= FS_VERSION_EXTENTS;
+    size_t files = 0, nextents = 0;
+
     /* Read Inodes */
     for (int i = 1; i <= block.super.inode_blocks; i++) {
         Block B;
@@ -48,6 +131,30 @@ void    fs_debug(Disk *disk) {
             if (B.inodes[j].valid) {
                 printf("Inode %d:\n", j);
                 printf("    size: %d bytes\n", B.inodes[j].size);
+
+                /* read extents */
+                if (extents) {
+                    Block spill;
+                    if (B.inodes[j].spill && disk_read(disk, B.inodes[j].spill, spill.data) == DISK_FAILURE) {
+                        return;
+                    }
+
+                    printf("    extents:");
+                    for (size_t e = 0; e < B.inodes[j].nextents; e++) {
+                        Extent *extent = extent_at(&B.inodes[j], &spill, e);
+                        printf(" %u-%u", extent->start, extent->start + extent->length - 1);
+                    }
+                    printf("\n");
+
+                    if (B.inodes[j].spill) {
+                        printf("    extent block: %u\n", B.inodes[j].spill);
+                    }
+
+                    files++;
+                    nextents += B.inodes[j].nextents;
+                    continue;
+                }
+
                 printf("    direct blocks:");
 
                 /* read direct ptrs */
@@ -85,6 +192,14 @@ void    fs_debug(Disk *disk) {
         }
 
     }
+
+    /* Report fragmentation */
+    if (files) {
+        printf("Fragmentation:\n");
+        printf("    %lu files\n", files);
+        printf("    %lu extents\n", nextents);
+        printf("    %.2f extents per file\n", (double)nextents / files);
+    }
 }
 
 /**
@@ -95,6 +210,9 @@ void    fs_debug(Disk *disk) {
  *
  *  2. Clear all remaining blocks.
  *
+ *  3. Write free block bitmap to the blocks reserved for it at end of disk
+ *  (after the journal, on disks large enough for one).
+ *
  * Note: Do not format a mounted Disk!
  *
  * @param       fs      Pointer to FileSystem structure.
@@ -118,24 +236,46 @@ bool    fs_format(FileSystem *fs, Disk *disk) {
     else
         ceil = disk->blocks * 0.10 + 1;
 
+    /* reserve bitmap blocks */
+    uint32_t bitmap_blocks = (disk->blocks + BITS_PER_BLOCK - 1) / BITS_PER_BLOCK;
+    if (1 + ceil + bitmap_blocks > disk->blocks)
+        return false;
+
+    /* reserve journal blocks (if disk is large enough) */
+    uint32_t journal_blocks = min(disk->blocks / 32, JOURNAL_MAX_BLOCKS);
+    if (journal_blocks < JOURNAL_MIN_BLOCKS || 1 + ceil + bitmap_blocks + journal_blocks > disk->blocks)
+        journal_blocks = 0;
+
     /* write superblock */
     Block block = {{0}};
     block.super.magic_number = MAGIC_NUMBER;
     block.super.blocks = disk->blocks;
     block.super.inode_blocks = ceil;
     block.super.inodes = ceil*INODES_PER_BLOCK;
+    block.super.bitmap_blocks = bitmap_blocks;
+    block.super.clean = true;
+    block.super.version = journal_blocks ? FS_VERSION_JOURNAL : FS_VERSION_EXTENTS;
+    block.super.journal_blocks = journal_blocks;
+    block.super.journal_sequence = 1;
 
     if(disk_write(disk, 0, block.data) == DISK_FAILURE)
         return false;
    
     /* clear remaining blocks */
     char buff[BLOCK_SIZE] = {0}; 
-    for (size_t i = 1; i < disk->blocks; i++){
+    for (size_t i = 1; i < disk->blocks - bitmap_blocks; i++){
         if(disk_write(disk, i, buff) == DISK_FAILURE)
             return false;
     }
 
-    return true;
+    /* write free block bitmap */
+    uint64_t *bitmap = bitmap_create(&block.super, NULL);
+    if (!bitmap)
+        return false;
+
+    bool result = bitmap_store(disk, &block.super, bitmap);
+    free(bitmap);
+    return result;
 }
 
 
@@ -147,9 +287,16 @@ bool    fs_format(FileSystem *fs, Disk *disk) {
  *
  *  2. Verify and record FileSystem disk attribute. 
  *
- *  3. Copy SuperBlock to FileSystem meta data attribute
+ *  3. Copy SuperBlock to FileSystem meta data attribute (and initialize
+ *  FileSystem locks).
  *
- *  4. Initialize FileSystem free blocks bitmap.
+ *  4. Replay committed transactions from the journal (if any).
+ *
+ *  5. Initialize FileSystem free blocks bitmap: load it from the blocks
+ *  reserved for it if the FileSystem was cleanly unmounted, otherwise rebuild
+ *  it from the Inode table (and write it to the blocks reserved for it).
+ *
+ *  6. Clear the clean flag in the SuperBlock until fs_unmount.
  *
  * Note: Do not mount a Disk that has already been mounted!
  *
@@ -172,6 +319,14 @@ bool    fs_mount(FileSystem *fs, Disk *disk) {
         return false;
     if (block.super.inodes != (block.super.inode_blocks * INODES_PER_BLOCK))
         return false;
+    if (1 + block.super.inode_blocks + block.super.bitmap_blocks + block.super.journal_blocks > disk->blocks)
+        return false;
+    if (block.super.version > FS_VERSION_JOURNAL)
+        return false;
+    if (block.super.journal_blocks && (block.super.version < FS_VERSION_JOURNAL || block.super.journal_blocks < JOURNAL_MIN_BLOCKS))
+        return false;
+    if (block.super.root > block.super.inodes)
+        return false;
 
     /* Verify and record disk attb */
     if (fs->disk) {
@@ -180,78 +335,150 @@ bool    fs_mount(FileSystem *fs, Disk *disk) {
         fs->disk = disk;
     }
 
+    /* initialize locks */
+    pthread_mutex_init(&fs->alloc_lock, NULL);
+    pthread_mutex_init(&fs->table_lock, NULL);
+    for (size_t l = 0; l < FS_INODE_LOCKS; l++)
+        pthread_rwlock_init(&fs->inode_locks[l], NULL);
+    pthread_mutex_init(&fs->journal_lock, NULL);
+    pthread_cond_init(&fs->journal_idle, NULL);
+    pthread_rwlock_init(&fs->dir_lock, NULL);
+    fs->inode_hint = 0;
+
     /* copy superblock to metadata */
     fs->meta_data.magic_number = block.super.magic_number;
     fs->meta_data.blocks = block.super.blocks;
     fs->meta_data.inode_blocks = block.super.inode_blocks;
     fs->meta_data.inodes = block.super.inodes;
+    fs->meta_data.bitmap_blocks = block.super.bitmap_blocks;
+    fs->meta_data.clean = block.super.clean;
+    fs->meta_data.version = block.super.version;
+    fs->meta_data.journal_blocks = block.super.journal_blocks;
+    fs->meta_data.journal_sequence = block.super.journal_sequence;
+    fs->meta_data.root = block.super.root;
+
+    /* replay journal */
+    if (fs->meta_data.journal_blocks && (!journal_create(fs) || !journal_replay(fs)))
+        return false;
 
-    /* initialize bitmap */
-    fs->free_blocks = calloc(disk->blocks, sizeof(bool));
-    memset(fs->free_blocks, true, disk->blocks);
-
-    fs->free_blocks[0] = false;
+    /* initialize bitmap (superblock, inode, and bitmap blocks are not free) */
+    fs->free_blocks = bitmap_create(&fs->meta_data, &fs->free_words);
+    fs->free_hint   = 0;
+    if (!fs->free_blocks)
+        return false;
 
-    for (int i = 1; i <= fs->meta_data.inode_blocks; i++) {
+    /* initialize open handle counts */
+    fs->open_counts = calloc(fs->meta_data.inodes, sizeof(uint32_t));
+    if (!fs->open_counts)
+        return false;
 
-        /* read inode block */
-        Block B;
-        if (disk_read(disk, i, B.data) == DISK_FAILURE)
+    /* load bitmap if cleanly unmounted (otherwise rebuild it from inodes) */
+    if (fs->meta_data.bitmap_blocks && fs->meta_data.clean) {
+        if (!bitmap_load(fs))
             return false;
+    } else {
+        if (!bitmap_scan(fs))
+            return false;
+        if (!bitmap_store(disk, &fs->meta_data, fs->free_blocks))
+            return false;
+    }
 
-        /* mark inode block */
-        fs->free_blocks[i] = false;
-
-        /* check inodes in block */
-        for (int j = 0; j < INODES_PER_BLOCK; j++) {
-            
-            /* if valid inode, check ptrs */
-            if (B.inodes[j].valid) {
-
-                /* check direct */
-                for (int k = 0; k < POINTERS_PER_INODE; k++) {
-
-                    /* if ptr being used, mark block */
-                    if (B.inodes[j].direct[k]) 
-                        fs->free_blocks[B.inodes[j].direct[k]] = false;
-                }
-
-                /* check indirect */
-                if (B.inodes[j].indirect) {
-                    Block iblock;
-                    if (disk_read(disk, B.inodes[j].indirect, iblock.data) == DISK_FAILURE)
-                        return false;
-
-                    /* mark ptr block */
-                    fs->free_blocks[B.inodes[j].indirect] = false;
-
-                    /* check ptr block */
-                    for (int p = 0; p < POINTERS_PER_BLOCK; p++) {
-
-                        /* mark block */
-                        if (iblock.pointers[p])
-                            fs->free_blocks[iblock.pointers[p]] = false;
-                    }
-                }
-            }
-        }
+    /* mark file system as in use until it is cleanly unmounted */
+    if (fs->meta_data.bitmap_blocks) {
+        fs->meta_data.clean = false;
+        if (!superblock_store(fs))
+            return false;
     }
+
     return true;
 }
 
 /**
  * Unmount FileSystem from internal Disk by doing the following:
  *
- *  1. Set FileSystem disk attribute.
+ *  1. Write back free block bitmap and dirty blocks (committing the running
+ *  transaction and checkpointing the journal).
+ *
+ *  2. Set the clean flag in the SuperBlock (if the bitmap was written).
+ *
+ *  3. Release FileSystem locks and reset disk attribute.
  *
- *  2. Release free blocks bitmap.
+ *  4. Release free blocks bitmap.
  *
  * @param       fs      Pointer to FileSystem structure.
  **/
 void    fs_unmount(FileSystem *fs) {
+    if (!fs->disk)
+        return;
+
+    bool synced = fs_sync(fs);
+    if (synced && fs->meta_data.journal_blocks) {
+        pthread_mutex_lock(&fs->alloc_lock);
+        synced = bitmap_store(fs->disk, &fs->meta_data, fs->free_blocks);
+        pthread_mutex_unlock(&fs->alloc_lock);
+
+        pthread_mutex_lock(&fs->journal_lock);
+        synced = synced && journal_checkpoint(fs);
+        pthread_mutex_unlock(&fs->journal_lock);
+    }
+
+    if (synced && fs->meta_data.bitmap_blocks) {
+        fs->meta_data.clean = true;
+        superblock_store(fs);
+    }
+
+    pthread_mutex_destroy(&fs->alloc_lock);
+    pthread_mutex_destroy(&fs->table_lock);
+    for (size_t l = 0; l < FS_INODE_LOCKS; l++)
+        pthread_rwlock_destroy(&fs->inode_locks[l]);
+    pthread_mutex_destroy(&fs->journal_lock);
+    pthread_cond_destroy(&fs->journal_idle);
+    pthread_rwlock_destroy(&fs->dir_lock);
+    journal_delete(fs);
+
     fs->disk = NULL;
     free(fs->free_blocks);
     fs->free_blocks = NULL;
+    free(fs->open_counts);
+    fs->open_counts = NULL;
+}
+
+/**
+ * Write back free block bitmap and all dirty data, inode, and pointer blocks
+ * to Disk.
+ *
+ * On journaled file systems, only the running transaction is committed (once
+ * the operations running in it stop, while new ones wait for the commit): the
+ * logged blocks are checkpointed to their home locations lazily, and the
+ * bitmap is rebuilt from the Inode table if the file system is not cleanly
+ * unmounted.
+ *
+ * @param       fs      Pointer to FileSystem structure.
+ * @return      Whether or not all dirty blocks were written (false on failure).
+ **/
+bool    fs_sync(FileSystem *fs) {
+    if (!fs->disk)
+        return false;
+
+    if (fs->meta_data.journal_blocks) {
+        pthread_mutex_lock(&fs->journal_lock);
+        fs->journal_waiting++;
+        while (fs->journal_handles)
+            pthread_cond_wait(&fs->journal_idle, &fs->journal_lock);
+        bool committed = journal_commit(fs);
+        fs->journal_waiting--;
+        pthread_cond_broadcast(&fs->journal_idle);
+        pthread_mutex_unlock(&fs->journal_lock);
+        return committed;
+    }
+
+    pthread_mutex_lock(&fs->alloc_lock);
+    bool stored = bitmap_store(fs->disk, &fs->meta_data, fs->free_blocks);
+    pthread_mutex_unlock(&fs->alloc_lock);
+    if (!stored)
+        return false;
+
+    return disk_sync(fs->disk);
 }
 
 /**
@@ -267,36 +494,14 @@ void    fs_unmount(FileSystem *fs) {
  * @return      Inode number of allocated Inode.
  **/
 ssize_t fs_create(FileSystem *fs) {
+    if (!fs->disk || !journal_start(fs, JOURNAL_INODE_CREDITS))
+        return -1;
 
-    Block B;
-
-    /* search free node list */
-    for (int block = 0; block < fs->meta_data.inode_blocks; block++) {
-
-
-        /* read inode block */
-        if(disk_read(fs->disk, block + 1, B.data) == DISK_FAILURE)
-            return -1;
-
-        /* find free inode in table */
-        for (int i = 0; i < INODES_PER_BLOCK; i++) {
-
-            if (!B.inodes[i].valid) {
-
-                /* mark as in use */
-                B.inodes[i].valid = true;
-               
-                /* write back to disk */
-                if(disk_write(fs->disk, block / INODES_PER_BLOCK + 1, B.data) == DISK_FAILURE)
-                    return -1;
-
-                /* return inode number */
-                return i + (block * INODES_PER_BLOCK);
-            }
-        }
-    }
-
-    return -1;
+    pthread_mutex_lock(&fs->table_lock);
+    ssize_t inode_number = inode_create(fs, INODE_FILE);
+    pthread_mutex_unlock(&fs->table_lock);
+    journal_stop(fs);
+    return inode_number;
 }
 
 /**
@@ -310,71 +515,19 @@ ssize_t fs_create(FileSystem *fs) {
  *
  *  4. Mark Inode as free in Inode table.
  *
+ * Note: An Inode with open File handles cannot be removed.
+ *
  * @param       fs              Pointer to FileSystem structure.
  * @param       inode_number    Inode to remove.
  * @return      Whether or not removing the specified Inode was successful.
  **/
 bool    fs_remove(FileSystem *fs, size_t inode_number) {
-
-    size_t iblock = inode_number / INODES_PER_BLOCK;
-    size_t inum   = inode_number % INODES_PER_BLOCK;
-    Block block;
-
-    /* read in inode block */
-    if (disk_read(fs->disk, iblock + 1, block.data) == DISK_FAILURE)
+    if (!fs->disk || inode_number >= fs->meta_data.inodes || !journal_start(fs, JOURNAL_INODE_CREDITS))
         return false;
 
-    /* check if valid first */
-    if (block.inodes[inum].valid) {
-
-        /* free direct blocks */
-        for (int d = 0; d < POINTERS_PER_INODE; d++) {
-            int db = block.inodes[inum].direct[d];
-
-            /* mark db as free */
-            if (db) {
-                fs->free_blocks[db] = true;
-                block.inodes[inum].direct[d] = 0;
-            }
-        }
-
-        /* free indirect blocks */
-        int ib = block.inodes[inum].indirect;
-        if (ib) {
-            Block ipblock;
-
-            /* read indirect */
-            if (disk_read(fs->disk, ib, ipblock.data) == DISK_FAILURE)
-                return false;
-
-            /* free ptrs */
-            for (int p = 0; p < POINTERS_PER_BLOCK; p++) {
-                if (ipblock.pointers[p]) {
-
-                    /* mark data as free */
-                    fs->free_blocks[ipblock.pointers[p]] = true;
-                    ipblock.pointers[p] = 0;
-                }
-                    
-            }
-
-            /* mark ip as free */
-            fs->free_blocks[ib] = true;
-            block.inodes[inum].indirect = 0;
-        }
-
-        /* mark free in table */
-        block.inodes[inum].valid = false;
-        block.inodes[inum].size = 0;
-
-        /* write back to disk */
-        if (disk_write(fs->disk, iblock + 1, block.data) == DISK_FAILURE)
-            return false;
-
-        return true;
-    }
-
-    return false;
+    bool result = inode_delete(fs, inode_number);
+    journal_stop(fs);
+    return result;
 }
 
 /**
@@ -389,26 +542,24 @@ ssize_t fs_stat(FileSystem *fs, size_t inode_number) {
     size_t iblock = inode_number / INODES_PER_BLOCK;
     size_t inum = inode_number % INODES_PER_BLOCK;
 
-    Block block;
-
-    if (disk_read(fs->disk, iblock + 1, block.data) == DISK_FAILURE)
+    if (!fs->disk)
         return -1;
 
-    if (block.inodes[inum].valid)
-        return block.inodes[inum].size;
+    Block block;
+    ssize_t size = -1;
+
+    inode_lock(fs, inode_number, false);
+    if (journal_read(fs, iblock + 1, block.data) && block.inodes[inum].valid)
+        size = block.inodes[inum].size;
+    inode_unlock(fs, inode_number);
 
-    return -1;
+    return size;
 }
 
 /**
  * Read from the specified Inode into the data buffer exactly length bytes
- * beginning from the specified offset by doing the following:
- *
- *  1. Load Inode information.
- *
- *  2. Continuously read blocks and copy data to buffer.
- *
- *  Note: Data is read from direct blocks first, and then from indirect blocks.
+ * beginning from the specified offset (by opening the file, reading from its
+ * handle, and closing it while holding the inode lock for reading).
  *
  * @param       fs              Pointer to FileSystem structure.
  * @param       inode_number    Inode to read data from.
@@ -418,223 +569,2859 @@ ssize_t fs_stat(FileSystem *fs, size_t inode_number) {
  * @return      Number of bytes read (-1 on error).
  **/
 ssize_t fs_read(FileSystem *fs, size_t inode_number, char *data, size_t length, size_t offset) {
-
-	/* calc nums */
-    size_t iblock = inode_number / INODES_PER_BLOCK;
-    size_t inum = inode_number % INODES_PER_BLOCK;
-
-    size_t data_b = offset / BLOCK_SIZE;
-    size_t data_o = offset % BLOCK_SIZE;
-
-    /* read inode */
-    Block block;
-    if (disk_read(fs->disk, iblock + 1, block.data) == DISK_FAILURE) {
+    if (!fs->disk)
         return -1;
-    }
-
-	/* adjust size */
-    size_t size = block.inodes[inum].size;
-
-    if (length + offset > size)
-        length = size - offset;
-
-    ssize_t ncopy;
-    ssize_t nread = 0;
-
-	/* addjuct ncopy */
-    if (length + data_o < BLOCK_SIZE) {
-       ncopy = length;
-    } else {
-        ncopy = BLOCK_SIZE - data_o;
-    }
-    while (nread < length) {
-
-        /* read data block */
-        Block Dblock;
-        if (data_b < POINTERS_PER_INODE) {
-			/* direct ptr */
-            if(disk_read(fs->disk, block.inodes[inum].direct[data_b], Dblock.data) == DISK_FAILURE)
-                return -1;
-
-        } else {
-			
-			/* indirect ptr */
-            size_t idata_o = data_b - POINTERS_PER_INODE;
-            Block Iblock;
-            if (disk_read(fs->disk, block.inodes[inum].indirect, Iblock.data) == DISK_FAILURE) 
-                return -1;
-
-            if (disk_read(fs->disk, Iblock.pointers[idata_o], Dblock.data) == DISK_FAILURE) 
-                return -1;
-
-        }
-        
-        /* copy chunk */
-        memcpy(data + nread, Dblock.data + data_o, ncopy);
-        nread += ncopy;
 
-		/* update vals */
-        if (length - nread > BLOCK_SIZE) {
-            ncopy = BLOCK_SIZE;
-        } else {
-            ncopy = length - nread;
-        }
-        data_o = 0;
-        data_b += 1;
+    inode_lock(fs, inode_number, false);
+    ssize_t nread = -1;
+    File   *file  = file_open(fs, inode_number);
+    if (file) {
+        nread = file_read(file, data, length, offset);
+        file_close(file);
     }
-
+    inode_unlock(fs, inode_number);
     return nread;
 }
 
-
-
 /**
  * Write to the specified Inode from the data buffer exactly length bytes
- * beginning from the specified offset by doing the following:
+ * beginning from the specified offset (by opening the file, writing to its
+ * handle, and closing it while holding the inode lock for writing).
  *
- *  1. Load Inode information.
- *
- *  2. Continuously copy data from buffer to blocks.
- *
- *  Note: Data is read from direct blocks first, and then from indirect blocks.
+ * Note: An Inode with open File handles can only be written through them.
  *
  * @param       fs              Pointer to FileSystem structure.
  * @param       inode_number    Inode to write data to.
  * @param       data            Buffer with data to copy
  * @param       length          Number of bytes to write.
  * @param       offset          Byte offset from which to begin writing.
- * @return      Number of bytes read (-1 on error).
+ * @return      Number of bytes written (-1 on error).
  **/
 ssize_t fs_write(FileSystem *fs, size_t inode_number, char *data, size_t length, size_t offset) {
-
-
-    /* inode info */
-    size_t iblock = inode_number / INODES_PER_BLOCK + 1;
-    size_t inum = inode_number % INODES_PER_BLOCK;
-
-    /* ptr info */
-    size_t data_b = offset / BLOCK_SIZE;
-    size_t data_o = offset % BLOCK_SIZE;
-
-    /* read in inode */
-    Block block;
-    if (disk_read(fs->disk, iblock, block.data) == DISK_FAILURE)
+    if (!fs->disk || inode_number >= fs->meta_data.inodes || !journal_start(fs, JOURNAL_INODE_CREDITS))
         return -1;
 
-
-    size_t ncopy, nwrite = 0, blk = -1;
-    while(nwrite < length) {
-
-		Block Dblock = {{0}};
-		if (data_b < POINTERS_PER_INODE) {
-        	
-			/* find new block */
-        	if (block.inodes[inum].direct[data_b] == 0) {
-				size_t b = gimme_block(fs);
-
-				if (b == -1)
-					return nwrite;
-
-            	block.inodes[inum].direct[data_b] = b;   
-			} else {	
-
-				/* read in data block */
-        		if (disk_read(fs->disk, block.inodes[inum].direct[data_b], Dblock.data) == DISK_FAILURE)
-            		return -1;
-			}
-			blk = block.inodes[inum].direct[data_b];
-		} else {
-            size_t idata_o = data_b - POINTERS_PER_INODE;
-
-			Block pblock = {{0}};
-			/* check and find indirect block */
-			if (block.inodes[inum].indirect == 0) {
-				size_t i = gimme_block(fs);
-				if (i == -1)
-					return nwrite;
-				block.inodes[inum].indirect = i;
-			} else {	
-
-				/* read in ptr block */
-             	if (disk_read(fs->disk, block.inodes[inum].indirect, pblock.data) == DISK_FAILURE) 
-                	return -2;
-			}
-
-
-            /* check ptr */
-			if (pblock.pointers[idata_o] == 0) {
-				size_t p = gimme_block(fs);
-				pblock.pointers[idata_o] = p;
-				if (p == -1)
-					return nwrite;
-			} else {
-
-				/* read data */
-				if (disk_read(fs->disk, pblock.pointers[idata_o], Dblock.data) == DISK_FAILURE) 
-                	return -3;
-			}
-
-			blk = pblock.pointers[idata_o];
-			
-			/* write back ptr block */
-			if(disk_write(fs->disk, block.inodes[inum].indirect, pblock.data) == DISK_FAILURE)
-				return -4;
-		}
-
-		/* update ncopy */
-        if ((length - nwrite) + data_o < BLOCK_SIZE) {
-            ncopy = length - nwrite;
-        } else {
-            ncopy = BLOCK_SIZE - data_o;
-        }
-
-        /* copy the data */
-        memcpy(Dblock.data + data_o, data + nwrite, ncopy);
-        nwrite += ncopy;
-
-        /* update inode info */
-        block.inodes[inum].size = nwrite + offset;
-
-
-        /* write block back */
-        if (disk_write(fs->disk, blk, Dblock.data) == DISK_FAILURE)
-            return -5;
-
-        /* reset stuff */
-        data_o = 0;
-        data_b++;
-
-        /* write back inode */
-        if (disk_write(fs->disk, iblock, block.data) == DISK_FAILURE)
-            return -1;
-
+    inode_lock(fs, inode_number, true);
+    ssize_t nwrite = -1;
+    File   *file   = inode_opened(fs, inode_number) ? NULL : file_open(fs, inode_number);
+    if (file) {
+        nwrite = file_write(file, data, length, offset);
+        if (!file_close(file))
+            nwrite = -1;
     }
+    inode_unlock(fs, inode_number);
+    journal_stop(fs);
     return nwrite;
-     
 }
 
 /**
+ * Open the specified Inode and return a File handle caching its Inode and
+ * block map.
  *
- * the GIMME_BLOCK function loops through the free block list and find the next
- * avaliable block and GIMMES to the caller!! :) happi pandaA
+ * Note: A File handle must only be used by one thread at a time, and an Inode
+ * can only be written through a handle while it is the only one open (so the
+ * Inode cached by one handle never overwrites changes made through another).
+ * Opening fails once that handle has written, until it is closed.  While the
+ * Inode is open, fs_write and fs_remove (and fs_unlink) fail instead of
+ * changing it behind the handles.
  *
  * @param       fs              Pointer to FileSystem structure.
- * @return      first avaliable Block to write to (-1 on nothing found).
- *
- * */
-
-size_t gimme_block(FileSystem *fs){
-
-    for (size_t i = 1; i < fs->disk->blocks; i++){
+ * @param       inode_number    Inode to open.
+ * @return      Pointer to newly allocated File handle (NULL on failure).
+ **/
+File *  fs_open(FileSystem *fs, size_t inode_number) {
+    if (!fs->disk || inode_number >= fs->meta_data.inodes)
+        return NULL;
+
+    inode_lock(fs, inode_number, false);
+    File *file = NULL;
+    if (!(__atomic_load_n(&fs->open_counts[inode_number], __ATOMIC_RELAXED) & OPEN_WRITTEN))
+        file = file_open(fs, inode_number);
+    if (file)
+        __atomic_add_fetch(&fs->open_counts[inode_number], 1, __ATOMIC_RELAXED);
+    inode_unlock(fs, inode_number);
+    return file;
+}
 
-        if (fs->free_blocks[i] == true){
+/**
+ * Close File handle by writing back any changes to its Inode (and indirect or
+ * spill block) and releasing it.
+ *
+ * @param       file            Pointer to File handle.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool    fs_close(File *file) {
+    if (!file)
+        return false;
 
-            fs->free_blocks[i] = false;
-            return i;
-        }
-    }
+    FileSystem *fs           = file->fs;
+    size_t      inode_number = file->inode_number;
+    bool        started      = journal_start(fs, JOURNAL_INODE_CREDITS);
+
+    inode_lock(fs, inode_number, true);
+    bool result = file_close(file) && started;
+    if ((__atomic_sub_fetch(&fs->open_counts[inode_number], 1, __ATOMIC_RELAXED) & ~OPEN_WRITTEN) == 0)
+        __atomic_store_n(&fs->open_counts[inode_number], 0, __ATOMIC_RELAXED);
+    inode_unlock(fs, inode_number);
+    if (started)
+        journal_stop(fs);
+    return result;
+}
 
-    return -1;
+/**
+ * Read from the File into the data buffer exactly length bytes beginning from
+ * the specified offset (holding the inode lock for reading, so readers of the
+ * same Inode proceed in parallel).
+ *
+ * @param       file            Pointer to File handle.
+ * @param       data            Buffer to copy data to.
+ * @param       length          Number of bytes to read.
+ * @param       offset          Byte offset from which to begin reading.
+ * @return      Number of bytes read (-1 on error).
+ **/
+ssize_t fs_file_read(File *file, char *data, size_t length, size_t offset) {
+    inode_lock(file->fs, file->inode_number, false);
+    ssize_t nread = file_read(file, data, length, offset);
+    inode_unlock(file->fs, file->inode_number);
+    return nread;
+}
+
+/**
+ * Write to the File from the data buffer exactly length bytes beginning from
+ * the specified offset (holding the inode lock for writing).
+ *
+ * Note: Writing fails while other handles of the same Inode are open.
+ *
+ * @param       file            Pointer to File handle.
+ * @param       data            Buffer with data to copy
+ * @param       length          Number of bytes to write.
+ * @param       offset          Byte offset from which to begin writing.
+ * @return      Number of bytes written (-1 on error).
+ **/
+ssize_t fs_file_write(File *file, char *data, size_t length, size_t offset) {
+    FileSystem *fs = file->fs;
+    ssize_t nwrite = -1;
+
+    inode_lock(fs, file->inode_number, true);
+    uint32_t *open_count = &fs->open_counts[file->inode_number];
+    if ((__atomic_load_n(open_count, __ATOMIC_RELAXED) & ~OPEN_WRITTEN) == 1) {
+        __atomic_or_fetch(open_count, OPEN_WRITTEN, __ATOMIC_RELAXED);
+        nwrite = file_write(file, data, length, offset);
+    }
+    inode_unlock(fs, file->inode_number);
+    return nwrite;
+}
+
+/**
+ * Return whether or not specified block is free in the free block bitmap.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       block           Block number to check.
+ * @return      Whether or not block is free (false if out of range).
+ **/
+bool    fs_is_free_block(FileSystem *fs, size_t block) {
+    if (!fs->free_blocks || block >= fs->meta_data.blocks)
+        return false;
+
+    pthread_mutex_lock(&fs->alloc_lock);
+    bool free = fs->free_blocks[block / BITS_PER_WORD] & (1ULL << (block % BITS_PER_WORD));
+    pthread_mutex_unlock(&fs->alloc_lock);
+    return free;
+}
+
+/**
+ * Resolve absolute path (components separated by '/') to an Inode number.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       path            Absolute path ("/" is the root directory).
+ * @return      Inode number of path (-1 if it does not exist).
+ **/
+ssize_t fs_lookup(FileSystem *fs, const char *path) {
+    if (!fs->disk || !path)
+        return -1;
+
+    uint32_t type;
+    pthread_rwlock_rdlock(&fs->dir_lock);
+    ssize_t inode_number = dir_resolve(fs, path, &type);
+    pthread_rwlock_unlock(&fs->dir_lock);
+    return inode_number;
+}
+
+/**
+ * Create directory at absolute path by doing the following:
+ *
+ *  1. Resolve parent directory (creating the root directory on first use).
+ *
+ *  2. Check that the name is not already in use.
+ *
+ *  3. Allocate directory Inode with an empty hashed index.
+ *
+ *  4. Add entry for the new directory to its parent.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       path            Absolute path of new directory.
+ * @return      Inode number of new directory (-1 on failure).
+ **/
+ssize_t fs_mkdir(FileSystem *fs, const char *path) {
+    if (!fs->disk || !path)
+        return -1;
+
+    char     name[DIR_NAME_MAX];
+    uint32_t type;
+    ssize_t  inode_number = -1;
+
+    pthread_rwlock_wrlock(&fs->dir_lock);
+    ssize_t parent = dir_walk(fs, path, name, true);
+    if (parent >= 0 && name[0] && dir_lookup(fs, parent, name, &type) < 0 &&
+        journal_start(fs, JOURNAL_INODE_CREDITS + JOURNAL_DIR_CREDITS)) {
+        inode_number = dir_make(fs);
+        if (inode_number >= 0 && !dir_insert(fs, parent, name, inode_number, INODE_DIRECTORY)) {
+            inode_delete(fs, inode_number);
+            inode_number = -1;
+        }
+        journal_stop(fs);
+    }
+    pthread_rwlock_unlock(&fs->dir_lock);
+    return inode_number;
+}
+
+/**
+ * Create empty file at absolute path (creating the root directory on first
+ * use).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       path            Absolute path of new file.
+ * @return      Inode number of new file (-1 on failure).
+ **/
+ssize_t fs_create_path(FileSystem *fs, const char *path) {
+    if (!fs->disk || !path)
+        return -1;
+
+    char     name[DIR_NAME_MAX];
+    uint32_t type;
+    ssize_t  inode_number = -1;
+
+    pthread_rwlock_wrlock(&fs->dir_lock);
+    ssize_t parent = dir_walk(fs, path, name, true);
+    if (parent >= 0 && name[0] && dir_lookup(fs, parent, name, &type) < 0 &&
+        journal_start(fs, JOURNAL_INODE_CREDITS + JOURNAL_DIR_CREDITS)) {
+        pthread_mutex_lock(&fs->table_lock);
+        inode_number = inode_create(fs, INODE_FILE);
+        pthread_mutex_unlock(&fs->table_lock);
+        if (inode_number >= 0 && !dir_insert(fs, parent, name, inode_number, INODE_FILE)) {
+            inode_delete(fs, inode_number);
+            inode_number = -1;
+        }
+        journal_stop(fs);
+    }
+    pthread_rwlock_unlock(&fs->dir_lock);
+    return inode_number;
+}
+
+/**
+ * Remove file or empty directory at absolute path by removing its entry from
+ * its parent directory and then removing its Inode (fails while the Inode has
+ * open File handles).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       path            Absolute path to remove (not the root directory).
+ * @return      Whether or not the path was removed.
+ **/
+bool    fs_unlink(FileSystem *fs, const char *path) {
+    if (!fs->disk || !path)
+        return false;
+
+    char     name[DIR_NAME_MAX];
+    uint32_t type;
+    bool     result = false;
+
+    pthread_rwlock_wrlock(&fs->dir_lock);
+    ssize_t parent = dir_walk(fs, path, name, false);
+    ssize_t inode_number = (parent >= 0 && name[0]) ? dir_lookup(fs, parent, name, &type) : -1;
+    if (inode_number >= 0 && !inode_opened(fs, inode_number) && (type != INODE_DIRECTORY || dir_count(fs, inode_number) == 0) &&
+        journal_start(fs, JOURNAL_INODE_CREDITS + JOURNAL_DIR_CREDITS)) {
+        result = dir_delete(fs, parent, name) && inode_delete(fs, inode_number);
+        journal_stop(fs);
+    }
+    pthread_rwlock_unlock(&fs->dir_lock);
+    return result;
+}
+
+/**
+ * List entries of directory at absolute path (in hash order).  The root
+ * directory lists as empty until it is created.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       path            Absolute path of directory.
+ * @param       count           Set to number of entries listed.
+ * @return      Newly allocated array of entries (NULL on failure).
+ **/
+DirEntry *fs_readdir(FileSystem *fs, const char *path, size_t *count) {
+    if (!fs->disk || !path || !count)
+        return NULL;
+
+    uint32_t  type;
+    DirEntry *entries = NULL;
+    *count = 0;
+
+    pthread_rwlock_rdlock(&fs->dir_lock);
+    ssize_t dir = dir_resolve(fs, path, &type);
+    if (dir < 0 && path[0] == '/' && !path[strspn(path, "/")] && dir_root(fs, false) < 0)
+        entries = calloc(1, sizeof(DirEntry));
+    if (dir >= 0 && type == INODE_DIRECTORY) {
+        inode_lock(fs, dir, false);
+        Block root;
+        File *file = dir_open(fs, dir, &root);
+        if (file) {
+            entries = calloc(root.index.entries + 1, sizeof(DirEntry));
+        }
+
+        /* visit every leaf through the index */
+        bool result = entries != NULL;
+        for (size_t r = 0; result && r < root.index.count; r++) {
+            Block  index;
+            size_t nleaves = 1;
+            if (root.index.levels) {
+                result  = dir_read(file, root.index.children[r].block, &index);
+                nleaves = index.index.count;
+            }
+
+            for (size_t c = 0; result && c < nleaves; c++) {
+                Block leaf;
+                size_t lblock = root.index.levels ? index.index.children[c].block : root.index.children[r].block;
+                result = dir_read(file, lblock, &leaf);
+                for (size_t e = 0; result && e < DIR_ENTRIES; e++) {
+                    if (!leaf.dirents[e].type)
+                        continue;
+                    if (*count == root.index.entries) {
+                        result = false;
+                        break;
+                    }
+                    entries[(*count)++] = leaf.dirents[e];
+                }
+            }
+        }
+
+        if (!result) {
+            free(entries);
+            entries = NULL;
+            *count  = 0;
+        }
+        if (file)
+            file_close(file);
+        inode_unlock(fs, dir);
+    }
+    pthread_rwlock_unlock(&fs->dir_lock);
+    return entries;
+}
+
+/* Internal Functions */
+
+/**
+ *
+ * the GIMME_BLOCK function scans the free block bitmap a word at a time
+ * (starting from the free hint, under the allocator lock) and GIMMES the
+ * lowest avaliable block to the caller!! :) happi pandaA
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      first avaliable Block to write to (-1 on nothing found).
+ *
+ * */
+
+size_t gimme_block(FileSystem *fs){
+
+    size_t block = -1;
+    pthread_mutex_lock(&fs->alloc_lock);
+
+    for (size_t w = fs->free_hint; w < fs->free_words; w++){
+
+        uint64_t word = fs->free_blocks[w];
+        if (word){
+
+            size_t bit = __builtin_ctzll(word);
+            fs->free_blocks[w] = word & (word - 1);
+            fs->free_hint = w;
+            block = w * BITS_PER_WORD + bit;
+            break;
+        }
+    }
+
+    if (block == -1)
+        fs->free_hint = fs->free_words;
+
+    pthread_mutex_unlock(&fs->alloc_lock);
+    return block;
+
+}
+
+/**
+ * Mark block as in use in the free block bitmap (ignoring invalid blocks).
+ *
+ * Note: The allocator lock must be held once the FileSystem is mounted.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       block           Block number to mark.
+ **/
+void   claim_block(FileSystem *fs, size_t block) {
+    if (block < fs->meta_data.blocks)
+        fs->free_blocks[block / BITS_PER_WORD] &= ~(1ULL << (block % BITS_PER_WORD));
+}
+
+/**
+ * Mark block as free in the free block bitmap (and lower the free hint so the
+ * block is found by the next allocation).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       block           Block number to mark.
+ **/
+void   release_block(FileSystem *fs, size_t block) {
+    if (block >= fs->meta_data.blocks)
+        return;
+
+    pthread_mutex_lock(&fs->alloc_lock);
+    fs->free_blocks[block / BITS_PER_WORD] |= 1ULL << (block % BITS_PER_WORD);
+    fs->free_hint = min(fs->free_hint, block / BITS_PER_WORD);
+    pthread_mutex_unlock(&fs->alloc_lock);
+}
+
+/**
+ * Allocate free block bitmap for SuperBlock with every data block marked free
+ * (the superblock, inode blocks, journal blocks, and bitmap blocks are always
+ * in use).
+ *
+ * Note: The bitmap is padded to cover whole bitmap blocks.
+ *
+ * @param       super           Pointer to SuperBlock structure.
+ * @param       words           Set to number of words covering the disk (if not NULL).
+ * @return      Pointer to newly allocated bitmap (NULL on failure).
+ **/
+uint64_t *bitmap_create(const SuperBlock *super, size_t *words) {
+    size_t nwords = (super->blocks + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    size_t nalloc = max(nwords, (size_t)super->bitmap_blocks * WORDS_PER_BLOCK);
+
+    uint64_t *bitmap = calloc(nalloc, sizeof(uint64_t));
+    if (!bitmap)
+        return NULL;
+
+    size_t start = 1 + super->inode_blocks;
+    size_t end   = super->blocks - super->bitmap_blocks - super->journal_blocks;
+    for (size_t b = start; b < end; b++) {
+        if (b % BITS_PER_WORD == 0 && b + BITS_PER_WORD <= end) {
+            bitmap[b / BITS_PER_WORD] = ~0ULL;
+            b += BITS_PER_WORD - 1;
+        } else {
+            bitmap[b / BITS_PER_WORD] |= 1ULL << (b % BITS_PER_WORD);
+        }
+    }
+
+    if (words)
+        *words = nwords;
+    return bitmap;
+}
+
+/**
+ * Write free block bitmap to the blocks reserved for it at the end of disk
+ * (nothing to do for file systems without reserved bitmap blocks).
+ *
+ * @param       disk            Pointer to Disk structure.
+ * @param       super           Pointer to SuperBlock structure.
+ * @param       bitmap          Free block bitmap.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool   bitmap_store(Disk *disk, const SuperBlock *super, uint64_t *bitmap) {
+    size_t start = super->blocks - super->bitmap_blocks;
+
+    for (size_t i = 0; i < super->bitmap_blocks; i++) {
+        if (disk_write(disk, start + i, (char *)(bitmap + i * WORDS_PER_BLOCK)) == DISK_FAILURE)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Load free block bitmap from the blocks reserved for it at the end of disk.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool   bitmap_load(FileSystem *fs) {
+    size_t start = fs->meta_data.blocks - fs->meta_data.bitmap_blocks;
+
+    for (size_t i = 0; i < fs->meta_data.bitmap_blocks; i++) {
+        if (disk_read(fs->disk, start + i, (char *)(fs->free_blocks + i * WORDS_PER_BLOCK)) == DISK_FAILURE)
+            return false;
+    }
+
+    /* superblock, inode, journal, and bitmap blocks are never free */
+    for (size_t b = 0; b <= fs->meta_data.inode_blocks; b++)
+        claim_block(fs, b);
+    for (size_t b = start - fs->meta_data.journal_blocks; b < fs->meta_data.blocks; b++)
+        claim_block(fs, b);
+
+    return true;
+}
+
+/**
+ * Rebuild free block bitmap by marking every block referenced by a valid Inode
+ * (directly or through its indirect block) as in use.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool   bitmap_scan(FileSystem *fs) {
+    for (int i = 1; i <= fs->meta_data.inode_blocks; i++) {
+
+        /* read inode block */
+        Block B;
+        if (disk_read(fs->disk, i, B.data) == DISK_FAILURE)
+            return false;
+
+        /* check inodes in block */
+        for (int j = 0; j < INODES_PER_BLOCK; j++) {
+            
+            /* if valid inode, check extents */
+            if (B.inodes[j].valid && fs->meta_data.version >= FS_VERSION_EXTENTS) {
+                Block spill;
+                if (B.inodes[j].spill) {
+                    if (disk_read(fs->disk, B.inodes[j].spill, spill.data) == DISK_FAILURE)
+                        return false;
+
+                    claim_block(fs, B.inodes[j].spill);
+                }
+
+                for (size_t e = 0; e < B.inodes[j].nextents; e++) {
+                    Extent *extent = extent_at(&B.inodes[j], &spill, e);
+                    for (size_t b = 0; b < extent->length; b++)
+                        claim_block(fs, extent->start + b);
+                }
+
+            /* if valid inode, check ptrs */
+            } else if (B.inodes[j].valid) {
+
+                /* check direct */
+                for (int k = 0; k < POINTERS_PER_INODE; k++) {
+
+                    /* if ptr being used, mark block */
+                    if (B.inodes[j].direct[k]) 
+                        claim_block(fs, B.inodes[j].direct[k]);
+                }
+
+                /* check indirect */
+                if (B.inodes[j].indirect) {
+                    Block iblock;
+                    if (disk_read(fs->disk, B.inodes[j].indirect, iblock.data) == DISK_FAILURE)
+                        return false;
+
+                    /* mark ptr block */
+                    claim_block(fs, B.inodes[j].indirect);
+
+                    /* check ptr block */
+                    for (int p = 0; p < POINTERS_PER_BLOCK; p++) {
+
+                        /* mark block */
+                        if (iblock.pointers[p])
+                            claim_block(fs, iblock.pointers[p]);
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Write FileSystem meta data to the SuperBlock and write back all dirty
+ * blocks (so the clean flag never reaches disk before the bitmap does).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool   superblock_store(FileSystem *fs) {
+    Block block = {{0}};
+    block.super = fs->meta_data;
+
+    if (!disk_sync(fs->disk))
+        return false;
+
+    if (disk_write(fs->disk, 0, block.data) == DISK_FAILURE)
+        return false;
+
+    return disk_sync(fs->disk);
+}
+
+/**
+ * Allocate a run of up to want contiguous blocks as close after goal as
+ * possible by doing the following:
+ *
+ *  1. Take the run starting at goal if goal is free.
+ *
+ *  2. Otherwise take the first free run after goal with at least need blocks
+ *  (wrapping around to the start of the disk), or the longest run seen if
+ *  none is found within GOAL_SEARCH_RUNS runs.
+ *
+ *  Note: A goal of 0 (no goal) starts from the lowest free block.  The
+ *  search is done under the allocator lock.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       goal            Preferred first block of run (0 for none).
+ * @param       need            Minimum number of blocks wanted in run.
+ * @param       want            Maximum number of blocks to allocate.
+ * @param       got             Set to number of blocks allocated.
+ * @return      First block of run (-1 on nothing found).
+ **/
+size_t gimme_goal(FileSystem *fs, size_t goal, size_t need, size_t want, size_t *got) {
+    pthread_mutex_lock(&fs->alloc_lock);
+
+    if (!goal || goal >= fs->meta_data.blocks)
+        goal = fs->free_hint * BITS_PER_WORD;
+
+    size_t best_start = -1;
+    size_t best_count = 0;
+    size_t runs       = 0;
+    size_t b          = bitmap_next(fs, goal, fs->meta_data.blocks);
+    bool   wrapped    = false;
+
+    need = min(need, want);
+    while (runs < GOAL_SEARCH_RUNS) {
+
+        /* wrap around to start of disk */
+        if (b == -1) {
+            if (wrapped || goal == 0)
+                break;
+            wrapped = true;
+            b = bitmap_next(fs, 0, goal);
+            continue;
+        }
+
+        size_t count = bitmap_run(fs, b, want);
+        if (count > best_count) {
+            best_start = b;
+            best_count = count;
+        }
+        if (count >= need || b == goal)
+            break;
+
+        runs++;
+        b = bitmap_next(fs, b + count, wrapped ? goal : fs->meta_data.blocks);
+    }
+
+    for (size_t i = 0; i < best_count; i++)
+        claim_block(fs, best_start + i);
+
+    pthread_mutex_unlock(&fs->alloc_lock);
+    *got = best_count;
+    return best_start;
+}
+
+/**
+ * Return first free block in the free block bitmap at or after from and
+ * before end.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       from            Block number to start search from.
+ * @param       end             Block number to end search at.
+ * @return      First free block (-1 on nothing found).
+ **/
+size_t bitmap_next(FileSystem *fs, size_t from, size_t end) {
+    end = min(end, fs->free_words * BITS_PER_WORD);
+
+    for (size_t w = from / BITS_PER_WORD; w * BITS_PER_WORD < end; w++) {
+        uint64_t word = fs->free_blocks[w];
+        if (w == from / BITS_PER_WORD)
+            word &= ~0ULL << (from % BITS_PER_WORD);
+
+        if (word) {
+            size_t block = w * BITS_PER_WORD + __builtin_ctzll(word);
+            return (block < end) ? block : -1;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Return number of free blocks (up to want) in the run starting at block,
+ * counting a bitmap word at a time.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       block           First block of run.
+ * @param       want            Maximum number of blocks to count.
+ * @return      Number of contiguous free blocks.
+ **/
+size_t bitmap_run(FileSystem *fs, size_t block, size_t want) {
+    size_t n = 0;
+
+    while (n < want) {
+        size_t b     = block + n;
+        size_t bit   = b % BITS_PER_WORD;
+        uint64_t word = (b / BITS_PER_WORD < fs->free_words) ? fs->free_blocks[b / BITS_PER_WORD] >> bit : 0;
+        size_t ones  = (~word) ? __builtin_ctzll(~word) : BITS_PER_WORD;
+
+        n += min(ones, want - n);
+        if (ones < BITS_PER_WORD - bit)
+            break;
+    }
+
+    return n;
+}
+
+/**
+ * Return extent at index in Inode (indices past EXTENTS_PER_INODE live in the
+ * spill block).
+ *
+ * @param       inode           Pointer to Inode structure.
+ * @param       spill           Pointer to spill Block.
+ * @param       index           Index of extent.
+ * @return      Pointer to Extent.
+ **/
+Extent *extent_at(Inode *inode, Block *spill, size_t index) {
+    if (index < EXTENTS_PER_INODE)
+        return &inode->extents[index];
+
+    return &spill->extents[index - EXTENTS_PER_INODE];
+}
+
+/**
+ * Return number of blocks mapped by Inode extents.
+ *
+ * @param       inode           Pointer to Inode structure.
+ * @param       spill           Pointer to spill Block.
+ * @return      Number of blocks mapped.
+ **/
+size_t extent_blocks(Inode *inode, Block *spill) {
+    size_t blocks = 0;
+
+    for (size_t e = 0; e < inode->nextents; e++)
+        blocks += extent_at(inode, spill, e)->length;
+
+    return blocks;
+}
+
+/**
+ * Append run of blocks to end of Inode extents (growing the last extent if the
+ * run is contiguous with it, and allocating a spill block when the extents in
+ * the Inode are full).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       inode           Pointer to Inode structure.
+ * @param       spill           Pointer to spill Block.
+ * @param       start           First block of run.
+ * @param       length          Number of blocks in run.
+ * @return      Whether or not the run was appended.
+ **/
+bool   extent_append(FileSystem *fs, Inode *inode, Block *spill, size_t start, size_t length) {
+
+    /* grow last extent */
+    if (inode->nextents) {
+        Extent *last = extent_at(inode, spill, inode->nextents - 1);
+        if (last->start + last->length == start) {
+            last->length += length;
+            return true;
+        }
+    }
+
+    if (inode->nextents == EXTENTS_PER_INODE + EXTENTS_PER_BLOCK)
+        return false;
+
+    /* allocate spill block */
+    if (inode->nextents == EXTENTS_PER_INODE && !inode->spill) {
+        size_t b = gimme_block(fs);
+        if (b == -1)
+            return false;
+
+        inode->spill = b;
+        memset(spill->data, 0, BLOCK_SIZE);
+    }
+
+    /* add extent */
+    Extent *extent = extent_at(inode, spill, inode->nextents++);
+    extent->start  = start;
+    extent->length = length;
+    return true;
+}
+
+/**
+ * Lock the specified Inode (striped over FS_INODE_LOCKS reader/writer locks).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       inode_number    Inode to lock.
+ * @param       write           Whether to lock for writing (otherwise reading).
+ **/
+void   inode_lock(FileSystem *fs, size_t inode_number, bool write) {
+    pthread_rwlock_t *lock = &fs->inode_locks[inode_number % FS_INODE_LOCKS];
+
+    if (write)
+        pthread_rwlock_wrlock(lock);
+    else
+        pthread_rwlock_rdlock(lock);
+}
+
+/**
+ * Unlock the specified Inode.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       inode_number    Inode to unlock.
+ **/
+void   inode_unlock(FileSystem *fs, size_t inode_number) {
+    pthread_rwlock_unlock(&fs->inode_locks[inode_number % FS_INODE_LOCKS]);
+}
+
+/**
+ * Return whether or not the specified Inode has open File handles (hold the
+ * inode lock for writing to keep new handles from being opened).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       inode_number    Inode to check.
+ * @return      Whether or not the Inode is open.
+ **/
+bool   inode_opened(FileSystem *fs, size_t inode_number) {
+    return __atomic_load_n(&fs->open_counts[inode_number], __ATOMIC_RELAXED) > 0;
+}
+
+/**
+ * Allocate an Inode in the FileSystem Inode table (the table lock must be
+ * held) by searching the Inode table for a free inode (starting from the
+ * inode hint, so full inode blocks are not rescanned) and reserving it.
+ *
+ * @param       fs      Pointer to FileSystem structure.
+ * @param       type    Type of Inode (INODE_FILE or INODE_DIRECTORY).
+ * @return      Inode number of allocated Inode (-1 on failure).
+ **/
+ssize_t inode_create(FileSystem *fs, uint32_t type) {
+
+    Block B;
+
+    /* search free node list */
+    for (int block = fs->inode_hint; block < fs->meta_data.inode_blocks; block++) {
+
+
+        /* read inode block */
+        if(!journal_read(fs, block + 1, B.data))
+            return -1;
+
+        /* find free inode in table */
+        for (int i = 0; i < INODES_PER_BLOCK; i++) {
+
+            if (!B.inodes[i].valid) {
+
+                /* mark as in use */
+                B.inodes[i].valid = type;
+               
+                /* write back to disk */
+                if(!journal_write(fs, block + 1, B.data))
+                    return -1;
+
+                fs->inode_hint = block;
+
+                /* return inode number */
+                return i + (block * INODES_PER_BLOCK);
+            }
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Remove Inode and release its blocks (the inode lock must be held for
+ * writing and the table lock must be held).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       inode_number    Inode to remove.
+ * @return      Whether or not removing the specified Inode was successful.
+ **/
+bool   inode_remove(FileSystem *fs, size_t inode_number) {
+
+    size_t iblock = inode_number / INODES_PER_BLOCK;
+    size_t inum   = inode_number % INODES_PER_BLOCK;
+    Block block;
+
+    /* read in inode block */
+    if (!journal_read(fs, iblock + 1, block.data))
+        return false;
+
+    /* check if valid first */
+    if (block.inodes[inum].valid && fs->meta_data.version >= FS_VERSION_EXTENTS) {
+        Inode *inode = &block.inodes[inum];
+
+        /* free extents */
+        Block spill;
+        if (inode->spill && !journal_read(fs, inode->spill, spill.data))
+            return false;
+
+        for (size_t e = 0; e < inode->nextents; e++) {
+            Extent *extent = extent_at(inode, &spill, e);
+            journal_free(fs, extent->start, extent->length, inode->valid == INODE_DIRECTORY);
+        }
+
+        /* free spill block */
+        if (inode->spill)
+            journal_free(fs, inode->spill, 1, true);
+
+        /* mark free in table */
+        memset(inode, 0, sizeof(Inode));
+
+        /* write back to disk */
+        if (!journal_write(fs, iblock + 1, block.data))
+            return false;
+
+        fs->inode_hint = min(fs->inode_hint, iblock);
+        return true;
+    } else if (block.inodes[inum].valid) {
+
+        /* free direct blocks */
+        for (int d = 0; d < POINTERS_PER_INODE; d++) {
+            int db = block.inodes[inum].direct[d];
+
+            /* mark db as free */
+            if (db) {
+                release_block(fs, db);
+                block.inodes[inum].direct[d] = 0;
+            }
+        }
+
+        /* free indirect blocks */
+        int ib = block.inodes[inum].indirect;
+        if (ib) {
+            Block ipblock;
+
+            /* read indirect */
+            if (!journal_read(fs, ib, ipblock.data))
+                return false;
+
+            /* free ptrs */
+            for (int p = 0; p < POINTERS_PER_BLOCK; p++) {
+                if (ipblock.pointers[p]) {
+
+                    /* mark data as free */
+                    release_block(fs, ipblock.pointers[p]);
+                    ipblock.pointers[p] = 0;
+                }
+                    
+            }
+
+            /* mark ip as free */
+            release_block(fs, ib);
+            block.inodes[inum].indirect = 0;
+        }
+
+        /* mark free in table */
+        block.inodes[inum].valid = false;
+        block.inodes[inum].size = 0;
+
+        /* write back to disk */
+        if (!journal_write(fs, iblock + 1, block.data))
+            return false;
+
+        fs->inode_hint = min(fs->inode_hint, iblock);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Remove Inode and release its blocks unless it has open File handles (taking
+ * its inode lock and the table lock).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       inode_number    Inode to remove.
+ * @return      Whether or not removing the specified Inode was successful.
+ **/
+bool   inode_delete(FileSystem *fs, size_t inode_number) {
+    inode_lock(fs, inode_number, true);
+    bool result = false;
+    if (!inode_opened(fs, inode_number)) {
+        pthread_mutex_lock(&fs->table_lock);
+        result = inode_remove(fs, inode_number);
+        pthread_mutex_unlock(&fs->table_lock);
+    }
+    inode_unlock(fs, inode_number);
+    return result;
+}
+
+/**
+ * Allocate running transaction and freed runs of journaled FileSystem (the
+ * journal lock protects them).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      Whether or not allocation was successful.
+ **/
+bool   journal_create(FileSystem *fs) {
+    fs->journal_capacity    = min(JOURNAL_BATCH, fs->meta_data.journal_blocks - 1);
+    fs->journal             = calloc(1 + fs->journal_capacity, sizeof(Block));
+    fs->journal_freed       = calloc(fs->journal_capacity, sizeof(Extent));
+    fs->journal_revoked     = calloc(fs->journal_capacity, sizeof(Extent));
+    fs->journal_freed_max   = fs->journal_capacity;
+    fs->journal_revoked_max = fs->journal_capacity;
+    fs->journal_count       = 0;
+    fs->journal_handles     = 0;
+    fs->journal_reserved    = 0;
+    fs->journal_waiting     = 0;
+    fs->journal_nfreed      = 0;
+    fs->journal_nrevoked    = 0;
+    fs->journal_nretired    = 0;
+    fs->journal_head        = 0;
+    fs->journal_sequence = fs->meta_data.journal_sequence;
+    return fs->journal && fs->journal_freed && fs->journal_revoked;
+}
+
+/**
+ * Release running transaction and freed runs of FileSystem.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ **/
+void   journal_delete(FileSystem *fs) {
+    free(fs->journal);
+    free(fs->journal_freed);
+    free(fs->journal_revoked);
+    fs->journal         = NULL;
+    fs->journal_freed   = NULL;
+    fs->journal_revoked = NULL;
+}
+
+/**
+ * Start operation in the running transaction by doing the following:
+ *
+ *  1. Wait for threads committing the transaction.
+ *
+ *  2. If the blocks already logged and reserved leave no room for the blocks
+ *  the operation may log, commit the transaction once no operation is
+ *  running in it (waiting for running operations to stop).
+ *
+ *  3. Reserve room for the blocks (until no operation is running).
+ *
+ * Note: The transaction is only committed between operations (so a crash
+ * never leaves half of an operation on disk), so operations must start
+ * before taking any inode lock and must not start while running.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       credits         Number of blocks the operation may log.
+ * @return      Whether or not the operation was started.
+ **/
+bool   journal_start(FileSystem *fs, size_t credits) {
+    if (!fs->journal)
+        return true;
+
+    pthread_mutex_lock(&fs->journal_lock);
+    credits = min(credits, fs->journal_capacity);
+    while (fs->journal_waiting || fs->journal_count + fs->journal_reserved + credits > fs->journal_capacity) {
+        if (fs->journal_waiting || fs->journal_handles) {
+            pthread_cond_wait(&fs->journal_idle, &fs->journal_lock);
+        } else if (!journal_commit(fs)) {
+            pthread_mutex_unlock(&fs->journal_lock);
+            return false;
+        }
+    }
+
+    fs->journal_handles++;
+    fs->journal_reserved += credits;
+    pthread_mutex_unlock(&fs->journal_lock);
+    return true;
+}
+
+/**
+ * Stop operation started by journal_start.  Once no operation is running,
+ * reservations are dropped, waiting threads are woken up, and the
+ * transaction is committed if it freed any blocks (so they are released for
+ * reuse right away).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ **/
+void   journal_stop(FileSystem *fs) {
+    if (!fs->journal)
+        return;
+
+    pthread_mutex_lock(&fs->journal_lock);
+    if (--fs->journal_handles == 0) {
+        fs->journal_reserved = 0;
+        if (fs->journal_nfreed && !fs->journal_waiting)
+            journal_commit(fs);
+        pthread_cond_broadcast(&fs->journal_idle);
+    }
+    pthread_mutex_unlock(&fs->journal_lock);
+}
+
+/**
+ * Read metadata block (from the running transaction if it was logged there,
+ * otherwise from Disk).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       block           Block number to read.
+ * @param       data            Data buffer (BLOCK_SIZE).
+ * @return      Whether or not the read was successful.
+ **/
+bool   journal_read(FileSystem *fs, size_t block, char *data) {
+    if (fs->journal) {
+        pthread_mutex_lock(&fs->journal_lock);
+        for (size_t i = 0; i < fs->journal_count; i++) {
+            if (fs->journal[0].journal.tags[i] == block) {
+                memcpy(data, fs->journal[1 + i].data, BLOCK_SIZE);
+                pthread_mutex_unlock(&fs->journal_lock);
+                return true;
+            }
+        }
+        pthread_mutex_unlock(&fs->journal_lock);
+    }
+
+    return disk_read(fs->disk, block, data) != DISK_FAILURE;
+}
+
+/**
+ * Write metadata block by doing the following:
+ *
+ *  1. Write it to Disk if the FileSystem has no journal.
+ *
+ *  2. Otherwise, log it in the running transaction (replacing an earlier
+ *  copy logged by the same transaction), committing the transaction first if
+ *  it is full and no operation is running in it (an operation that logs more
+ *  blocks than it reserved fails instead).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       block           Block number to write.
+ * @param       data            Data buffer (BLOCK_SIZE).
+ * @return      Whether or not the write was successful.
+ **/
+bool   journal_write(FileSystem *fs, size_t block, char *data) {
+    if (!fs->journal)
+        return disk_write(fs->disk, block, data) != DISK_FAILURE;
+
+    pthread_mutex_lock(&fs->journal_lock);
+
+    /* find earlier copy in running transaction */
+    size_t i = 0;
+    while (i < fs->journal_count && fs->journal[0].journal.tags[i] != block)
+        i++;
+
+    /* commit full transaction */
+    if (i == fs->journal_capacity) {
+        if (fs->journal_handles || !journal_commit(fs)) {
+            pthread_mutex_unlock(&fs->journal_lock);
+            return false;
+        }
+        i = 0;
+    }
+
+    /* log block */
+    if (i == fs->journal_count)
+        fs->journal[0].journal.tags[fs->journal_count++] = block;
+    memcpy(fs->journal[1 + i].data, data, BLOCK_SIZE);
+
+    pthread_mutex_unlock(&fs->journal_lock);
+    return true;
+}
+
+/**
+ * Commit the running transaction (the journal lock must be held) by doing the
+ * following:
+ *
+ *  1. Checkpoint the journal if the transaction does not fit after the
+ *  journal head.
+ *
+ *  2. Write the transaction header (with a checksum, so torn transactions are
+ *  not replayed) and every logged block with one sequential vectored write.
+ *
+ *  3. Write logged blocks to their home locations through the block cache
+ *  (which writes them back lazily) and release blocks freed by the
+ *  transaction for reuse.
+ *
+ * Note: No operation may be running in the transaction.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      Whether or not the transaction was committed.
+ **/
+bool   journal_commit(FileSystem *fs) {
+    size_t count = fs->journal_count;
+    if (!count) {
+        journal_release(fs);
+        return true;
+    }
+
+    /* checkpoint full journal */
+    if (fs->journal_head + 1 + count > fs->meta_data.journal_blocks && !journal_checkpoint(fs))
+        return false;
+
+    /* write transaction */
+    JournalHeader *header = &fs->journal[0].journal;
+    header->magic    = JOURNAL_MAGIC;
+    header->sequence = fs->journal_sequence;
+    header->count    = count;
+    header->checksum = journal_checksum(fs->journal, count);
+
+    char *buffers[1 + JOURNAL_BATCH];
+    for (size_t i = 0; i <= count; i++)
+        buffers[i] = fs->journal[i].data;
+
+    size_t start = fs->meta_data.blocks - fs->meta_data.bitmap_blocks - fs->meta_data.journal_blocks;
+    if (disk_writev(fs->disk, start + fs->journal_head, buffers, 1 + count) == DISK_FAILURE)
+        return false;
+
+    fs->journal_head += 1 + count;
+    fs->journal_sequence++;
+    fs->journal_commits++;
+
+    /* write logged blocks back lazily */
+    bool result = true;
+    for (size_t i = 0; i < count; i++) {
+        if (disk_write(fs->disk, header->tags[i], fs->journal[1 + i].data) == DISK_FAILURE)
+            result = false;
+    }
+    fs->journal_count = 0;
+    journal_release(fs);
+    return result;
+}
+
+/**
+ * Release blocks freed by the committed transaction to the free block bitmap
+ * (the journal lock must be held) and mark the logged blocks it freed as
+ * freed by a committed transaction.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ **/
+void   journal_release(FileSystem *fs) {
+    for (size_t r = 0; r < fs->journal_nfreed; r++) {
+        for (size_t b = 0; b < fs->journal_freed[r].length; b++)
+            release_block(fs, fs->journal_freed[r].start + b);
+    }
+    fs->journal_nfreed   = 0;
+    fs->journal_nretired = fs->journal_nrevoked;
+}
+
+/**
+ * Checkpoint the journal (the journal lock must be held) by writing back all
+ * dirty blocks (so every committed transaction reaches its home locations)
+ * and recording in the SuperBlock that replay starts with the running
+ * transaction at the start of the journal.
+ *
+ * Note: Metadata blocks freed by committed transactions are forgotten, while
+ * those freed by the running transaction are only forgotten if it logged
+ * nothing (otherwise it may have logged them).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool   journal_checkpoint(FileSystem *fs) {
+    if (!disk_sync(fs->disk))
+        return false;
+
+    fs->meta_data.journal_sequence = fs->journal_sequence;
+    fs->journal_head = 0;
+    if (!fs->journal_count)
+        fs->journal_nretired = fs->journal_nrevoked;
+    fs->journal_nrevoked -= fs->journal_nretired;
+    memmove(fs->journal_revoked, fs->journal_revoked + fs->journal_nretired, fs->journal_nrevoked * sizeof(Extent));
+    fs->journal_nretired = 0;
+    return superblock_store(fs);
+}
+
+/**
+ * Replay committed transactions from the journal by doing the following:
+ *
+ *  1. Read each transaction header starting at the beginning of the journal
+ *  and stop at the first one without the expected sequence number.
+ *
+ *  2. Read the logged blocks and stop if the checksum does not match (the
+ *  transaction was torn by a crash).
+ *
+ *  3. Write the logged blocks to their home locations.
+ *
+ *  4. Write back all dirty blocks and start the running transaction after
+ *  the last replayed one.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool   journal_replay(FileSystem *fs) {
+    size_t start = fs->meta_data.blocks - fs->meta_data.bitmap_blocks - fs->meta_data.journal_blocks;
+    size_t head  = 0;
+    Block *transaction = fs->journal;
+
+    while (head + 1 < fs->meta_data.journal_blocks) {
+
+        /* read header */
+        JournalHeader *header = &transaction[0].journal;
+        if (disk_read(fs->disk, start + head, transaction[0].data) == DISK_FAILURE)
+            return false;
+
+        size_t count = header->count;
+        if (header->magic != JOURNAL_MAGIC || header->sequence != fs->journal_sequence ||
+            !count || count > fs->journal_capacity || head + 1 + count > fs->meta_data.journal_blocks)
+            break;
+
+        /* read logged blocks and check checksum */
+        char *buffers[JOURNAL_BATCH];
+        for (size_t i = 0; i < count; i++)
+            buffers[i] = transaction[1 + i].data;
+        if (disk_readv(fs->disk, start + head + 1, buffers, count) == DISK_FAILURE)
+            return false;
+
+        if (header->checksum != journal_checksum(transaction, count))
+            break;
+
+        /* write logged blocks to home locations */
+        for (size_t i = 0; i < count; i++) {
+            if (header->tags[i] >= fs->meta_data.blocks)
+                return false;
+            if (disk_write(fs->disk, header->tags[i], transaction[1 + i].data) == DISK_FAILURE)
+                return false;
+        }
+
+        head += 1 + count;
+        fs->journal_sequence++;
+    }
+
+    memset(transaction[0].data, 0, BLOCK_SIZE);
+    fs->meta_data.journal_sequence = fs->journal_sequence;
+    return disk_sync(fs->disk);
+}
+
+/**
+ * Free run of blocks (releasing it to the bitmap right away if the FileSystem
+ * has no journal, and otherwise once the running transaction commits, so
+ * data written to the blocks never reaches disk before the free is durable).
+ *
+ * Note: A run that cannot be recorded stays in use.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       start           First block of run.
+ * @param       length          Number of blocks in run.
+ * @param       logged          Whether run holds metadata that may have been
+ *                              logged (so replay could overwrite its reuse).
+ **/
+void   journal_free(FileSystem *fs, size_t start, size_t length, bool logged) {
+    if (!fs->journal) {
+        for (size_t b = 0; b < length; b++)
+            release_block(fs, start + b);
+        return;
+    }
+
+    pthread_mutex_lock(&fs->journal_lock);
+    if (!logged || journal_append(&fs->journal_revoked, &fs->journal_nrevoked, &fs->journal_revoked_max, start, length))
+        journal_append(&fs->journal_freed, &fs->journal_nfreed, &fs->journal_freed_max, start, length);
+    pthread_mutex_unlock(&fs->journal_lock);
+}
+
+/**
+ * Prepare run of blocks for reuse by checkpointing the journal if any of the
+ * blocks held metadata logged since the last checkpoint (so replay never
+ * overwrites the new contents).
+ *
+ * Note: Blocks freed by the running transaction are not released until it
+ * commits, so reuse never has to commit operations that are still running.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       start           First block of run.
+ * @param       length          Number of blocks in run.
+ **/
+void   journal_reuse(FileSystem *fs, size_t start, size_t length) {
+    if (!fs->journal)
+        return;
+
+    pthread_mutex_lock(&fs->journal_lock);
+    if (journal_overlaps(fs->journal_revoked, fs->journal_nrevoked, start, length))
+        journal_checkpoint(fs);
+    pthread_mutex_unlock(&fs->journal_lock);
+}
+
+/**
+ * Append run of blocks to array of runs (merging it into the last run if they
+ * are adjacent, and doubling the array if it is full).
+ *
+ * @param       runs            Pointer to array of runs.
+ * @param       nruns           Pointer to number of runs in array.
+ * @param       capacity        Pointer to maximum number of runs in array.
+ * @param       start           First block of run.
+ * @param       length          Number of blocks in run.
+ * @return      Whether or not the run was appended (false on failure).
+ **/
+bool   journal_append(Extent **runs, size_t *nruns, size_t *capacity, size_t start, size_t length) {
+    Extent *last = *nruns ? &(*runs)[*nruns - 1] : NULL;
+    if (last && last->start + last->length == start) {
+        last->length += length;
+        return true;
+    }
+
+    if (*nruns == *capacity) {
+        Extent *grown = realloc(*runs, 2 * *capacity * sizeof(Extent));
+        if (!grown)
+            return false;
+        *runs      = grown;
+        *capacity *= 2;
+    }
+
+    (*runs)[*nruns].start  = start;
+    (*runs)[*nruns].length = length;
+    (*nruns)++;
+    return true;
+}
+
+/**
+ * Check whether run of blocks overlaps any run in array.
+ *
+ * @param       runs            Array of runs.
+ * @param       nruns           Number of runs in array.
+ * @param       start           First block of run.
+ * @param       length          Number of blocks in run.
+ * @return      Whether or not the run overlaps a run in the array.
+ **/
+bool   journal_overlaps(Extent *runs, size_t nruns, size_t start, size_t length) {
+    for (size_t i = 0; i < nruns; i++) {
+        if (start < runs[i].start + runs[i].length && runs[i].start < start + length)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Compute checksum (FNV-1a over 32-bit words) of transaction sequence number,
+ * tags, and logged blocks.
+ *
+ * @param       transaction     Transaction header followed by logged blocks.
+ * @param       count           Number of logged blocks.
+ * @return      Checksum of transaction.
+ **/
+uint32_t journal_checksum(Block *transaction, size_t count) {
+    JournalHeader *header = &transaction[0].journal;
+    uint32_t       hash   = (2166136261u ^ header->sequence) * 16777619u;
+
+    for (size_t i = 0; i < count; i++)
+        hash = (hash ^ header->tags[i]) * 16777619u;
+
+    for (size_t b = 1; b <= count; b++) {
+        for (size_t i = 0; i < POINTERS_PER_BLOCK; i++)
+            hash = (hash ^ transaction[b].pointers[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Open the specified Inode (its inode lock must be held) by doing the
+ * following:
+ *
+ *  1. Load and check status of Inode.
+ *
+ *  2. Load indirect block (or extent spill block).
+ *
+ *  3. Decode logical to physical block map.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       inode_number    Inode to open.
+ * @return      Pointer to newly allocated File handle (NULL on failure).
+ **/
+File * file_open(FileSystem *fs, size_t inode_number) {
+    if (!fs->disk || inode_number >= fs->meta_data.inodes)
+        return NULL;
+
+    /* load inode */
+    Block block;
+    if (!journal_read(fs, inode_number / INODES_PER_BLOCK + 1, block.data))
+        return NULL;
+
+    Inode *inode = &block.inodes[inode_number % INODES_PER_BLOCK];
+    if (!inode->valid)
+        return NULL;
+
+    File *file = calloc(1, sizeof(File));
+    if (!file)
+        return NULL;
+
+    file->fs           = fs;
+    file->inode_number = inode_number;
+    file->inode        = *inode;
+
+    /* load indirect or spill block */
+    size_t spill = (fs->meta_data.version >= FS_VERSION_EXTENTS) ? inode->spill : inode->indirect;
+    if (spill && !journal_read(fs, spill, file->spill.data)) {
+        free(file);
+        return NULL;
+    }
+
+    /* decode block map */
+    if (!file_decode(file)) {
+        free(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+/**
+ * Close File handle (its inode lock must be held for writing) by writing back
+ * any changes to its Inode (and indirect or spill block) and releasing it.
+ *
+ * @param       file            Pointer to File handle.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool   file_close(File *file) {
+    bool result = file_flush(file);
+    file_prealloc_drop(file);
+    file_readahead_drop(file);
+    file_readahead_cancel(file);
+    free(file->ra_data);
+    free(file->ra_async);
+    free(file->ra_requests);
+    free(file->map);
+    free(file);
+    return result;
+}
+
+/**
+ * Read from the File (its inode lock must be held) into the data buffer
+ * exactly length bytes beginning from the specified offset by doing the
+ * following:
+ *
+ *  1. Adjust length to size of file.
+ *
+ *  2. Detect sequential access (a read starting where the last one ended)
+ *  and reset readahead on random access (mapped disks rely on the page
+ *  cache for readahead instead).
+ *
+ *  3. Read sequential ranges through the readahead buffer and random ranges
+ *  directly from the mapped blocks.
+ *
+ * @param       file            Pointer to File handle.
+ * @param       data            Buffer to copy data to.
+ * @param       length          Number of bytes to read.
+ * @param       offset          Byte offset from which to begin reading.
+ * @return      Number of bytes read (-1 on error).
+ **/
+ssize_t file_read(File *file, char *data, size_t length, size_t offset) {
+    /* adjust length */
+    if (offset >= file->inode.size)
+        return 0;
+    length = min(length, file->inode.size - offset);
+
+    /* detect sequential access */
+    bool sequential = file->ra_next && offset == file->ra_next;
+    file->ra_next   = offset + length;
+
+    if (!sequential || file->fs->disk->map) {
+        file_readahead_drop(file);
+        file_readahead_cancel(file);
+        file->ra_window = 0;
+        return file_read_blocks(file, data, length, offset);
+    }
+
+    /* read through readahead buffer */
+    size_t lblock = offset / BLOCK_SIZE;
+    size_t data_o = offset % BLOCK_SIZE;
+    size_t nread  = 0;
+
+    while (nread < length) {
+        if ((lblock < file->ra_start || lblock >= file->ra_start + file->ra_count) && !file_readahead(file, lblock))
+            return -1;
+
+        size_t index = lblock - file->ra_start;
+        size_t ncopy = min(BLOCK_SIZE - data_o, length - nread);
+        memcpy(data + nread, file->ra_data + index * BLOCK_SIZE + data_o, ncopy);
+
+        if (index >= file->ra_used) {
+            __atomic_add_fetch(&file->fs->disk->readahead_hits, 1, __ATOMIC_RELAXED);
+            file->ra_used = index + 1;
+        }
+
+        nread += ncopy;
+        data_o = 0;
+        lblock++;
+    }
+
+    return nread;
+}
+
+/**
+ * Write to the File (its inode lock must be held for writing) from the data
+ * buffer exactly length bytes beginning from the specified offset.
+ *
+ *  Note: Data is written to direct blocks first, and then to indirect blocks
+ *  (or a whole extent at a time on FS_VERSION_EXTENTS file systems, which
+ *  allocate contiguous runs of blocks for new data).  Inode changes are
+ *  written back by file_close.
+ *
+ * @param       file            Pointer to File handle.
+ * @param       data            Buffer with data to copy
+ * @param       length          Number of bytes to write.
+ * @param       offset          Byte offset from which to begin writing.
+ * @return      Number of bytes written (-1 on error).
+ **/
+ssize_t file_write(File *file, char *data, size_t length, size_t offset) {
+    file_readahead_drop(file);
+    file_readahead_cancel(file);
+    file->ra_window = 0;
+    file->ra_next   = 0;
+
+    if (file->fs->meta_data.version >= FS_VERSION_EXTENTS)
+        return file_write_extents(file, data, length, offset);
+
+    return file_write_pointers(file, data, length, offset);
+}
+
+/**
+ * Decode logical to physical block map of File from its Inode (and indirect or
+ * spill block) into runs of contiguous blocks (a run starting at block 0 is a
+ * hole).
+ *
+ * @param       file            Pointer to File handle.
+ * @return      Whether or not the map was decoded (false on failure).
+ **/
+bool   file_decode(File *file) {
+    Inode *inode = &file->inode;
+
+    free(file->map);
+    file->map          = NULL;
+    file->nmap         = 0;
+    file->cursor       = 0;
+    file->cursor_block = 0;
+
+    /* copy extents */
+    if (file->fs->meta_data.version >= FS_VERSION_EXTENTS) {
+        file->map = calloc(max(inode->nextents, 1), sizeof(Extent));
+        if (!file->map)
+            return false;
+
+        for (size_t e = 0; e < inode->nextents; e++)
+            file->map[file->nmap++] = *extent_at(inode, &file->spill, e);
+        return true;
+    }
+
+    /* coalesce direct and indirect pointers into runs */
+    size_t npointers = POINTERS_PER_INODE + (inode->indirect ? POINTERS_PER_BLOCK : 0);
+    file->map = calloc(npointers, sizeof(Extent));
+    if (!file->map)
+        return false;
+
+    size_t nused = 0;
+    for (size_t p = 0; p < npointers; p++) {
+        uint32_t pointer = (p < POINTERS_PER_INODE) ? inode->direct[p] : file->spill.pointers[p - POINTERS_PER_INODE];
+        if (pointer)
+            nused = p + 1;
+    }
+
+    for (size_t p = 0; p < nused; p++) {
+        uint32_t pointer = (p < POINTERS_PER_INODE) ? inode->direct[p] : file->spill.pointers[p - POINTERS_PER_INODE];
+        Extent  *last    = file->nmap ? &file->map[file->nmap - 1] : NULL;
+
+        if (last && ((!last->start && !pointer) || (last->start && pointer == last->start + last->length))) {
+            last->length++;
+        } else {
+            file->map[file->nmap].start  = pointer;
+            file->map[file->nmap].length = 1;
+            file->nmap++;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Map logical block of File to block on disk with its cached block map
+ * (starting from the run used last, so sequential access is constant time).
+ *
+ * @param       file            Pointer to File handle.
+ * @param       lblock          Logical block number in file.
+ * @param       run             Set to number of contiguous blocks mapped from lblock (0 if unmapped).
+ * @return      Block on disk (0 if lblock is a hole).
+ **/
+size_t file_map(File *file, size_t lblock, size_t *run) {
+    if (lblock < file->cursor_block) {
+        file->cursor       = 0;
+        file->cursor_block = 0;
+    }
+
+    for (; file->cursor < file->nmap; file->cursor++) {
+        Extent *extent = &file->map[file->cursor];
+        if (lblock < file->cursor_block + extent->length) {
+            *run = file->cursor_block + extent->length - lblock;
+            return extent->start ? extent->start + (lblock - file->cursor_block) : 0;
+        }
+        file->cursor_block += extent->length;
+    }
+
+    *run = 0;
+    return 0;
+}
+
+/**
+ * Write back changes to File Inode (and indirect or spill block), holding the
+ * table lock while updating the Inode table (an Inode that was removed in the
+ * meantime is not written back).
+ *
+ * @param       file            Pointer to File handle.
+ * @return      Whether or not all disk operations were successful.
+ **/
+bool   file_flush(File *file) {
+    FileSystem *fs = file->fs;
+
+    /* write back indirect or spill block */
+    if (file->spill_dirty) {
+        size_t spill = (fs->meta_data.version >= FS_VERSION_EXTENTS) ? file->inode.spill : file->inode.indirect;
+        if (!journal_write(fs, spill, file->spill.data))
+            return false;
+        file->spill_dirty = false;
+    }
+
+    /* write back inode */
+    if (file->inode_dirty) {
+        size_t iblock = file->inode_number / INODES_PER_BLOCK + 1;
+        Block  block;
+        bool   result = false;
+
+        pthread_mutex_lock(&fs->table_lock);
+        if (journal_read(fs, iblock, block.data) && block.inodes[file->inode_number % INODES_PER_BLOCK].valid) {
+            block.inodes[file->inode_number % INODES_PER_BLOCK] = file->inode;
+            result = journal_write(fs, iblock, block.data);
+        }
+        pthread_mutex_unlock(&fs->table_lock);
+
+        if (!result)
+            return false;
+        file->inode_dirty = false;
+    }
+
+    return true;
+}
+
+/**
+ * Read directly from the blocks mapped by File into the data buffer exactly
+ * length bytes beginning from the specified offset by doing the following:
+ *
+ *  1. Map each range of blocks with the cached block map.
+ *
+ *  2. Copy each range with a single memcpy from the mapped image (DISK_MMAP
+ *  disks), or read it a batch of contiguous blocks at a time (holes read as
+ *  zeros).
+ *
+ * @param       file            Pointer to File handle.
+ * @param       data            Buffer to copy data to.
+ * @param       length          Number of bytes to read (within file size).
+ * @param       offset          Byte offset from which to begin reading.
+ * @return      Number of bytes read (-1 on error).
+ **/
+ssize_t file_read_blocks(File *file, char *data, size_t length, size_t offset) {
+    Disk *disk = file->fs->disk;
+
+    size_t lblock = offset / BLOCK_SIZE;
+    size_t data_o = offset % BLOCK_SIZE;
+    size_t nread  = 0;
+
+    while (nread < length) {
+
+        /* map range (unmapped blocks are holes) */
+        size_t run;
+        size_t pblock = file_map(file, lblock, &run);
+        if (!run) {
+            pblock = 0;
+            run    = (length - nread + data_o + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        }
+
+        /* read hole as zeros */
+        if (!pblock) {
+            for (; run && nread < length; run--, lblock++) {
+                size_t ncopy = min(BLOCK_SIZE - data_o, length - nread);
+                memset(data + nread, 0, ncopy);
+                nread += ncopy;
+                data_o = 0;
+            }
+            continue;
+        }
+
+        /* copy range straight from mapped image */
+        size_t nrun    = min(run * BLOCK_SIZE - data_o, length - nread);
+        size_t nblocks = (data_o + nrun + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const char *mapped = disk_map(disk, pblock, nblocks);
+        if (mapped) {
+            memcpy(data + nread, mapped + data_o, nrun);
+            nread  += nrun;
+            lblock += nblocks;
+            data_o  = 0;
+            continue;
+        }
+
+        /* read blocks in range (a batch of contiguous blocks at a time) */
+        while (run && nread < length) {
+            char  *buffers[DISK_IOV_BLOCKS];
+            Block  partial[2];
+            size_t offsets[2], ncopies[2], targets[2];
+            size_t nblocks = 0, npartial = 0;
+
+            while (nblocks < run && nblocks < DISK_IOV_BLOCKS && nread < length) {
+                size_t ncopy = min(BLOCK_SIZE - data_o, length - nread);
+
+                /* full blocks are read directly into data buffer */
+                if (ncopy == BLOCK_SIZE) {
+                    buffers[nblocks] = data + nread;
+                } else {
+                    offsets[npartial] = data_o;
+                    ncopies[npartial] = ncopy;
+                    targets[npartial] = nread;
+                    buffers[nblocks]  = partial[npartial++].data;
+                }
+
+                nread += ncopy;
+                data_o = 0;
+                nblocks++;
+            }
+
+            if (disk_readv(disk, pblock, buffers, nblocks) == DISK_FAILURE)
+                return -1;
+
+            for (size_t p = 0; p < npartial; p++)
+                memcpy(data + targets[p], partial[p].data + offsets[p], ncopies[p]);
+
+            run    -= nblocks;
+            lblock += nblocks;
+            pblock += nblocks;
+        }
+    }
+
+    return nread;
+}
+
+/**
+ * Fill readahead buffer of File starting at specified logical block by doing
+ * the following:
+ *
+ *  1. Drop current readahead buffer.
+ *
+ *  2. Grow readahead window (doubling from READAHEAD_MIN up to
+ *  READAHEAD_MAX blocks).
+ *
+ *  3. If the asynchronous readahead buffer starts at the logical block, wait
+ *  for it and swap it in.
+ *
+ *  4. Otherwise, drop the asynchronous readahead buffer and read window
+ *  (bounded by size of file) with batched vectored reads (the logical block
+ *  itself was a miss, so it is counted as used rather than as a hit).
+ *
+ *  5. Start asynchronous readahead of the following window.
+ *
+ * @param       file            Pointer to File handle.
+ * @param       lblock          Logical block to start readahead from.
+ * @return      Whether or not the readahead buffer was filled.
+ **/
+bool   file_readahead(File *file, size_t lblock) {
+    file_readahead_drop(file);
+
+    /* grow window */
+    size_t window = file->ra_window ? min(file->ra_window * 2, READAHEAD_MAX) : READAHEAD_MIN;
+    size_t blocks = (file->inode.size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    size_t count  = min(window, blocks - lblock);
+    size_t used   = 0;
+
+    if (file->ra_async_count && file->ra_async_start == lblock) {
+        /* swap in asynchronous readahead buffer */
+        if (!file_readahead_wait(file)) {
+            file_readahead_cancel(file);
+            return false;
+        }
+
+        char *ra_data        = file->ra_data;
+        file->ra_data        = file->ra_async;
+        file->ra_async       = ra_data;
+        count                = file->ra_async_count;
+        file->ra_async_count = 0;
+    } else {
+        /* read window (bounded by size of file) */
+        file_readahead_cancel(file);
+
+        char *ra_data = realloc(file->ra_data, window * BLOCK_SIZE);
+        if (!ra_data)
+            return false;
+        file->ra_data = ra_data;
+
+        if (file_read_blocks(file, file->ra_data, min(count * BLOCK_SIZE, file->inode.size - lblock * BLOCK_SIZE), lblock * BLOCK_SIZE) < 0)
+            return false;
+
+        /* logical block was requested before it was read (not a hit) */
+        used = 1;
+    }
+
+    file->ra_window = window;
+    file->ra_start  = lblock;
+    file->ra_count  = count;
+    file->ra_used   = used;
+
+    file_readahead_async(file, lblock + count);
+    return true;
+}
+
+/**
+ * Drop readahead buffer of File (counting prefetched blocks that were never
+ * read as waste).
+ *
+ * @param       file            Pointer to File handle.
+ **/
+void   file_readahead_drop(File *file) {
+    __atomic_add_fetch(&file->fs->disk->readahead_waste, file->ra_count - file->ra_used, __ATOMIC_RELAXED);
+    file->ra_start = 0;
+    file->ra_count = 0;
+    file->ra_used  = 0;
+}
+
+/**
+ * Start asynchronous readahead of the window following the readahead buffer
+ * of File (only on disks with an asynchronous I/O queue) by doing the
+ * following:
+ *
+ *  1. Size asynchronous readahead buffer for the next window (bounded by size
+ *  of file).
+ *
+ *  2. Zero holes and start a read for each run of contiguous blocks.
+ *
+ * @param       file            Pointer to File handle.
+ * @param       lblock          Logical block to start readahead from.
+ **/
+void   file_readahead_async(File *file, size_t lblock) {
+    Disk  *disk   = file->fs->disk;
+    size_t blocks = (file->inode.size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (!disk->uring || lblock >= blocks)
+        return;
+
+    /* size buffer for next window */
+    size_t window = min(file->ra_window * 2, READAHEAD_MAX);
+    size_t count  = min(window, blocks - lblock);
+
+    char        *ra_async    = realloc(file->ra_async, count * BLOCK_SIZE);
+    if (ra_async)
+        file->ra_async = ra_async;
+    DiskRequest *ra_requests = realloc(file->ra_requests, count * sizeof(DiskRequest));
+    if (ra_requests)
+        file->ra_requests = ra_requests;
+    if (!ra_async || !ra_requests)
+        return;
+
+    /* zero holes and read runs of contiguous blocks */
+    size_t nrequests = 0;
+    for (size_t i = 0; i < count; ) {
+        size_t run;
+        size_t pblock = file_map(file, lblock + i, &run);
+        if (!run)
+            pblock = 0;
+        run = run ? min(run, count - i) : count - i;
+
+        if (pblock) {
+            memset(&file->ra_requests[nrequests], 0, sizeof(DiskRequest));
+            file->ra_requests[nrequests].block = pblock;
+            file->ra_requests[nrequests].count = run;
+            file->ra_requests[nrequests].data  = file->ra_async + i * BLOCK_SIZE;
+            nrequests++;
+        } else {
+            memset(file->ra_async + i * BLOCK_SIZE, 0, run * BLOCK_SIZE);
+        }
+        i += run;
+    }
+
+    if (!disk_read_async(disk, file->ra_requests, nrequests)) {
+        file->ra_nrequests = nrequests;
+        file_readahead_wait(file);
+        return;
+    }
+
+    file->ra_nrequests   = nrequests;
+    file->ra_async_start = lblock;
+    file->ra_async_count = count;
+}
+
+/**
+ * Wait for reads filling asynchronous readahead buffer of File.
+ *
+ * @param       file            Pointer to File handle.
+ * @return      Whether or not all of the reads were successful.
+ **/
+bool   file_readahead_wait(File *file) {
+    bool result = true;
+    for (size_t r = 0; r < file->ra_nrequests; r++) {
+        if (disk_wait(file->fs->disk, &file->ra_requests[r]) == DISK_FAILURE)
+            result = false;
+    }
+
+    file->ra_nrequests = 0;
+    return result;
+}
+
+/**
+ * Drop asynchronous readahead buffer of File (waiting for any reads in
+ * flight and counting its blocks as waste).
+ *
+ * @param       file            Pointer to File handle.
+ **/
+void   file_readahead_cancel(File *file) {
+    file_readahead_wait(file);
+    __atomic_add_fetch(&file->fs->disk->readahead_waste, file->ra_async_count, __ATOMIC_RELAXED);
+    file->ra_async_start = 0;
+    file->ra_async_count = 0;
+}
+
+/**
+ * Allocate a run of up to want blocks for File as close after goal as
+ * possible by doing the following:
+ *
+ *  1. Take blocks from the File preallocation window if it starts at goal.
+ *
+ *  2. Otherwise release the window and allocate the run along with a new
+ *  window of PREALLOC_BLOCKS blocks reserved right after it (skipping free
+ *  runs too small to hold both when goal is in use, while new files fill the
+ *  lowest hole that holds the run).
+ *
+ *  3. Checkpoint the journal if the new blocks held metadata logged since the
+ *  last checkpoint (so replay never overwrites data written to them).
+ *
+ * @param       file            Pointer to File handle.
+ * @param       goal            Preferred first block of run (0 for none).
+ * @param       want            Maximum number of blocks to allocate.
+ * @param       got             Set to number of blocks allocated.
+ * @return      First block of run (-1 on nothing found).
+ **/
+size_t file_alloc(File *file, size_t goal, size_t want, size_t *got) {
+
+    /* take blocks from preallocation window */
+    if (file->prealloc_count && file->prealloc_start == goal) {
+        *got = min(want, file->prealloc_count);
+        file->prealloc_start += *got;
+        file->prealloc_count -= *got;
+        return goal;
+    }
+
+    /* allocate run and new preallocation window */
+    file_prealloc_drop(file);
+
+    size_t count;
+    size_t need  = goal ? want + PREALLOC_BLOCKS : want;
+    size_t start = gimme_goal(file->fs, goal, need, want + PREALLOC_BLOCKS, &count);
+    if (start == -1)
+        return -1;
+    journal_reuse(file->fs, start, count);
+
+    *got = min(want, count);
+    file->prealloc_start = start + *got;
+    file->prealloc_count = count - *got;
+    return start;
+}
+
+/**
+ * Release unused blocks in File preallocation window.
+ *
+ * @param       file            Pointer to File handle.
+ **/
+void   file_prealloc_drop(File *file) {
+    for (size_t b = 0; b < file->prealloc_count; b++)
+        release_block(file->fs, file->prealloc_start + b);
+
+    file->prealloc_start = 0;
+    file->prealloc_count = 0;
+}
+
+/**
+ * Write to pointer-mapped File by doing the following:
+ *
+ *  1. Find (or allocate) the direct or indirect pointer for each block.
+ *
+ *  2. Copy data into the block (reading the old block for partial writes).
+ *
+ *  3. Update size (and block map if blocks were allocated).
+ *
+ * @param       file            Pointer to File handle.
+ * @param       data            Buffer with data to copy
+ * @param       length          Number of bytes to write.
+ * @param       offset          Byte offset from which to begin writing.
+ * @return      Number of bytes written (-1 on error).
+ **/
+ssize_t file_write_pointers(File *file, char *data, size_t length, size_t offset) {
+    FileSystem *fs    = file->fs;
+    Inode      *inode = &file->inode;
+
+    size_t data_b = offset / BLOCK_SIZE;
+    size_t data_o = offset % BLOCK_SIZE;
+    size_t nwrite = 0;
+    bool   allocated = false;
+
+    while (nwrite < length && data_b < POINTERS_PER_INODE + POINTERS_PER_BLOCK) {
+
+        /* find pointer */
+        uint32_t *pointer;
+        if (data_b < POINTERS_PER_INODE) {
+            pointer = &inode->direct[data_b];
+        } else {
+
+            /* check and find indirect block */
+            if (inode->indirect == 0) {
+                size_t i = gimme_block(fs);
+                if (i == -1)
+                    break;
+
+                inode->indirect = i;
+                memset(file->spill.data, 0, BLOCK_SIZE);
+                file->inode_dirty = true;
+                file->spill_dirty = true;
+            }
+            pointer = &file->spill.pointers[data_b - POINTERS_PER_INODE];
+        }
+
+        /* find new block */
+        bool fresh = (*pointer == 0);
+        if (fresh) {
+            size_t b = gimme_block(fs);
+            if (b == -1)
+                break;
+
+            *pointer  = b;
+            allocated = true;
+            if (data_b < POINTERS_PER_INODE)
+                file->inode_dirty = true;
+            else
+                file->spill_dirty = true;
+        }
+
+        /* copy the data (reading in data block for partial writes) */
+        size_t ncopy = min(BLOCK_SIZE - data_o, length - nwrite);
+        Block Dblock = {{0}};
+        if (ncopy != BLOCK_SIZE && !fresh && disk_read(fs->disk, *pointer, Dblock.data) == DISK_FAILURE)
+            return -1;
+        memcpy(Dblock.data + data_o, data + nwrite, ncopy);
+
+        /* write block back */
+        if (disk_write(fs->disk, *pointer, Dblock.data) == DISK_FAILURE)
+            return -1;
+
+        nwrite += ncopy;
+        data_o = 0;
+        data_b++;
+    }
+
+    /* update inode info */
+    if (offset + nwrite > inode->size) {
+        inode->size = offset + nwrite;
+        file->inode_dirty = true;
+    }
+
+    if (allocated && !file_decode(file))
+        return -1;
+
+    return nwrite;
+}
+
+/**
+ * Write to extent-mapped File by doing the following:
+ *
+ *  1. Allocate contiguous runs of blocks until the file maps the whole write.
+ *
+ *  2. Write each mapped range a batch of contiguous blocks at a time (zeroing
+ *  new blocks skipped over by offset).
+ *
+ *  3. Update size.
+ *
+ * @param       file            Pointer to File handle.
+ * @param       data            Buffer with data to copy
+ * @param       length          Number of bytes to write.
+ * @param       offset          Byte offset from which to begin writing.
+ * @return      Number of bytes written (-1 on error).
+ **/
+ssize_t file_write_extents(File *file, char *data, size_t length, size_t offset) {
+    FileSystem *fs    = file->fs;
+    Inode      *inode = &file->inode;
+
+    /* adjust length to maximum file size */
+    if (offset >= UINT32_MAX)
+        return 0;
+    length = min(length, UINT32_MAX - offset);
+    if (!length)
+        return 0;
+
+    /* allocate runs to map whole write */
+    size_t first  = offset / BLOCK_SIZE;
+    size_t last   = (offset + length + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    size_t fresh  = extent_blocks(inode, &file->spill);
+    size_t mapped = fresh;
+
+    while (mapped < last) {
+        size_t goal = 0;
+        if (inode->nextents) {
+            Extent *extent = extent_at(inode, &file->spill, inode->nextents - 1);
+            goal = extent->start + extent->length;
+        }
+
+        size_t got;
+        size_t start = file_alloc(file, goal, last - mapped, &got);
+        if (start == -1)
+            break;
+
+        if (!extent_append(fs, inode, &file->spill, start, got)) {
+            for (size_t b = 0; b < got; b++)
+                release_block(fs, start + b);
+            break;
+        }
+        mapped += got;
+    }
+
+    if (mapped != fresh) {
+        file->inode_dirty = true;
+        file->spill_dirty = inode->spill != 0;
+        if (!file_decode(file))
+            return -1;
+    }
+
+    if (mapped <= first)
+        return 0;
+    length = min(length, mapped * BLOCK_SIZE - offset);
+
+    /* write mapped ranges (zeroing new blocks before offset) */
+    size_t lblock = min(fresh, first);
+    size_t data_o = offset % BLOCK_SIZE;
+    size_t nwrite = 0;
+
+    while (nwrite < length) {
+
+        /* map range */
+        size_t run;
+        size_t pblock = file_map(file, lblock, &run);
+        if (!run)
+            return -1;
+
+        /* write blocks in range (a batch of contiguous blocks at a time) */
+        while (run && nwrite < length) {
+            char  *buffers[DISK_IOV_BLOCKS];
+            Block  partial[2];
+            Block  Zblock = {{0}};
+            size_t nblocks = 0, npartial = 0;
+
+            while (nblocks < run && nblocks < DISK_IOV_BLOCKS && nwrite < length) {
+                size_t b = lblock + nblocks;
+
+                /* new blocks before offset are zeroed */
+                if (b < first) {
+                    buffers[nblocks++] = Zblock.data;
+                    continue;
+                }
+
+                size_t ncopy = min(BLOCK_SIZE - data_o, length - nwrite);
+
+                /* full blocks are written directly from data buffer */
+                if (ncopy == BLOCK_SIZE) {
+                    buffers[nblocks] = data + nwrite;
+                } else {
+                    Block *Dblock = &partial[npartial++];
+                    memset(Dblock->data, 0, BLOCK_SIZE);
+                    if (b < fresh && disk_read(fs->disk, pblock + nblocks, Dblock->data) == DISK_FAILURE)
+                        return -1;
+                    memcpy(Dblock->data + data_o, data + nwrite, ncopy);
+                    buffers[nblocks] = Dblock->data;
+                }
+
+                nwrite += ncopy;
+                data_o = 0;
+                nblocks++;
+            }
+
+            if (disk_writev(fs->disk, pblock, buffers, nblocks) == DISK_FAILURE)
+                return -1;
+
+            run    -= nblocks;
+            lblock += nblocks;
+            pblock += nblocks;
+        }
+    }
+
+    /* update size */
+    if (offset + nwrite > inode->size) {
+        inode->size = offset + nwrite;
+        file->inode_dirty = true;
+    }
+
+    return nwrite;
+}
+
+/**
+ * Return root directory (the directory lock must be held, for writing if
+ * create is set) by doing the following:
+ *
+ *  1. Return the root directory recorded in the SuperBlock if it is valid.
+ *
+ *  2. Otherwise, if create is set, make a new directory, commit it, and then
+ *  record it in the SuperBlock (so the SuperBlock never refers to a directory
+ *  that is not on disk).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       create          Whether to create root directory if missing.
+ * @return      Inode number of root directory (-1 on failure).
+ **/
+ssize_t dir_root(FileSystem *fs, bool create) {
+    /* check recorded root directory */
+    if (fs->meta_data.root) {
+        size_t root = fs->meta_data.root - 1;
+        Block  block;
+
+        inode_lock(fs, root, false);
+        bool valid = journal_read(fs, root / INODES_PER_BLOCK + 1, block.data) &&
+                     block.inodes[root % INODES_PER_BLOCK].valid == INODE_DIRECTORY;
+        inode_unlock(fs, root);
+        if (valid)
+            return root;
+    }
+
+    if (!create)
+        return -1;
+
+    /* make root directory and record it once it is durable */
+    if (!journal_start(fs, JOURNAL_INODE_CREDITS))
+        return -1;
+    ssize_t root = dir_make(fs);
+    journal_stop(fs);
+    if (root < 0 || !fs_sync(fs))
+        return -1;
+
+    pthread_mutex_lock(&fs->journal_lock);
+    fs->meta_data.root = root + 1;
+    bool stored = superblock_store(fs);
+    pthread_mutex_unlock(&fs->journal_lock);
+    return stored ? root : -1;
+}
+
+/**
+ * Resolve every component of absolute path except the last one (the
+ * directory lock must be held).
+ *
+ * Note: Empty components are skipped, while "." and ".." are not valid names.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       path            Absolute path.
+ * @param       name            Set to last component (empty for "/").
+ * @param       create          Whether to create root directory if missing.
+ * @return      Inode number of directory holding last component (-1 on failure).
+ **/
+ssize_t dir_walk(FileSystem *fs, const char *path, char *name, bool create) {
+    if (path[0] != '/')
+        return -1;
+
+    ssize_t dir = dir_root(fs, create);
+    if (dir < 0)
+        return -1;
+
+    name[0] = 0;
+    while (true) {
+        while (*path == '/')
+            path++;
+        if (!*path)
+            return dir;
+
+        /* descend into previous component */
+        if (name[0]) {
+            uint32_t type;
+            dir = dir_lookup(fs, dir, name, &type);
+            if (dir < 0 || type != INODE_DIRECTORY)
+                return -1;
+        }
+
+        /* copy component */
+        size_t length = strcspn(path, "/");
+        if (length >= DIR_NAME_MAX || (path[0] == '.' && (length == 1 || (length == 2 && path[1] == '.'))))
+            return -1;
+        memcpy(name, path, length);
+        name[length] = 0;
+        path += length;
+    }
+}
+
+/**
+ * Resolve absolute path (the directory lock must be held).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       path            Absolute path.
+ * @param       type            Set to type of Inode (INODE_FILE or INODE_DIRECTORY).
+ * @return      Inode number of path (-1 if it does not exist).
+ **/
+ssize_t dir_resolve(FileSystem *fs, const char *path, uint32_t *type) {
+    char    name[DIR_NAME_MAX];
+    ssize_t dir = dir_walk(fs, path, name, false);
+    if (dir < 0)
+        return -1;
+
+    if (!name[0]) {
+        *type = INODE_DIRECTORY;
+        return dir;
+    }
+
+    return dir_lookup(fs, dir, name, type);
+}
+
+/**
+ * Allocate directory Inode with an empty hashed index: a root index block
+ * with a single child covering every hash, followed by an empty leaf block.
+ *
+ * Note: The caller must have started a journal operation.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @return      Inode number of new directory (-1 on failure).
+ **/
+ssize_t dir_make(FileSystem *fs) {
+    pthread_mutex_lock(&fs->table_lock);
+    ssize_t inode_number = inode_create(fs, INODE_DIRECTORY);
+    pthread_mutex_unlock(&fs->table_lock);
+    if (inode_number < 0)
+        return -1;
+
+    Block blocks[2];
+    memset(blocks, 0, sizeof(blocks));
+    blocks[0].index.magic = DIR_MAGIC;
+    blocks[0].index.count = 1;
+    blocks[0].index.children[0].block = 1;
+
+    /* write blocks before the Inode that maps them is logged */
+    inode_lock(fs, inode_number, true);
+    File *file   = file_open(fs, inode_number);
+    bool  result = file && file_write(file, blocks[0].data, sizeof(blocks), 0) == sizeof(blocks);
+    if (file && !file_close(file))
+        result = false;
+    inode_unlock(fs, inode_number);
+
+    if (!result) {
+        inode_delete(fs, inode_number);
+        return -1;
+    }
+    return inode_number;
+}
+
+/**
+ * Look up name in directory by reading the root index block, the index block
+ * below it (if any), and the single leaf covering the hash of the name.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       dir             Inode number of directory.
+ * @param       name            Name to look up.
+ * @param       type            Set to type of Inode (INODE_FILE or INODE_DIRECTORY).
+ * @return      Inode number of entry (-1 if it does not exist).
+ **/
+ssize_t dir_lookup(FileSystem *fs, size_t dir, const char *name, uint32_t *type) {
+    uint32_t hash         = dir_hash(name);
+    ssize_t  inode_number = -1;
+    Block    root, leaf;
+
+    inode_lock(fs, dir, false);
+    File *file = dir_open(fs, dir, &root);
+    if (file) {
+        DirEntry *entry = dir_leaf(file, &root, hash, &leaf) >= 0 ? dir_search(&leaf, name, hash) : NULL;
+        if (entry) {
+            inode_number = entry->inode;
+            *type        = entry->type;
+        }
+        file_close(file);
+    }
+    inode_unlock(fs, dir);
+    return inode_number;
+}
+
+/**
+ * Add entry for Inode to directory (the name must not be in use).
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       dir             Inode number of directory.
+ * @param       name            Name of entry.
+ * @param       inode_number    Inode number of entry.
+ * @param       type            Type of Inode (INODE_FILE or INODE_DIRECTORY).
+ * @return      Whether or not the entry was added.
+ **/
+bool   dir_insert(FileSystem *fs, size_t dir, const char *name, size_t inode_number, uint32_t type) {
+    Block root;
+    bool  result = false;
+
+    inode_lock(fs, dir, true);
+    File *file = dir_open(fs, dir, &root);
+    if (file) {
+        result = dir_add(file, &root, name, inode_number, type);
+        if (!file_close(file))
+            result = false;
+    }
+    inode_unlock(fs, dir);
+    return result;
+}
+
+/**
+ * Add entry to directory File (its inode lock must be held for writing) by
+ * doing the following:
+ *
+ *  1. Find the leaf covering the hash of the name (and the index block above
+ *  it) and store the entry in a free slot.
+ *
+ *  2. If the leaf is full, split it at a hash boundary near its middle into
+ *  a new leaf (entries with equal hashes stay in the same leaf).
+ *
+ *  3. Link the new leaf into the index block after the old one.  If the
+ *  root index block is full, move its children into a new index block (so
+ *  the index gains a level), and if an index block below the root is full,
+ *  split it and link the new index block into the root.
+ *
+ * Note: New blocks are allocated before any block is written, and if any of
+ * them cannot be allocated the directory is shrunk back, so running out of
+ * space leaves the directory unchanged.
+ *
+ * @param       dir             Pointer to directory File handle.
+ * @param       root            Root index block of directory.
+ * @param       name            Name of entry.
+ * @param       inode_number    Inode number of entry.
+ * @param       type            Type of Inode (INODE_FILE or INODE_DIRECTORY).
+ * @return      Whether or not the entry was added.
+ **/
+bool   dir_add(File *dir, Block *root, const char *name, size_t inode_number, uint32_t type) {
+    uint32_t hash = dir_hash(name);
+    Block    index, leaf;
+
+    /* find leaf covering hash (and index block above it) */
+    size_t    rpos   = dir_find(&root->index, hash);
+    DirIndex *parent = &root->index;
+    size_t    iblock = 0;
+    if (root->index.levels) {
+        iblock = root->index.children[rpos].block;
+        if (!dir_read(dir, iblock, &index) || index.index.magic != DIR_MAGIC)
+            return false;
+        parent = &index.index;
+    }
+
+    size_t ppos   = dir_find(parent, hash);
+    size_t lblock = parent->children[ppos].block;
+    if (!dir_read(dir, lblock, &leaf))
+        return false;
+
+    DirEntry entry = {0};
+    entry.inode = inode_number;
+    entry.hash  = hash;
+    entry.type  = type;
+    strncpy(entry.name, name, DIR_NAME_MAX - 1);
+    root->index.entries++;
+
+    /* store entry in free slot */
+    for (size_t e = 0; e < DIR_ENTRIES; e++) {
+        if (!leaf.dirents[e].type) {
+            leaf.dirents[e] = entry;
+            return dir_write(dir, lblock, &leaf) && dir_write(dir, 0, root);
+        }
+    }
+
+    /* split full leaf at hash boundary nearest its middle */
+    if (parent->count == DIR_CHILDREN && root->index.levels && root->index.count == DIR_CHILDREN)
+        return false;
+
+    DirEntry sorted[DIR_ENTRIES + 1];
+    memcpy(sorted, leaf.dirents, sizeof(leaf.dirents));
+    sorted[DIR_ENTRIES] = entry;
+    qsort(sorted, DIR_ENTRIES + 1, sizeof(DirEntry), dir_compare);
+
+    size_t split = 0;
+    for (size_t d = 0; d < DIR_ENTRIES / 2 && !split; d++) {
+        if (sorted[DIR_ENTRIES / 2 + d - 1].hash != sorted[DIR_ENTRIES / 2 + d].hash)
+            split = DIR_ENTRIES / 2 + d;
+        else if (sorted[DIR_ENTRIES / 2 - d - 1].hash != sorted[DIR_ENTRIES / 2 - d].hash)
+            split = DIR_ENTRIES / 2 - d;
+    }
+    if (!split)
+        return false;
+
+    /* allocate new leaf (and index blocks if index block is full) */
+    Inode   inode   = dir->inode;
+    Block   spill   = dir->spill;
+    bool    grow    = parent->count == DIR_CHILDREN;
+    bool    level   = grow && !root->index.levels;
+    ssize_t sibling = dir_grow(dir);
+    ssize_t moved   = level && sibling >= 0 ? dir_grow(dir) : 0;
+    ssize_t upper   = grow  && sibling >= 0 && moved >= 0 ? dir_grow(dir) : 0;
+    if (sibling < 0 || moved < 0 || upper < 0) {
+        dir_shrink(dir, &inode, &spill);
+        return false;
+    }
+
+    Block right = {{0}};
+    memset(leaf.data, 0, BLOCK_SIZE);
+    memcpy(leaf.dirents, sorted, split * sizeof(DirEntry));
+    memcpy(right.dirents, sorted + split, (DIR_ENTRIES + 1 - split) * sizeof(DirEntry));
+    if (!dir_write(dir, lblock, &leaf) || !dir_write(dir, sibling, &right))
+        return false;
+
+    /* link new leaf after old one */
+    if (!grow) {
+        dir_link(parent, ppos + 1, sorted[split].hash, sibling);
+        return (!root->index.levels || dir_write(dir, iblock, &index)) && dir_write(dir, 0, root);
+    }
+
+    /* add index level below root */
+    if (level) {
+        index = *root;
+        index.index.levels  = 0;
+        index.index.entries = 0;
+        root->index.levels  = 1;
+        root->index.count   = 1;
+        root->index.children[0].hash  = 0;
+        root->index.children[0].block = moved;
+        parent = &index.index;
+        iblock = moved;
+        rpos   = 0;
+    }
+
+    /* split index block and link upper half into root */
+    Block  split_index = {{0}};
+    size_t half = DIR_CHILDREN / 2;
+    split_index.index.magic = DIR_MAGIC;
+    split_index.index.count = DIR_CHILDREN - half;
+    memcpy(split_index.index.children, parent->children + half, split_index.index.count * sizeof(DirChild));
+    parent->count = half;
+
+    if (ppos + 1 <= half)
+        dir_link(parent, ppos + 1, sorted[split].hash, sibling);
+    else
+        dir_link(&split_index.index, ppos + 1 - half, sorted[split].hash, sibling);
+    dir_link(&root->index, rpos + 1, split_index.index.children[0].hash, upper);
+
+    return dir_write(dir, iblock, &index) && dir_write(dir, upper, &split_index) && dir_write(dir, 0, root);
+}
+
+/**
+ * Remove entry from directory.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       dir             Inode number of directory.
+ * @param       name            Name of entry.
+ * @return      Whether or not the entry was removed.
+ **/
+bool   dir_delete(FileSystem *fs, size_t dir, const char *name) {
+    uint32_t hash   = dir_hash(name);
+    bool     result = false;
+    Block    root, leaf;
+
+    inode_lock(fs, dir, true);
+    File *file = dir_open(fs, dir, &root);
+    if (file) {
+        ssize_t   lblock = dir_leaf(file, &root, hash, &leaf);
+        DirEntry *entry  = lblock >= 0 ? dir_search(&leaf, name, hash) : NULL;
+        if (entry) {
+            memset(entry, 0, sizeof(DirEntry));
+            root.index.entries--;
+            result = dir_write(file, lblock, &leaf) && dir_write(file, 0, &root);
+        }
+        if (!file_close(file))
+            result = false;
+    }
+    inode_unlock(fs, dir);
+    return result;
+}
+
+/**
+ * Return number of entries in directory.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       dir             Inode number of directory.
+ * @return      Number of entries (-1 on failure).
+ **/
+ssize_t dir_count(FileSystem *fs, size_t dir) {
+    ssize_t count = -1;
+    Block   root;
+
+    inode_lock(fs, dir, false);
+    File *file = dir_open(fs, dir, &root);
+    if (file) {
+        count = root.index.entries;
+        file_close(file);
+    }
+    inode_unlock(fs, dir);
+    return count;
+}
+
+/**
+ * Open directory (its inode lock must be held, for writing if it will be
+ * modified) and read its root index block.
+ *
+ * @param       fs              Pointer to FileSystem structure.
+ * @param       dir             Inode number of directory.
+ * @param       root            Set to root index block.
+ * @return      Pointer to File handle (NULL if Inode is not a directory).
+ **/
+File * dir_open(FileSystem *fs, size_t dir, Block *root) {
+    File *file = file_open(fs, dir);
+    if (!file)
+        return NULL;
+
+    if (file->inode.valid != INODE_DIRECTORY || !dir_read(file, 0, root) || root->index.magic != DIR_MAGIC) {
+        file_close(file);
+        return NULL;
+    }
+    return file;
+}
+
+/**
+ * Read leaf of directory covering hash (through the index block below the
+ * root, if any).
+ *
+ * @param       dir             Pointer to directory File handle.
+ * @param       root            Root index block of directory.
+ * @param       hash            Hash of name.
+ * @param       leaf            Set to leaf block.
+ * @return      Logical block of leaf (-1 on failure).
+ **/
+ssize_t dir_leaf(File *dir, Block *root, uint32_t hash, Block *leaf) {
+    DirIndex *parent = &root->index;
+    Block     index;
+
+    if (root->index.levels) {
+        if (!dir_read(dir, root->index.children[dir_find(&root->index, hash)].block, &index) || index.index.magic != DIR_MAGIC)
+            return -1;
+        parent = &index.index;
+    }
+
+    size_t lblock = parent->children[dir_find(parent, hash)].block;
+    return dir_read(dir, lblock, leaf) ? lblock : -1;
+}
+
+/**
+ * Read logical block of directory (through the running transaction).
+ *
+ * @param       dir             Pointer to directory File handle.
+ * @param       lblock          Logical block number in directory.
+ * @param       block           Set to contents of block.
+ * @return      Whether or not the read was successful.
+ **/
+bool   dir_read(File *dir, size_t lblock, Block *block) {
+    size_t run;
+    size_t pblock = lblock < dir->inode.size / BLOCK_SIZE ? file_map(dir, lblock, &run) : 0;
+    return pblock && journal_read(dir->fs, pblock, block->data);
+}
+
+/**
+ * Write logical block of directory (logging it in the running transaction
+ * like other metadata).
+ *
+ * @param       dir             Pointer to directory File handle.
+ * @param       lblock          Logical block number in directory.
+ * @param       block           Contents of block.
+ * @return      Whether or not the write was successful.
+ **/
+bool   dir_write(File *dir, size_t lblock, Block *block) {
+    size_t run;
+    size_t pblock = lblock < dir->inode.size / BLOCK_SIZE ? file_map(dir, lblock, &run) : 0;
+    return pblock && journal_write(dir->fs, pblock, block->data);
+}
+
+/**
+ * Append zeroed block to directory.
+ *
+ * @param       dir             Pointer to directory File handle.
+ * @return      Logical block number of new block (-1 on failure).
+ **/
+ssize_t dir_grow(File *dir) {
+    Block  block  = {{0}};
+    size_t lblock = dir->inode.size / BLOCK_SIZE;
+
+    if (file_write(dir, block.data, BLOCK_SIZE, lblock * BLOCK_SIZE) != BLOCK_SIZE)
+        return -1;
+    return lblock;
+}
+
+/**
+ * Shrink directory back to the saved Inode (undoing dir_grow) by releasing
+ * the blocks mapped past its size (and any indirect or spill block allocated
+ * since) and restoring the saved Inode and indirect or spill block.
+ *
+ * @param       dir             Pointer to directory File handle.
+ * @param       inode           Inode saved before growing.
+ * @param       spill           Indirect or spill block saved before growing.
+ * @return      Whether or not the block map was restored.
+ **/
+bool   dir_shrink(File *dir, Inode *inode, Block *spill) {
+    FileSystem *fs      = dir->fs;
+    bool        extents = fs->meta_data.version >= FS_VERSION_EXTENTS;
+
+    /* release blocks mapped past saved size */
+    size_t lblock = inode->size / BLOCK_SIZE;
+    size_t run, pblock;
+    while ((pblock = file_map(dir, lblock, &run)) || run) {
+        for (size_t b = 0; pblock && b < run; b++)
+            release_block(fs, pblock + b);
+        lblock += run;
+    }
+
+    /* release new indirect or spill block */
+    size_t grown = extents ? dir->inode.spill : dir->inode.indirect;
+    size_t saved = extents ? inode->spill     : inode->indirect;
+    if (grown && !saved)
+        release_block(fs, grown);
+
+    dir->inode = *inode;
+    dir->spill = *spill;
+    return file_decode(dir);
+}
+
+/**
+ * Find child of index block covering hash (the last child whose lowest hash
+ * is not above it).
+ *
+ * @param       index           Pointer to directory index.
+ * @param       hash            Hash of name.
+ * @return      Position of child in index.
+ **/
+size_t dir_find(DirIndex *index, uint32_t hash) {
+    size_t low  = 0;
+    size_t high = max(index->count, 1);
+
+    while (high - low > 1) {
+        size_t middle = (low + high) / 2;
+        if (index->children[middle].hash <= hash)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/**
+ * Insert child into index block (which must have room).
+ *
+ * @param       index           Pointer to directory index.
+ * @param       position        Position of new child.
+ * @param       hash            Lowest hash stored under child.
+ * @param       lblock          Logical block of child.
+ **/
+void   dir_link(DirIndex *index, size_t position, uint32_t hash, size_t lblock) {
+    memmove(&index->children[position + 1], &index->children[position], (index->count - position) * sizeof(DirChild));
+    index->children[position].hash  = hash;
+    index->children[position].block = lblock;
+    index->count++;
+}
+
+/**
+ * Search leaf block for entry with name.
+ *
+ * @param       leaf            Leaf block.
+ * @param       name            Name to search for.
+ * @param       hash            Hash of name.
+ * @return      Pointer to entry in leaf (NULL if not found).
+ **/
+DirEntry *dir_search(Block *leaf, const char *name, uint32_t hash) {
+    for (size_t e = 0; e < DIR_ENTRIES; e++) {
+        DirEntry *entry = &leaf->dirents[e];
+        if (entry->type && entry->hash == hash && strncmp(entry->name, name, DIR_NAME_MAX) == 0)
+            return entry;
+    }
+    return NULL;
+}
 
+/**
+ * Compare directory entries by hash (for qsort).
+ *
+ * @param       a               Pointer to first entry.
+ * @param       b               Pointer to second entry.
+ * @return      Negative, zero, or positive as first hash is below, equal to, or above second.
+ **/
+int    dir_compare(const void *a, const void *b) {
+    uint32_t x = ((const DirEntry *)a)->hash;
+    uint32_t y = ((const DirEntry *)b)->hash;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Compute hash (32-bit FNV-1a) of name.
+ *
+ * @param       name            Name to hash.
+ * @return      Hash of name.
+ **/
+uint32_t dir_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)name; *c; c++)
+        hash = (hash ^ *c) * 16777619u;
+    return hash;
 }
- 
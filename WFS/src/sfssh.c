@@ -23,10 +23,18 @@ void do_stat(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
 void do_copyout(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
 void do_cat(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
 void do_copyin(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
+void do_sync(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
+void do_mkdir(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
+void do_touch(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
+void do_unlink(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
+void do_lookup(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
+void do_ls(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
 void do_help(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2);
 
 /* Utility Prototypes */
 
+int  compare_entries(const void *a, const void *b);
+
 bool copyout(FileSystem *fs, size_t inode_number, const char *path);
 bool copyin(FileSystem *fs, const char *path, size_t inode_number);
 
@@ -77,6 +85,18 @@ int main(int argc, char *argv[]) {
 	    do_cat(disk, &fs, args, arg1, arg2);
         } else if (streq(cmd, "copyin")) {
 	    do_copyin(disk, &fs, args, arg1, arg2);
+        } else if (streq(cmd, "sync")) {
+	    do_sync(disk, &fs, args, arg1, arg2);
+        } else if (streq(cmd, "mkdir")) {
+	    do_mkdir(disk, &fs, args, arg1, arg2);
+        } else if (streq(cmd, "touch")) {
+	    do_touch(disk, &fs, args, arg1, arg2);
+        } else if (streq(cmd, "unlink")) {
+	    do_unlink(disk, &fs, args, arg1, arg2);
+        } else if (streq(cmd, "lookup")) {
+	    do_lookup(disk, &fs, args, arg1, arg2);
+        } else if (streq(cmd, "ls")) {
+	    do_ls(disk, &fs, args, arg1, arg2);
         } else if (streq(cmd, "help")) {
 	    do_help(disk, &fs, args, arg1, arg2);
 	} else if (streq(cmd, "exit") || streq(cmd, "quit")) {
@@ -206,6 +226,95 @@ void do_copyin(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
     }
 }
 
+void do_sync(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
+    if (args != 1) {
+	printf("Usage: sync\n");
+	return;
+    }
+
+    if (fs_sync(fs)) {
+        printf("disk synced.\n");
+    } else {
+        printf("sync failed!\n");
+    }
+}
+
+void do_mkdir(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
+    if (args != 2) {
+        printf("Usage: mkdir <path>\n");
+        return;
+    }
+
+    ssize_t inode_number = fs_mkdir(fs, arg1);
+    if (inode_number >= 0) {
+        printf("created directory %s (inode %ld).\n", arg1, inode_number);
+    } else {
+        printf("mkdir failed!\n");
+    }
+}
+
+void do_touch(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
+    if (args != 2) {
+        printf("Usage: touch <path>\n");
+        return;
+    }
+
+    ssize_t inode_number = fs_create_path(fs, arg1);
+    if (inode_number >= 0) {
+        printf("created file %s (inode %ld).\n", arg1, inode_number);
+    } else {
+        printf("touch failed!\n");
+    }
+}
+
+void do_unlink(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
+    if (args != 2) {
+        printf("Usage: unlink <path>\n");
+        return;
+    }
+
+    if (fs_unlink(fs, arg1)) {
+        printf("unlinked %s.\n", arg1);
+    } else {
+        printf("unlink failed!\n");
+    }
+}
+
+void do_lookup(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
+    if (args != 2) {
+        printf("Usage: lookup <path>\n");
+        return;
+    }
+
+    ssize_t inode_number = fs_lookup(fs, arg1);
+    if (inode_number >= 0) {
+        printf("%s is inode %ld.\n", arg1, inode_number);
+    } else {
+        printf("lookup failed!\n");
+    }
+}
+
+void do_ls(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
+    if (args > 2) {
+        printf("Usage: ls [path]\n");
+        return;
+    }
+
+    size_t    count;
+    DirEntry *entries = fs_readdir(fs, args == 2 ? arg1 : "/", &count);
+    if (!entries) {
+        printf("ls failed!\n");
+        return;
+    }
+
+    qsort(entries, count, sizeof(DirEntry), compare_entries);
+    for (size_t e = 0; e < count; e++) {
+        printf("%8u %8ld %s%s\n", entries[e].inode, fs_stat(fs, entries[e].inode), entries[e].name,
+            entries[e].type == INODE_DIRECTORY ? "/" : "");
+    }
+    free(entries);
+}
+
 void do_help(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
     printf("Commands are:\n");
     printf("    format\n");
@@ -217,6 +326,12 @@ void do_help(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
     printf("    stat    <inode>\n");
     printf("    copyin  <file> <inode>\n");
     printf("    copyout <inode> <file>\n");
+    printf("    mkdir   <path>\n");
+    printf("    touch   <path>\n");
+    printf("    unlink  <path>\n");
+    printf("    lookup  <path>\n");
+    printf("    ls      [path]\n");
+    printf("    sync\n");
     printf("    help\n");
     printf("    quit\n");
     printf("    exit\n");
@@ -224,6 +339,10 @@ void do_help(Disk *disk, FileSystem *fs, int args, char *arg1, char *arg2) {
 
 /* Utility Functions */
 
+int  compare_entries(const void *a, const void *b) {
+    return strcmp(((const DirEntry *)a)->name, ((const DirEntry *)b)->name);
+}
+
 bool copyin(FileSystem *fs, const char *path, size_t inode_number) {
     FILE *stream = fopen(path, "r");
     if (!stream) {
@@ -231,14 +350,19 @@ bool copyin(FileSystem *fs, const char *path, size_t inode_number) {
         return false;
     }
 
+    File *file = fs_open(fs, inode_number);
+    if (!file) {
+        fprintf(stderr, "Unable to open inode %lu\n", inode_number);
+    }
+
     char buffer[4*BUFSIZ] = {0};
     size_t offset = 0;
-    while (true) {
+    while (file) {
         ssize_t result = fread(buffer, 1, sizeof(buffer), stream);
         if (result <= 0) {
             break;
         }
-        ssize_t actual = fs_write(fs, inode_number, buffer, result, offset);
+        ssize_t actual = fs_file_write(file, buffer, result, offset);
         if (actual < 0) {
             fprintf(stderr, "fs_write returned invalid result %ld\n", actual);
             break;
@@ -249,6 +373,9 @@ bool copyin(FileSystem *fs, const char *path, size_t inode_number) {
             break;
         }
     }
+    if (file && !fs_close(file)) {
+        fprintf(stderr, "fs_close failed\n");
+    }
     printf("%lu bytes copied\n", offset);
     fclose(stream);
     return true;
@@ -261,10 +388,12 @@ bool copyout(FileSystem *fs, size_t inode_number, const char *path) {
         return false;
     }
 
+    File *file = fs_open(fs, inode_number);
+
     char buffer[4*BUFSIZ] = {0};
     size_t offset = 0;
-    while (true) {
-        ssize_t result = fs_read(fs, inode_number, buffer, sizeof(buffer), offset);
+    while (file) {
+        ssize_t result = fs_file_read(file, buffer, sizeof(buffer), offset);
 
         if (result <= 0) {
             break;
@@ -272,6 +401,7 @@ bool copyout(FileSystem *fs, size_t inode_number, const char *path) {
         fwrite(buffer, 1, result, stream);
         offset += result;
     }
+    fs_close(file);
     printf("%lu bytes copied\n", offset);
     fclose(stream);
     return true;
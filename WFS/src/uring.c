@@ -0,0 +1,392 @@
+/* uring.c: SimpleFS asynchronous I/O queue (io_uring) */
+
+#include "sfs/logging.h"
+#include "sfs/uring.h"
+#include "sfs/utils.h"
+
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Internal Prototyes */
+
+void    uring_push(Uring *ring, UringRequest *request);
+bool    uring_enter(Uring *ring);
+void    uring_cancel(Uring *ring);
+bool    uring_wait_any(Uring *ring);
+size_t  uring_reap(Uring *ring);
+void    uring_complete(Uring *ring, UringRequest *request, int res);
+
+/* External Functions */
+
+/**
+ * Create asynchronous I/O queue by doing the following:
+ *
+ *  1. Allocate Uring structure.
+ *
+ *  2. Set up io_uring instance with room for depth requests (with the raw
+ *  io_uring_setup system call).
+ *
+ *  3. Map submission queue, completion queue, and submission queue entries.
+ *
+ * @param       target      File descriptor requests are performed on.
+ * @param       depth       Maximum number of requests in flight (at most
+ *                          URING_MAX_DEPTH).
+ *
+ * @return      Pointer to newly allocated Uring structure (NULL if depth is
+ *              zero or io_uring is unavailable).
+ **/
+Uring * uring_create(int target, size_t depth) {
+    if (!depth)
+        return NULL;
+
+    // allocate uring structure
+    Uring *ring = calloc(1, sizeof(Uring));
+    if (!ring)
+        return NULL;
+
+    ring->target = target;
+    ring->depth  = min(depth, URING_MAX_DEPTH);
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->cond, NULL);
+
+    // set up io_uring instance
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = syscall(__NR_io_uring_setup, ring->depth, &params);
+    if (ring->fd < 0) {
+        uring_delete(ring);
+        return NULL;
+    }
+
+    // map queues (a single mapping holds both rings on newer kernels)
+    ring->sq_size   = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size   = params.cq_off.cqes  + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        ring->sq_size = ring->cq_size = max(ring->sq_size, ring->cq_size);
+
+    ring->sq_ring = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+        ring->sq_ring = NULL;
+
+    ring->cq_ring = ring->sq_ring;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        ring->cq_ring = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+            ring->cq_ring = NULL;
+    }
+
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        ring->sqes = NULL;
+
+    if (!ring->sq_ring || !ring->cq_ring || !ring->sqes) {
+        uring_delete(ring);
+        return NULL;
+    }
+
+    char *sq = ring->sq_ring;
+    char *cq = ring->cq_ring;
+    ring->sq_head  = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail  = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask  = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head  = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail  = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask  = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes     = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return ring;
+}
+
+/**
+ * Release asynchronous I/O queue (after waiting for any requests still in
+ * flight).
+ *
+ * @param       ring        Pointer to Uring structure.
+ **/
+void    uring_delete(Uring *ring) {
+    if (!ring)
+        return;
+
+    if (ring->sqes) {
+        pthread_mutex_lock(&ring->lock);
+        while (ring->inflight && uring_wait_any(ring));
+        pthread_mutex_unlock(&ring->lock);
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_size);
+    if (ring->sq_ring)
+        munmap(ring->sq_ring, ring->sq_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+
+    pthread_cond_destroy(&ring->cond);
+    pthread_mutex_destroy(&ring->lock);
+    free(ring);
+}
+
+/**
+ * Queue request (waiting for a request to complete if depth requests are
+ * already in flight).  Queued requests are passed to the kernel in a single
+ * batch by uring_submit (or uring_wait).
+ *
+ * Note: The request and its buffers must stay valid until it completes.
+ *
+ * @param       ring        Pointer to Uring structure.
+ * @param       request     Request to queue (iov, niov, offset, write,
+ *                          callback, and arg must be set).
+ *
+ * @return      Whether or not the request was queued.
+ **/
+bool    uring_queue(Uring *ring, UringRequest *request) {
+    if (!ring || !request || !request->iov || !request->niov)
+        return false;
+
+    request->result   = 0;
+    request->complete = false;
+
+    pthread_mutex_lock(&ring->lock);
+    while (ring->inflight >= ring->depth) {
+        if (!uring_wait_any(ring)) {
+            pthread_mutex_unlock(&ring->lock);
+            return false;
+        }
+    }
+
+    uring_push(ring, request);
+    ring->inflight++;
+    pthread_mutex_unlock(&ring->lock);
+    return true;
+}
+
+/**
+ * Pass all queued requests to the kernel (with a single io_uring_enter call).
+ *
+ * @param       ring        Pointer to Uring structure.
+ *
+ * @return      Whether or not the requests were submitted.
+ **/
+bool    uring_submit(Uring *ring) {
+    if (!ring)
+        return false;
+
+    pthread_mutex_lock(&ring->lock);
+    bool result = uring_enter(ring);
+    pthread_mutex_unlock(&ring->lock);
+    return result;
+}
+
+/**
+ * Wait for request to complete (reaping and running the callbacks of any
+ * other completed requests along the way).
+ *
+ * @param       ring        Pointer to Uring structure.
+ * @param       request     Request previously queued with uring_queue.
+ *
+ * @return      Number of bytes transferred (-1 on failure).
+ **/
+ssize_t uring_wait(Uring *ring, UringRequest *request) {
+    if (!ring || !request)
+        return -1;
+
+    pthread_mutex_lock(&ring->lock);
+    while (!request->complete && uring_wait_any(ring));
+    pthread_mutex_unlock(&ring->lock);
+
+    return request->complete ? request->result : -1;
+}
+
+/* Internal Functions */
+
+/**
+ * Add request to submission queue (the ring lock must be held and the queue
+ * must have room).
+ *
+ * @param       ring        Pointer to Uring structure.
+ * @param       request     Request to add.
+ **/
+void    uring_push(Uring *ring, UringRequest *request) {
+    unsigned tail  = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = request->write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd        = ring->target;
+    sqe->addr      = (uintptr_t)request->iov;
+    sqe->len       = request->niov;
+    sqe->off       = request->offset;
+    sqe->user_data = (uintptr_t)request;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->queued++;
+}
+
+/**
+ * Pass queued requests to the kernel without waiting for completions (the
+ * ring lock must be held).
+ *
+ * If the kernel fails or refuses to take any of the queued requests (ie.
+ * io_uring_enter returns an error or submits nothing), the requests still
+ * queued are failed with uring_cancel, so nobody waits for them forever.
+ *
+ * @param       ring        Pointer to Uring structure.
+ *
+ * @return      Whether or not all queued requests were submitted.
+ **/
+bool    uring_enter(Uring *ring) {
+    while (ring->queued) {
+        int n = syscall(__NR_io_uring_enter, ring->fd, ring->queued, 0, 0, NULL, 0);
+        ring->enters++;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            uring_cancel(ring);
+            return false;
+        }
+        ring->queued -= n;
+    }
+    return true;
+}
+
+/**
+ * Fail all requests not yet passed to the kernel (the ring lock must be held)
+ * by removing them from the submission queue and completing each of them
+ * with a result of -1.
+ *
+ * @param       ring        Pointer to Uring structure.
+ **/
+void    uring_cancel(Uring *ring) {
+    unsigned tail = *ring->sq_tail;
+    unsigned head = tail - ring->queued;
+
+    __atomic_store_n(ring->sq_tail, head, __ATOMIC_RELEASE);
+    ring->queued = 0;
+
+    for (; head != tail; head++) {
+        struct io_uring_sqe *sqe = &ring->sqes[ring->sq_array[head & *ring->sq_mask]];
+        UringRequest *request = (UringRequest *)(uintptr_t)sqe->user_data;
+        uring_complete(ring, request, -1);
+    }
+}
+
+/**
+ * Wait for at least one request to complete (the ring lock must be held) by
+ * doing the following:
+ *
+ *  1. Submit queued requests.
+ *
+ *  2. If another thread is blocked in the kernel, wait for it to reap
+ *  completions (only that thread reaps, so its wakeup is never lost).
+ *
+ *  3. Otherwise, reap available completions or block in the kernel (without
+ *  the ring lock) until one arrives.
+ *
+ * @param       ring        Pointer to Uring structure.
+ *
+ * @return      Whether or not waiting succeeded.
+ **/
+bool    uring_wait_any(Uring *ring) {
+    // submit queued requests
+    if (!uring_enter(ring))
+        return false;
+
+    // wait for thread blocked in kernel
+    if (ring->waiting) {
+        pthread_cond_wait(&ring->cond, &ring->lock);
+        return true;
+    }
+
+    // reap available completions or block in kernel
+    if (uring_reap(ring))
+        return true;
+
+    ring->waiting = true;
+    pthread_mutex_unlock(&ring->lock);
+
+    int n;
+    do {
+        n = syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (n < 0 && errno == EINTR);
+
+    pthread_mutex_lock(&ring->lock);
+    ring->waiting = false;
+    ring->enters++;
+    uring_reap(ring);
+    pthread_cond_broadcast(&ring->cond);
+    return n >= 0;
+}
+
+/**
+ * Reap all available completions (the ring lock must be held).
+ *
+ * @param       ring        Pointer to Uring structure.
+ *
+ * @return      Number of completions reaped.
+ **/
+size_t  uring_reap(Uring *ring) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    size_t   reaped = 0;
+
+    for (; head != tail; head++, reaped++) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        uring_complete(ring, (UringRequest *)(uintptr_t)cqe->user_data, cqe->res);
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    ring->completions += reaped;
+
+    // submit resubmitted short transfers (failing them if that is impossible)
+    if (ring->queued && !uring_enter(ring))
+        error("Unable to resubmit short transfers: %s", strerror(errno));
+    return reaped;
+}
+
+/**
+ * Handle completion of request (the ring lock must be held) by doing the
+ * following:
+ *
+ *  1. On a short transfer, advance the request past the transferred data and
+ *  queue the remainder again.
+ *
+ *  2. Otherwise, record the result (-1 on error or unexpected end of file),
+ *  mark the request complete, and run its callback.
+ *
+ * @param       ring        Pointer to Uring structure.
+ * @param       request     Completed request.
+ * @param       res         Result reported by the kernel.
+ **/
+void    uring_complete(Uring *ring, UringRequest *request, int res) {
+    if (res > 0) {
+        request->result += res;
+        request->offset += res;
+
+        // resubmit remainder of short transfer
+        while (request->niov && (size_t)res >= request->iov->iov_len) {
+            res -= request->iov->iov_len;
+            request->iov++;
+            request->niov--;
+        }
+        if (request->niov) {
+            request->iov->iov_base  = (char *)request->iov->iov_base + res;
+            request->iov->iov_len  -= res;
+            uring_push(ring, request);
+            return;
+        }
+    } else {
+        request->result = -1;
+    }
+
+    ring->inflight--;
+    request->complete = true;
+    if (request->callback)
+        request->callback(request);
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
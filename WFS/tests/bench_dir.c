@@ -0,0 +1,152 @@
+/* bench_dir.c: SimpleFS directory metadata workloads
+ *
+ * Usage: bench_dir ENTRIES
+ *
+ * Formats a scratch disk image, creates ENTRIES empty files in a single
+ * directory, looks each of them up in random order, lists the directory, and
+ * unlinks every file.  Prints a line per workload:
+ *
+ *  result WORKLOAD ENTRIES SECONDS BLOCK_READS DIRECTORY_BLOCKS
+ *
+ * BLOCK_READS counts block lookups in the block cache (hits and misses), so
+ * it reflects the blocks an operation touches rather than cache behavior.
+ **/
+
+#include "sfs/cache.h"
+#include "sfs/disk.h"
+#include "sfs/fs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Constants */
+
+#define BENCH_IMAGE     "data/image.bench_dir"
+#define BENCH_DIR       "/bench"
+
+/* Global Variables */
+
+static FileSystem   FS      = {0};
+static Disk *       Image   = NULL;
+static size_t       Entries = 0;
+
+/* Internal Functions */
+
+static size_t block_reads() {
+    return Image->cache ? Image->cache->hits + Image->cache->misses : Image->reads;
+}
+
+static double elapsed(struct timespec *start) {
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    return (stop.tv_sec - start->tv_sec) + (stop.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void report(const char *workload, struct timespec *start, size_t reads) {
+    double seconds = elapsed(start);
+    printf("result %s %lu %.6f %lu %ld\n", workload, Entries, seconds,
+        block_reads() - reads, fs_stat(&FS, fs_lookup(&FS, BENCH_DIR)) / BLOCK_SIZE);
+    fflush(stdout);
+}
+
+static void path(char *buffer, size_t i) {
+    snprintf(buffer, BUFSIZ, BENCH_DIR "/entry-%lu", i);
+}
+
+static void fail(const char *operation, size_t i) {
+    fprintf(stderr, "%s of entry %lu failed\n", operation, i);
+    exit(EXIT_FAILURE);
+}
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s ENTRIES\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Entries = strtoul(argv[1], NULL, 10);
+    if (!Entries) {
+        fprintf(stderr, "Invalid ENTRIES\n");
+        return EXIT_FAILURE;
+    }
+
+    // Format and mount scratch image with an inode per entry (inodes take 10%)
+    size_t blocks = (Entries / INODES_PER_BLOCK + 2) * 10 + Entries / 16 + 1000;
+    unlink(BENCH_IMAGE);
+    Image = disk_open(BENCH_IMAGE, blocks);
+    if (!Image || !fs_format(&FS, Image) || !fs_mount(&FS, Image) || fs_mkdir(&FS, BENCH_DIR) < 0) {
+        fprintf(stderr, "Unable to create %s\n", BENCH_IMAGE);
+        return EXIT_FAILURE;
+    }
+
+    char            buffer[BUFSIZ];
+    struct timespec start;
+    size_t          reads;
+
+    // create: add every entry to the directory
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    reads = block_reads();
+    for (size_t i = 0; i < Entries; i++) {
+        path(buffer, i);
+        if (fs_create_path(&FS, buffer) < 0)
+            fail("create", i);
+    }
+    fs_sync(&FS);
+    report("create", &start, reads);
+
+    // lookup: resolve every entry in random order
+    size_t *order = malloc(Entries * sizeof(size_t));
+    for (size_t i = 0; i < Entries; i++)
+        order[i] = i;
+    srand(Entries);
+    for (size_t i = Entries - 1; i > 0; i--) {
+        size_t j = rand() % (i + 1);
+        size_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    reads = block_reads();
+    for (size_t i = 0; i < Entries; i++) {
+        path(buffer, order[i]);
+        if (fs_lookup(&FS, buffer) < 0)
+            fail("lookup", order[i]);
+    }
+    report("lookup", &start, reads);
+
+    // readdir: list the whole directory
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    reads = block_reads();
+    size_t    count;
+    DirEntry *entries = fs_readdir(&FS, BENCH_DIR, &count);
+    if (!entries || count != Entries)
+        fail("readdir", count);
+    free(entries);
+    report("readdir", &start, reads);
+
+    // unlink: remove every entry in random order
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    reads = block_reads();
+    for (size_t i = 0; i < Entries; i++) {
+        path(buffer, order[i]);
+        if (!fs_unlink(&FS, buffer))
+            fail("unlink", order[i]);
+    }
+    fs_sync(&FS);
+    report("unlink", &start, reads);
+
+    free(order);
+    fs_unmount(&FS);
+    disk_close(Image);
+    unlink(BENCH_IMAGE);
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
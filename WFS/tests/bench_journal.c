@@ -0,0 +1,162 @@
+/* bench_journal.c: SimpleFS synchronous metadata workloads with and without the journal
+ *
+ * Usage: bench_journal FILES
+ *
+ * Formats a scratch disk image twice: once as is (journaled) and once with
+ * the journal dropped from the superblock (FS_VERSION_EXTENTS, where every
+ * fs_sync writes back the bitmap and all dirty blocks in place).  On each,
+ * creates FILES files with a block of data each and then rewrites the start
+ * of every file, calling fs_sync after every operation, and unmounts (which
+ * checkpoints the journal).  Prints a line per workload:
+ *
+ *  result MODE WORKLOAD FILES SECONDS BLOCK_WRITES WRITE_CALLS
+ *
+ * BLOCK_WRITES counts blocks written to the disk image and WRITE_CALLS the
+ * write system calls issued (from /proc/self/io), so the unmount line shows
+ * the deferred home block writes the journal still owes.
+ **/
+
+#include "sfs/disk.h"
+#include "sfs/fs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Constants */
+
+#define BENCH_IMAGE     "data/image.bench_journal"
+
+/* Global Variables */
+
+static FileSystem   FS      = {0};
+static Disk *       Image   = NULL;
+static size_t       Files   = 0;
+
+/* Internal Functions */
+
+static size_t write_calls() {
+    char   buffer[BUFSIZ];
+    size_t calls = 0;
+    FILE  *stream = fopen("/proc/self/io", "r");
+    if (!stream)
+        return 0;
+
+    while (fgets(buffer, BUFSIZ, stream)) {
+        if (sscanf(buffer, "syscw: %lu", &calls) == 1)
+            break;
+    }
+    fclose(stream);
+    return calls;
+}
+
+static double elapsed(struct timespec *start) {
+    struct timespec stop;
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    return (stop.tv_sec - start->tv_sec) + (stop.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void report(const char *mode, const char *workload, struct timespec *start, size_t writes, size_t calls) {
+    double seconds = elapsed(start);
+    size_t syscalls = write_calls();
+    printf("result %s %s %lu %.6f %lu %lu\n", mode, workload, Files, seconds,
+        Image->writes - writes, syscalls - calls);
+    fflush(stdout);
+}
+
+static void fail(const char *operation, size_t i) {
+    fprintf(stderr, "%s of file %lu failed\n", operation, i);
+    exit(EXIT_FAILURE);
+}
+
+static void bench(const char *mode, bool journal) {
+    // Format scratch image (dropping the journal for the baseline)
+    size_t blocks = Files * 2 + 4000;
+    unlink(BENCH_IMAGE);
+    Image = disk_open_backend(BENCH_IMAGE, blocks, DISK_FD);
+    if (!Image || !fs_format(&FS, Image)) {
+        fprintf(stderr, "Unable to create %s\n", BENCH_IMAGE);
+        exit(EXIT_FAILURE);
+    }
+
+    Block super;
+    if (!journal) {
+        if (disk_read(Image, 0, super.data) == DISK_FAILURE)
+            fail("format", 0);
+        super.super.version        = FS_VERSION_EXTENTS;
+        super.super.journal_blocks = 0;
+        if (disk_write(Image, 0, super.data) == DISK_FAILURE || !disk_sync(Image))
+            fail("format", 0);
+    }
+
+    if (!fs_mount(&FS, Image) || !FS.meta_data.journal_blocks != !journal) {
+        fprintf(stderr, "Unable to mount %s\n", BENCH_IMAGE);
+        exit(EXIT_FAILURE);
+    }
+
+    char            buffer[BUFSIZ];
+    char            data[BLOCK_SIZE];
+    ssize_t        *inodes = calloc(Files, sizeof(ssize_t));
+    struct timespec start;
+    size_t          writes, calls;
+
+    memset(data, 'j', BLOCK_SIZE);
+
+    // create: add a file with one block of data and sync
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    writes = Image->writes;
+    calls  = write_calls();
+    for (size_t i = 0; i < Files; i++) {
+        snprintf(buffer, BUFSIZ, "/file-%lu", i);
+        if ((inodes[i] = fs_create_path(&FS, buffer)) < 0)
+            fail("create", i);
+        if (fs_write(&FS, inodes[i], data, BLOCK_SIZE, 0) != BLOCK_SIZE || !fs_sync(&FS))
+            fail("write", i);
+    }
+    report(mode, "create", &start, writes, calls);
+
+    // update: rewrite the start of each file and sync
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    writes = Image->writes;
+    calls  = write_calls();
+    for (size_t i = 0; i < Files; i++) {
+        if (fs_write(&FS, inodes[i], data, 64, 0) != 64 || !fs_sync(&FS))
+            fail("update", i);
+    }
+    report(mode, "update", &start, writes, calls);
+
+    // unmount: write back everything still owed to home locations
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    writes = Image->writes;
+    calls  = write_calls();
+    fs_unmount(&FS);
+    report(mode, "unmount", &start, writes, calls);
+
+    free(inodes);
+    disk_close(Image);
+    unlink(BENCH_IMAGE);
+}
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s FILES\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Files = strtoul(argv[1], NULL, 10);
+    if (!Files) {
+        fprintf(stderr, "Invalid FILES\n");
+        return EXIT_FAILURE;
+    }
+
+    bench("journal", true);
+    bench("nojournal", false);
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,192 @@
+/* bench_mt.c: multithreaded SimpleFS read/write throughput workloads
+ *
+ * Usage: bench_mt WORKLOAD THREADS
+ *
+ * Formats a scratch disk image, runs a fixed amount of I/O per thread (so
+ * ideal scaling keeps bytes/sec proportional to the number of threads),
+ * verifies the file contents, and prints a single line:
+ *
+ *  result WORKLOAD THREADS BYTES SECONDS
+ **/
+
+#include "sfs/disk.h"
+#include "sfs/fs.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Constants */
+
+#define BENCH_IMAGE     "data/image.bench"
+#define FILE_BYTES      (1<<24)     /* Size of each file (16 MB) */
+#define CHUNK_BYTES     (1<<16)     /* Bytes per read or write call */
+#define READ_PASSES     (4)         /* Passes over file by read workloads */
+#define MAX_THREADS     (1<<6)
+
+/* Workload Structure */
+
+typedef struct Workload Workload;
+struct Workload {
+    const char *name;
+    void *      (*run)(void *arg);
+    bool        prefill;            /* Whether files are written before the clock starts */
+};
+
+/* Global Variables */
+
+static size_t       Threads = 1;
+static FileSystem   FS      = {0};
+static ssize_t      Inodes[MAX_THREADS];
+
+/* Internal Functions */
+
+static void fill_chunk(char *chunk, size_t t, size_t offset) {
+    memset(chunk, 'a' + (t + offset / CHUNK_BYTES) % 26, CHUNK_BYTES);
+}
+
+static uintptr_t read_file(size_t t, ssize_t inode_number) {
+    char     *chunk = malloc(CHUNK_BYTES);
+    uintptr_t bytes = 0;
+    File     *file  = fs_open(&FS, inode_number);
+
+    for (size_t pass = 0; file && pass < READ_PASSES; pass++) {
+        for (size_t offset = 0; offset < FILE_BYTES; offset += CHUNK_BYTES) {
+            ssize_t n = fs_file_read(file, chunk, CHUNK_BYTES, offset);
+            if (n != CHUNK_BYTES || chunk[0] != 'a' + (t + offset / CHUNK_BYTES) % 26) {
+                fprintf(stderr, "read of inode %ld at %lu failed\n", inode_number, offset);
+                exit(EXIT_FAILURE);
+            }
+            bytes += n;
+        }
+    }
+
+    fs_close(file);
+    free(chunk);
+    return bytes;
+}
+
+static uintptr_t write_file(size_t t, ssize_t inode_number) {
+    char     *chunk = malloc(CHUNK_BYTES);
+    uintptr_t bytes = 0;
+    File     *file  = fs_open(&FS, inode_number);
+
+    for (size_t offset = 0; file && offset < FILE_BYTES; offset += CHUNK_BYTES) {
+        fill_chunk(chunk, t, offset);
+        ssize_t n = fs_file_write(file, chunk, CHUNK_BYTES, offset);
+        if (n != CHUNK_BYTES) {
+            fprintf(stderr, "write of inode %ld at %lu failed\n", inode_number, offset);
+            exit(EXIT_FAILURE);
+        }
+        bytes += n;
+    }
+
+    if (!fs_close(file)) {
+        fprintf(stderr, "close of inode %ld failed\n", inode_number);
+        exit(EXIT_FAILURE);
+    }
+    free(chunk);
+    return bytes;
+}
+
+/* Workloads */
+
+/* read: each thread reads its own file sequentially */
+void *read_private(void *arg) {
+    size_t t = (uintptr_t)arg;
+    return (void *)read_file(t, Inodes[t]);
+}
+
+/* shared-read: every thread reads the same file sequentially */
+void *read_shared(void *arg) {
+    return (void *)read_file(0, Inodes[0]);
+}
+
+/* write: each thread writes its own new file sequentially */
+void *write_private(void *arg) {
+    size_t t = (uintptr_t)arg;
+    return (void *)write_file(t, Inodes[t]);
+}
+
+static Workload Workloads[] = {
+    {"read",            read_private,   true},
+    {"shared-read",     read_shared,    true},
+    {"write",           write_private,  false},
+    {NULL,              NULL,           false},
+};
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s WORKLOAD THREADS\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Workload *workload = Workloads;
+    while (workload->name && strcmp(workload->name, argv[1])) {
+        workload++;
+    }
+
+    Threads = strtoul(argv[2], NULL, 10);
+    if (!workload->name || !Threads || Threads > MAX_THREADS) {
+        fprintf(stderr, "Unknown WORKLOAD or invalid THREADS\n");
+        return EXIT_FAILURE;
+    }
+
+    // Format and mount scratch image with room for a file per thread
+    size_t blocks = Threads * (FILE_BYTES / BLOCK_SIZE) * 5 / 4 + 1000;
+    unlink(BENCH_IMAGE);
+    Disk *disk = disk_open(BENCH_IMAGE, blocks);
+    if (!disk || !fs_format(&FS, disk) || !fs_mount(&FS, disk)) {
+        fprintf(stderr, "Unable to create %s\n", BENCH_IMAGE);
+        return EXIT_FAILURE;
+    }
+
+    // Set up files before the clock starts
+    for (size_t t = 0; t < Threads; t++) {
+        Inodes[t] = fs_create(&FS);
+        if (workload->prefill)
+            write_file(t, Inodes[t]);
+    }
+    fs_sync(&FS);
+
+    struct timespec start, stop;
+    pthread_t       threads[MAX_THREADS];
+    size_t          bytes = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uintptr_t t = 0; t < Threads; t++) {
+        pthread_create(&threads[t], NULL, workload->run, (void *)t);
+    }
+    for (size_t t = 0; t < Threads; t++) {
+        void *result;
+        pthread_join(threads[t], &result);
+        bytes += (uintptr_t)result;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    // Verify every file after the clock stops
+    for (size_t t = 0; t < Threads; t++) {
+        if (fs_stat(&FS, Inodes[t]) != FILE_BYTES) {
+            fprintf(stderr, "inode %ld has wrong size\n", Inodes[t]);
+            return EXIT_FAILURE;
+        }
+        read_file(t, Inodes[t]);
+    }
+
+    fs_unmount(&FS);
+    disk_close(disk);
+    unlink(BENCH_IMAGE);
+
+    double seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    printf("result %s %lu %lu %.6f\n", workload->name, Threads, bytes, seconds);
+    fflush(stdout);
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,228 @@
+/* unit_cache.c: Unit tests for SimpleFS block buffer cache */
+
+#include "sfs/cache.h"
+#include "sfs/disk.h"
+#include "sfs/logging.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+
+/* Constants */
+
+#define DISK_PATH   "unit_cache.image"
+#define DISK_BLOCKS (16)
+
+/* Functions */
+
+void test_cleanup() {
+    unlink(DISK_PATH);
+}
+
+int test_00_cache_create() {
+    debug("Check minimum capacity");
+    Cache *cache = cache_create(0);
+    assert(cache);
+    assert(cache->capacity == CACHE_MIN_BLOCKS);
+    assert(cache->count    == 0);
+    assert(cache->hits     == 0);
+    assert(cache->misses   == 0);
+    assert(cache->nbuckets >= 2 * cache->capacity);
+    assert((cache->nbuckets & (cache->nbuckets - 1)) == 0);
+    cache_delete(cache);
+
+    debug("Check capacity");
+    cache = cache_create(CACHE_BLOCKS);
+    assert(cache);
+    assert(cache->capacity == CACHE_BLOCKS);
+    cache_delete(cache);
+
+    return EXIT_SUCCESS;
+}
+
+int test_01_cache_lookup() {
+    Cache *cache = cache_create(CACHE_MIN_BLOCKS);
+    assert(cache);
+
+    debug("Check miss");
+    assert(cache_lookup(cache, 0) == NULL);
+    assert(cache->misses == 1);
+
+    debug("Check hit");
+    CacheEntry *entry = cache_insert(cache, 0);
+    assert(entry);
+    assert(entry->block == 0);
+    assert(cache->count == 1);
+    assert(cache_lookup(cache, 0) == entry);
+    assert(cache->hits   == 1);
+    assert(cache->misses == 1);
+
+    debug("Check find does not count");
+    assert(cache_find(cache, 0) == entry);
+    assert(cache_find(cache, 1) == NULL);
+    assert(cache->hits   == 1);
+    assert(cache->misses == 1);
+
+    debug("Check remove");
+    cache_remove(cache, 0);
+    assert(cache->count == 0);
+    assert(cache_find(cache, 0) == NULL);
+
+    cache_delete(cache);
+    return EXIT_SUCCESS;
+}
+
+int test_02_cache_evict() {
+    Cache *cache = cache_create(CACHE_MIN_BLOCKS);
+    assert(cache);
+
+    debug("Check least recently used block is evicted");
+    for (size_t b = 0; b < CACHE_MIN_BLOCKS; b++)
+        assert(cache_insert(cache, b));
+
+    assert(cache_lookup(cache, 0));
+    assert(cache_insert(cache, CACHE_MIN_BLOCKS));
+    assert(cache->count == CACHE_MIN_BLOCKS);
+    assert(cache_find(cache, 0));
+    assert(cache_find(cache, 1) == NULL);
+
+    debug("Check pinned blocks are not evicted");
+    for (size_t b = 0; b <= CACHE_MIN_BLOCKS; b++) {
+        CacheEntry *entry = cache_find(cache, b);
+        if (entry)
+            cache_pin(entry);
+    }
+    assert(cache_insert(cache, DISK_BLOCKS) == NULL);
+
+    CacheEntry *entry = cache_find(cache, 2);
+    assert(entry);
+    cache_remove(cache, 2);
+    assert(cache_find(cache, 2) == entry);
+
+    cache_unpin(entry);
+    assert(cache_insert(cache, DISK_BLOCKS) == entry);
+    assert(cache_find(cache, 2) == NULL);
+
+    cache_delete(cache);
+    return EXIT_SUCCESS;
+}
+
+int test_03_disk_cache() {
+    Disk *disk = disk_open_backend(DISK_PATH, DISK_BLOCKS, DISK_FD);
+    assert(disk);
+
+    char data[BLOCK_SIZE];
+
+    debug("Check write-back and cached reads");
+    for (size_t b = 0; b < DISK_BLOCKS; b++) {
+        memset(data, b, BLOCK_SIZE);
+        assert(disk_write(disk, b, data) == BLOCK_SIZE);
+        assert(disk->writes == 0);
+    }
+    assert(disk->cache->dirty == DISK_BLOCKS);
+
+    for (size_t b = 0; b < DISK_BLOCKS; b++) {
+        memset(data, 0, BLOCK_SIZE);
+        assert(disk_read(disk, b, data) == BLOCK_SIZE);
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+            assert(data[i] == (char)b);
+    }
+    assert(disk->reads        == 0);
+    assert(disk->cache->hits  == DISK_BLOCKS);
+
+    debug("Check sync");
+    assert(disk_sync(disk));
+    assert(disk->writes        == DISK_BLOCKS);
+    assert(disk->cache->dirty  == 0);
+    assert(disk_sync(disk));
+    assert(disk->writes        == DISK_BLOCKS);
+
+    debug("Check pin");
+    assert(disk_pin(disk, DISK_BLOCKS) == NULL);
+
+    char *pinned = disk_pin(disk, 1);
+    assert(pinned);
+    assert(pinned[0] == 1);
+
+    memset(data, 2, BLOCK_SIZE);
+    assert(disk_write(disk, 1, data) == BLOCK_SIZE);
+    assert(pinned[0] == 2);
+    disk_unpin(disk, pinned);
+
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_04_disk_pressure() {
+    setenv(CACHE_BLOCKS_ENV, "4", 1);
+    Disk *disk = disk_open_backend(DISK_PATH, DISK_BLOCKS, DISK_FD);
+    assert(disk);
+    assert(disk->cache->capacity == 4);
+
+    char data[BLOCK_SIZE];
+
+    debug("Check dirty blocks are written back in block order under pressure");
+    for (size_t b = DISK_BLOCKS; b > 0; b--) {
+        memset(data, b - 1, BLOCK_SIZE);
+        assert(disk_write(disk, b - 1, data) == BLOCK_SIZE);
+        assert(disk->cache->dirty <= 4);
+    }
+    assert(disk->writes == DISK_BLOCKS - 4);
+    assert(disk_sync(disk));
+    assert(disk->writes == DISK_BLOCKS);
+
+    for (size_t b = 0; b < DISK_BLOCKS; b++) {
+        assert(disk_read(disk, b, data) == BLOCK_SIZE);
+        assert(data[0] == (char)b);
+    }
+
+    debug("Check reads of uncached blocks never write back dirty blocks");
+    for (size_t b = 0; b < 4; b++) {
+        memset(data, b + 1, BLOCK_SIZE);
+        assert(disk_write(disk, b, data) == BLOCK_SIZE);
+    }
+    size_t writes = disk->writes;
+    assert(disk_read(disk, DISK_BLOCKS - 1, data) == BLOCK_SIZE);
+    assert(data[0] == (char)(DISK_BLOCKS - 1));
+    assert(disk->writes == writes);
+    assert(disk->cache->dirty == 4);
+    assert(disk_sync(disk));
+
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+/* Main execution */
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s NUMBER\n\n", argv[0]);
+        fprintf(stderr, "Where NUMBER is right of the following:\n");
+        fprintf(stderr, "    0. Test cache_create\n");
+        fprintf(stderr, "    1. Test cache_lookup\n");
+        fprintf(stderr, "    2. Test cache_evict\n");
+        fprintf(stderr, "    3. Test disk_cache\n");
+        fprintf(stderr, "    4. Test disk_pressure\n");
+        return EXIT_FAILURE;
+    }
+
+    int number = atoi(argv[1]);
+    int status = EXIT_FAILURE;
+
+    atexit(test_cleanup);
+
+    switch (number) {
+        case 0:  status = test_00_cache_create(); break;
+        case 1:  status = test_01_cache_lookup(); break;
+        case 2:  status = test_02_cache_evict(); break;
+        case 3:  status = test_03_disk_cache(); break;
+        case 4:  status = test_04_disk_pressure(); break;
+        default: fprintf(stderr, "Unknown NUMBER: %d\n", number); break;
+    }
+
+    return status;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
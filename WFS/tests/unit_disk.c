@@ -1,5 +1,6 @@
 /* unit_disk.c: Unit tests for SimpleFS disk emulator */
 
+#include "sfs/cache.h"
 #include "sfs/disk.h"
 #include "sfs/logging.h"
 
@@ -42,7 +43,7 @@ int test_00_disk_open() {
 }
 
 int test_01_disk_read() {
-    Disk *disk = disk_open(DISK_PATH, DISK_BLOCKS);
+    Disk *disk = disk_open_backend(DISK_PATH, DISK_BLOCKS, DISK_FD);
     assert(disk);
 
     char data[DISK_BLOCKS*BLOCK_SIZE] = {0};
@@ -74,7 +75,7 @@ int test_01_disk_read() {
 }
 
 int test_02_disk_write() {
-    Disk *disk = disk_open(DISK_PATH, DISK_BLOCKS);
+    Disk *disk = disk_open_backend(DISK_PATH, DISK_BLOCKS, DISK_FD);
     assert(disk);
     
     char data[BLOCK_SIZE] = {0};
@@ -100,12 +101,155 @@ int test_02_disk_write() {
             assert(data[i] == b);
         }
 
+        assert(disk->writes == b);
+        assert(disk_sync(disk));
         assert(disk->writes == b + 1);
     }
     disk_close(disk);
     return EXIT_SUCCESS;
 }
 
+int test_03_disk_vector() {
+    Disk *disk = disk_open_backend(DISK_PATH, DISK_BLOCKS, DISK_FD);
+    assert(disk);
+
+    char  blocks[DISK_BLOCKS][BLOCK_SIZE];
+    char *data[DISK_BLOCKS];
+    for (size_t b = 0; b < DISK_BLOCKS; b++) {
+        memset(blocks[b], b + 1, BLOCK_SIZE);
+        data[b] = blocks[b];
+    }
+
+    debug("Check bad disk");
+    assert(disk_writev(NULL, 0, data, DISK_BLOCKS) == DISK_FAILURE);
+    assert(disk_readv(NULL, 0, data, DISK_BLOCKS) == DISK_FAILURE);
+
+    debug("Check bad range");
+    assert(disk_writev(disk, 1, data, DISK_BLOCKS) == DISK_FAILURE);
+    assert(disk_readv(disk, DISK_BLOCKS, data, 1) == DISK_FAILURE);
+
+    debug("Check vectored write");
+    assert(disk_writev(disk, 0, data, DISK_BLOCKS) == DISK_BLOCKS * BLOCK_SIZE);
+    assert(disk->writes == DISK_BLOCKS);
+
+    debug("Check vectored read (with cached dirty block)");
+    char block[BLOCK_SIZE];
+    memset(block, 0xff, BLOCK_SIZE);
+    assert(disk_write(disk, 2, block) == BLOCK_SIZE);
+
+    memset(blocks, 0, sizeof(blocks));
+    assert(disk_readv(disk, 0, data, DISK_BLOCKS) == DISK_BLOCKS * BLOCK_SIZE);
+    for (size_t b = 0; b < DISK_BLOCKS; b++) {
+        for (size_t i = 0; i < BLOCK_SIZE; i++) {
+            assert(blocks[b][i] == (b == 2 ? (char)0xff : (char)(b + 1)));
+        }
+    }
+
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_04_disk_mmap() {
+    Disk *disk = disk_open_backend(DISK_PATH, DISK_BLOCKS, DISK_MMAP);
+    assert(disk);
+    assert(disk->map);
+    assert(disk->cache == NULL);
+
+    char block[BLOCK_SIZE];
+    char copy[BLOCK_SIZE];
+
+    debug("Check writes go to mapped image");
+    for (size_t b = 0; b < DISK_BLOCKS; b++) {
+        memset(block, b + 1, BLOCK_SIZE);
+        assert(disk_write(disk, b, block) == BLOCK_SIZE);
+        assert(disk->map[b * BLOCK_SIZE] == b + 1);
+    }
+    assert(disk->writes == DISK_BLOCKS);
+    assert(disk_write(disk, DISK_BLOCKS, block) == DISK_FAILURE);
+
+    debug("Check reads and block pointers come from mapped image");
+    assert(disk_read(disk, 1, copy) == BLOCK_SIZE);
+    assert(copy[0] == 2 && copy[BLOCK_SIZE - 1] == 2);
+    assert(disk_pin(disk, 2) == disk->map + 2 * BLOCK_SIZE);
+    disk_unpin(disk, disk->map + 2 * BLOCK_SIZE);
+    assert(disk_map(disk, 1, DISK_BLOCKS - 1) == disk->map + BLOCK_SIZE);
+    assert(disk_map(disk, 1, DISK_BLOCKS) == NULL);
+
+    debug("Check synced image is seen by fd backend");
+    assert(disk_sync(disk));
+    disk_close(disk);
+
+    disk = disk_open_backend(DISK_PATH, DISK_BLOCKS, DISK_FD);
+    assert(disk);
+    assert(disk_map(disk, 0, 1) == NULL);
+    for (size_t b = 0; b < DISK_BLOCKS; b++) {
+        assert(disk_read(disk, b, copy) == BLOCK_SIZE);
+        assert(copy[0] == b + 1);
+    }
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_05_disk_uring() {
+    Disk *disk = disk_open_backend(DISK_PATH, DISK_BLOCKS, DISK_URING);
+    assert(disk);
+    assert(disk->cache);
+
+    char block[BLOCK_SIZE];
+    char copy[DISK_BLOCKS * BLOCK_SIZE];
+
+    debug("Check dirty blocks are flushed");
+    for (size_t b = 0; b < DISK_BLOCKS / 2; b++) {
+        memset(block, b + 1, BLOCK_SIZE);
+        assert(disk_write(disk, b, block) == BLOCK_SIZE);
+    }
+    assert(disk_sync(disk));
+    assert(disk->writes == DISK_BLOCKS / 2);
+    assert(disk->cache->dirty == 0);
+    assert(pread(disk->fd, copy, BLOCK_SIZE, BLOCK_SIZE) == BLOCK_SIZE);
+    assert(copy[0] == 2);
+
+    debug("Check bad requests");
+    DiskRequest requests[2];
+    memset(requests, 0, sizeof(requests));
+    assert(disk_read_async(NULL, requests, 1) == false);
+    assert(disk_read_async(disk, requests, 1) == false);
+    requests[0].data  = copy;
+    requests[0].block = DISK_BLOCKS;
+    requests[0].count = 1;
+    assert(disk_read_async(disk, requests, 1) == false);
+    assert(disk_wait(disk, NULL) == DISK_FAILURE);
+
+    debug("Check asynchronous reads (with cached dirty block)");
+    memset(block, 0xff, BLOCK_SIZE);
+    assert(pwrite(disk->fd, block, BLOCK_SIZE, 2 * BLOCK_SIZE) == BLOCK_SIZE);
+    memset(block, 4, BLOCK_SIZE);
+    assert(pwrite(disk->fd, block, BLOCK_SIZE, 3 * BLOCK_SIZE) == BLOCK_SIZE);
+    memset(block, 0xee, BLOCK_SIZE);
+    assert(disk_write(disk, 1, block) == BLOCK_SIZE);
+
+    memset(copy, 0, sizeof(copy));
+    requests[0].block = 0;
+    requests[0].count = 2;
+    requests[0].data  = copy;
+    requests[1].block = 2;
+    requests[1].count = 2;
+    requests[1].data  = copy + 2 * BLOCK_SIZE;
+    assert(disk_read_async(disk, requests, 2));
+    assert(disk_wait(disk, &requests[1]) == 2 * BLOCK_SIZE);
+    assert(disk_wait(disk, &requests[0]) == 2 * BLOCK_SIZE);
+    assert(copy[0]              == 1);
+    assert(copy[BLOCK_SIZE]     == (char)0xee);
+    assert(copy[2 * BLOCK_SIZE] == (char)0xff);
+    assert(copy[3 * BLOCK_SIZE] == 4);
+
+    debug("Check flush and uncached read went through io_uring (if available)");
+    assert(!disk->uring || disk->uring->completions == 2);
+
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
 /* Main execution */
 
 int main(int argc, char *argv[]) {
@@ -115,6 +259,9 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "    0. Test disk_open\n");
         fprintf(stderr, "    1. Test disk_read\n");
         fprintf(stderr, "    2. Test disk_write\n");
+        fprintf(stderr, "    3. Test disk_vector\n");
+        fprintf(stderr, "    4. Test disk_mmap\n");
+        fprintf(stderr, "    5. Test disk_uring\n");
         return EXIT_FAILURE;
     }
 
@@ -127,6 +274,9 @@ int main(int argc, char *argv[]) {
         case 0:  status = test_00_disk_open(); break;
         case 1:  status = test_01_disk_read(); break;
         case 2:  status = test_02_disk_write(); break;
+        case 3:  status = test_03_disk_vector(); break;
+        case 4:  status = test_04_disk_mmap(); break;
+        case 5:  status = test_05_disk_uring(); break;
         default: fprintf(stderr, "Unknown NUMBER: %d\n", number); break;
     }
 
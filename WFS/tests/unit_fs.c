@@ -1,11 +1,13 @@
 /* unit_fs.c: Unit tests for SimpleFS file system */
 
+#include "sfs/cache.h"
 #include "sfs/fs.h"
 #include "sfs/logging.h"
 
 #include <assert.h>
 #include <limits.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <unistd.h>
 
@@ -15,6 +17,20 @@ void test_cleanup() {
     unlink("data/image.unit");
 }
 
+void test_crash(FileSystem *fs, Disk *disk) {
+    /* drop dirty cached blocks and in-memory state without writing them back */
+    uring_delete(disk->uring);
+    close(disk->fd);
+    pthread_mutex_destroy(&disk->lock);
+    cache_delete(disk->cache);
+    free(disk);
+    free(fs->free_blocks);
+    free(fs->journal);
+    free(fs->journal_freed);
+    free(fs->journal_revoked);
+    *fs = (FileSystem){0};
+}
+
 int test_00_fs_mount() {
     Disk *disk = disk_open("data/image.5", 5);
     assert(disk);
@@ -24,11 +40,11 @@ int test_00_fs_mount() {
     assert(fs_mount(&fs, disk));
     assert(fs.disk           == disk);
     assert(fs.free_blocks);
-    assert(fs.free_blocks[0] == false);
-    assert(fs.free_blocks[1] == false);
-    assert(fs.free_blocks[2] == false);
-    assert(fs.free_blocks[3] == true);
-    assert(fs.free_blocks[4] == true);
+    assert(fs_is_free_block(&fs, 0) == false);
+    assert(fs_is_free_block(&fs, 1) == false);
+    assert(fs_is_free_block(&fs, 2) == false);
+    assert(fs_is_free_block(&fs, 3) == true);
+    assert(fs_is_free_block(&fs, 4) == true);
 
     debug("Check mounting filesystem (already mounted)");
     assert(fs_mount(&fs, disk) == false);
@@ -43,26 +59,26 @@ int test_00_fs_mount() {
     assert(fs_mount(&fs, disk));
     assert(fs.disk           == disk);
     assert(fs.free_blocks);
-    assert(fs.free_blocks[0] == false);
-    assert(fs.free_blocks[1] == false);
-    assert(fs.free_blocks[2] == false);
-    assert(fs.free_blocks[3] == true);
-    assert(fs.free_blocks[4] == false);
-    assert(fs.free_blocks[5] == false);
-    assert(fs.free_blocks[6] == false);
-    assert(fs.free_blocks[7] == false);
-    assert(fs.free_blocks[8] == false);
-    assert(fs.free_blocks[9] == false);
-    assert(fs.free_blocks[10] == false);
-    assert(fs.free_blocks[11] == false);
-    assert(fs.free_blocks[12] == false);
-    assert(fs.free_blocks[13] == false);
-    assert(fs.free_blocks[14] == false);
-    assert(fs.free_blocks[15] == true);
-    assert(fs.free_blocks[16] == true);
-    assert(fs.free_blocks[17] == true);
-    assert(fs.free_blocks[18] == true);
-    assert(fs.free_blocks[19] == true);
+    assert(fs_is_free_block(&fs, 0) == false);
+    assert(fs_is_free_block(&fs, 1) == false);
+    assert(fs_is_free_block(&fs, 2) == false);
+    assert(fs_is_free_block(&fs, 3) == true);
+    assert(fs_is_free_block(&fs, 4) == false);
+    assert(fs_is_free_block(&fs, 5) == false);
+    assert(fs_is_free_block(&fs, 6) == false);
+    assert(fs_is_free_block(&fs, 7) == false);
+    assert(fs_is_free_block(&fs, 8) == false);
+    assert(fs_is_free_block(&fs, 9) == false);
+    assert(fs_is_free_block(&fs, 10) == false);
+    assert(fs_is_free_block(&fs, 11) == false);
+    assert(fs_is_free_block(&fs, 12) == false);
+    assert(fs_is_free_block(&fs, 13) == false);
+    assert(fs_is_free_block(&fs, 14) == false);
+    assert(fs_is_free_block(&fs, 15) == true);
+    assert(fs_is_free_block(&fs, 16) == true);
+    assert(fs_is_free_block(&fs, 17) == true);
+    assert(fs_is_free_block(&fs, 18) == true);
+    assert(fs_is_free_block(&fs, 19) == true);
 
     debug("Check mounting filesystem (already mounted)");
     assert(fs_mount(&fs, disk) == false);
@@ -115,14 +131,14 @@ int test_02_fs_remove() {
 
     debug("Check removing inode 2");
     assert(fs_remove(&fs, 2));
-    assert(fs.free_blocks[4]);
-    assert(fs.free_blocks[5]);
-    assert(fs.free_blocks[6]);
-    assert(fs.free_blocks[7]);
-    assert(fs.free_blocks[8]);
-    assert(fs.free_blocks[9]);
-    assert(fs.free_blocks[13]);
-    assert(fs.free_blocks[14]);
+    assert(fs_is_free_block(&fs, 4));
+    assert(fs_is_free_block(&fs, 5));
+    assert(fs_is_free_block(&fs, 6));
+    assert(fs_is_free_block(&fs, 7));
+    assert(fs_is_free_block(&fs, 8));
+    assert(fs_is_free_block(&fs, 9));
+    assert(fs_is_free_block(&fs, 13));
+    assert(fs_is_free_block(&fs, 14));
 
     Block block;
     assert(disk_read(fs.disk, 1, block.data) != DISK_FAILURE);
@@ -164,6 +180,709 @@ int test_03_fs_stat() {
     return EXIT_SUCCESS;
 }
 
+int test_04_fs_bitmap() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open("data/image.unit", 200);
+    assert(disk);
+
+    FileSystem fs = {0};
+    debug("Check formatting reserves bitmap block");
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+    assert(fs.meta_data.bitmap_blocks == 1);
+    assert(fs_is_free_block(&fs, 0)   == false);
+    assert(fs_is_free_block(&fs, 20)  == false);
+    assert(fs_is_free_block(&fs, 21)  == true);
+    assert(fs_is_free_block(&fs, 198) == true);
+    assert(fs_is_free_block(&fs, 199) == false);
+    assert(fs_is_free_block(&fs, 200) == false);
+
+    debug("Check allocating lowest free blocks");
+    char data[3 * BLOCK_SIZE] = {0};
+    assert(fs_create(&fs) == 0);
+    assert(fs_write(&fs, 0, data, sizeof(data), 0) == sizeof(data));
+    assert(fs_is_free_block(&fs, 21) == false);
+    assert(fs_is_free_block(&fs, 23) == false);
+    assert(fs_is_free_block(&fs, 24) == true);
+
+    assert(fs_create(&fs) == 1);
+    assert(fs_write(&fs, 1, data, BLOCK_SIZE, 0) == BLOCK_SIZE);
+    assert(fs_is_free_block(&fs, 24) == false);
+
+    debug("Check reusing released blocks");
+    assert(fs_remove(&fs, 0));
+    assert(fs_is_free_block(&fs, 21) == true);
+    assert(fs_create(&fs) == 0);
+    assert(fs_write(&fs, 0, data, BLOCK_SIZE, 0) == BLOCK_SIZE);
+    assert(fs_is_free_block(&fs, 21) == false);
+    assert(fs_is_free_block(&fs, 22) == true);
+
+    debug("Check unmounting stores bitmap");
+    fs_unmount(&fs);
+
+    Block block;
+    assert(disk_read(disk, 199, block.data) != DISK_FAILURE);
+    assert((block.bitmap[0] >> 20 & 1) == 0);
+    assert((block.bitmap[0] >> 21 & 1) == 0);
+    assert((block.bitmap[0] >> 22 & 1) == 1);
+    assert((block.bitmap[0] >> 24 & 1) == 0);
+    assert((block.bitmap[3] >> (198 % 64) & 1) == 1);
+    assert((block.bitmap[3] >> (199 % 64) & 1) == 0);
+
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_05_fs_fast_mount() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open("data/image.unit", 200);
+    assert(disk);
+
+    FileSystem fs = {0};
+    char data[2 * BLOCK_SIZE] = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+    assert(fs_create(&fs) == 0);
+    assert(fs_write(&fs, 0, data, sizeof(data), 0) == sizeof(data));
+
+    debug("Check superblock is marked unclean while mounted");
+    Block block;
+    assert(disk_read(disk, 0, block.data) != DISK_FAILURE);
+    assert(block.super.clean == false);
+
+    fs_unmount(&fs);
+    assert(disk_read(disk, 0, block.data) != DISK_FAILURE);
+    assert(block.super.clean == true);
+    disk_close(disk);
+
+    debug("Check clean mount only reads superblock and bitmap");
+    disk = disk_open("data/image.unit", 200);
+    assert(disk);
+    assert(fs_mount(&fs, disk));
+    assert(disk->reads == 2);
+    assert(fs_is_free_block(&fs, 20) == false);
+    assert(fs_is_free_block(&fs, 21) == false);
+    assert(fs_is_free_block(&fs, 22) == false);
+    assert(fs_is_free_block(&fs, 23) == true);
+    assert(fs_is_free_block(&fs, 199) == false);
+
+    debug("Check unclean mount rebuilds bitmap from inodes");
+    assert(fs_write(&fs, 0, data, BLOCK_SIZE, sizeof(data)) == BLOCK_SIZE);
+    free(fs.free_blocks);
+    disk_close(disk);
+
+    fs = (FileSystem){0};
+    disk = disk_open("data/image.unit", 200);
+    assert(disk);
+    assert(fs_mount(&fs, disk));
+    assert(disk->reads > 2);
+    assert(fs_is_free_block(&fs, 23) == false);
+    assert(fs_is_free_block(&fs, 24) == true);
+
+    fs_unmount(&fs);
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_06_fs_extents() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open("data/image.unit", 4000);
+    assert(disk);
+
+    FileSystem fs = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+    assert(fs.meta_data.version == FS_VERSION_JOURNAL);
+
+    debug("Check writing file larger than pointer format allows");
+    size_t length = 8 * 1024 * 1024 + 100;
+    char *data = malloc(length);
+    char *copy = malloc(length);
+    assert(data && copy);
+    for (size_t i = 0; i < length; i++)
+        data[i] = i % 251;
+
+    assert(fs_create(&fs) == 0);
+    assert(fs_write(&fs, 0, data, length, 0) == length);
+    assert(fs_stat(&fs, 0) == length);
+    assert(fs_read(&fs, 0, copy, length, 0) == length);
+    assert(memcmp(data, copy, length) == 0);
+
+    Block block;
+    assert(fs_sync(&fs));
+    assert(disk_read(disk, 1, block.data) != DISK_FAILURE);
+    assert(block.inodes[0].nextents == 1);
+    assert(block.inodes[0].extents[0].start  == 401);
+    assert(block.inodes[0].extents[0].length == (length + BLOCK_SIZE - 1) / BLOCK_SIZE);
+
+    debug("Check reading and writing unaligned ranges");
+    assert(fs_write(&fs, 0, data, 3 * BLOCK_SIZE, 100) == 3 * BLOCK_SIZE);
+    assert(fs_read(&fs, 0, copy, 3 * BLOCK_SIZE, 100) == 3 * BLOCK_SIZE);
+    assert(memcmp(data, copy, 3 * BLOCK_SIZE) == 0);
+    assert(fs_read(&fs, 0, copy, BLOCK_SIZE, length - 10) == 10);
+    assert(fs_stat(&fs, 0) == length);
+
+    debug("Check fragmented file spills extents");
+    assert(fs_create(&fs) == 1);
+    assert(fs_create(&fs) == 2);
+    for (size_t i = 0; i < 5; i++) {
+        assert(fs_write(&fs, 1, data + i * BLOCK_SIZE, BLOCK_SIZE, i * BLOCK_SIZE) == BLOCK_SIZE);
+        assert(fs_write(&fs, 2, data, BLOCK_SIZE, i * BLOCK_SIZE) == BLOCK_SIZE);
+    }
+
+    assert(fs_sync(&fs));
+    assert(disk_read(disk, 1, block.data) != DISK_FAILURE);
+    assert(block.inodes[1].nextents == 5);
+    assert(block.inodes[1].spill);
+    assert(fs_read(&fs, 1, copy, 5 * BLOCK_SIZE, 0) == 5 * BLOCK_SIZE);
+    assert(memcmp(data, copy, 5 * BLOCK_SIZE) == 0);
+
+    debug("Check hole is zero filled");
+    assert(fs_write(&fs, 2, data, 10, 8 * BLOCK_SIZE) == 10);
+    assert(fs_read(&fs, 2, copy, BLOCK_SIZE, 6 * BLOCK_SIZE) == BLOCK_SIZE);
+    for (size_t i = 0; i < BLOCK_SIZE; i++)
+        assert(copy[i] == 0);
+
+    debug("Check removing files releases extents and spill block");
+    size_t spill = block.inodes[1].spill;
+    assert(fs_remove(&fs, 0));
+    assert(fs_remove(&fs, 1));
+    assert(fs_remove(&fs, 2));
+    assert(fs_is_free_block(&fs, spill));
+    for (size_t b = 401; b < 4000 - fs.meta_data.bitmap_blocks - fs.meta_data.journal_blocks; b++)
+        assert(fs_is_free_block(&fs, b));
+
+    free(data);
+    free(copy);
+    fs_unmount(&fs);
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_07_fs_open() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open_backend("data/image.unit", 200, DISK_FD);
+    assert(disk);
+
+    FileSystem fs = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+
+    size_t free_blocks = 0;
+    for (size_t b = 0; b < fs.meta_data.blocks; b++)
+        free_blocks += fs_is_free_block(&fs, b);
+
+    debug("Check opening invalid inodes");
+    assert(fs_open(&fs, 0) == NULL);
+    assert(fs_open(&fs, fs.meta_data.inodes) == NULL);
+    assert(fs_close(NULL) == false);
+
+    debug("Check writes through handle update inode on close");
+    char data[10 * BLOCK_SIZE];
+    char copy[10 * BLOCK_SIZE];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = i % 251;
+
+    assert(fs_create(&fs) == 0);
+    File *file = fs_open(&fs, 0);
+    assert(file);
+    for (size_t b = 0; b < 10; b++)
+        assert(fs_file_write(file, data + b * BLOCK_SIZE, BLOCK_SIZE, b * BLOCK_SIZE) == BLOCK_SIZE);
+    assert(fs_stat(&fs, 0) == 0);
+    assert(fs_close(file));
+    assert(fs_stat(&fs, 0) == sizeof(data));
+
+    debug("Check reads through handle only access data blocks");
+    file = fs_open(&fs, 0);
+    assert(file);
+    size_t lookups = disk->cache->hits + disk->cache->misses;
+    for (size_t b = 0; b < 10; b++)
+        assert(fs_file_read(file, copy + b * BLOCK_SIZE, BLOCK_SIZE, b * BLOCK_SIZE) == BLOCK_SIZE);
+    assert(disk->cache->hits + disk->cache->misses - lookups == 10);
+    assert(memcmp(data, copy, sizeof(data)) == 0);
+    assert(fs_file_read(file, copy, BLOCK_SIZE, sizeof(data)) == 0);
+
+    debug("Check open inode cannot be removed or written behind its handle");
+    assert(fs_remove(&fs, 0) == false);
+    assert(fs_write(&fs, 0, data, BLOCK_SIZE, sizeof(data)) == -1);
+
+    debug("Check only the sole open handle can write");
+    File *other = fs_open(&fs, 0);
+    assert(other);
+    assert(fs_file_write(file, data, BLOCK_SIZE, 0) == -1);
+    assert(fs_file_write(other, data, BLOCK_SIZE, 5 * BLOCK_SIZE) == -1);
+    assert(fs_close(other));
+    assert(fs_file_write(file, data, BLOCK_SIZE, sizeof(data)) == BLOCK_SIZE);
+    assert(fs_open(&fs, 0) == NULL);
+    assert(fs_close(file));
+    assert(fs_stat(&fs, 0) == sizeof(data) + BLOCK_SIZE);
+
+    debug("Check closed inode is removed with all of its blocks");
+    assert(fs_remove(&fs, 0));
+    assert(fs_stat(&fs, 0) == -1);
+    size_t released = 0;
+    for (size_t b = 0; b < fs.meta_data.blocks; b++)
+        released += fs_is_free_block(&fs, b);
+    assert(released == free_blocks);
+
+    fs_unmount(&fs);
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_08_fs_readahead() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open_backend("data/image.unit", 2000, DISK_FD);
+    assert(disk);
+
+    FileSystem fs = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+
+    size_t length = 1000 * BLOCK_SIZE + 100;
+    char *data = malloc(length);
+    char *copy = malloc(length);
+    assert(data && copy);
+    for (size_t i = 0; i < length; i++)
+        data[i] = i % 251;
+
+    assert(fs_create(&fs) == 0);
+    assert(fs_write(&fs, 0, data, length, 0) == length);
+
+    debug("Check sequential reads are served from readahead");
+    File *file = fs_open(&fs, 0);
+    assert(file);
+    size_t offset = 0;
+    ssize_t result;
+    while ((result = fs_file_read(file, copy + offset, 3 * BLOCK_SIZE, offset)) > 0)
+        offset += result;
+    assert(offset == length);
+    assert(memcmp(data, copy, length) == 0);
+    assert(file->ra_window == READAHEAD_MAX);
+    /* 998 blocks after the first read, minus the 8 that started a window */
+    assert(disk->readahead_hits == 998 - 8);
+    assert(disk->readahead_waste == 0);
+
+    debug("Check random access drops readahead window");
+    assert(fs_file_read(file, copy, BLOCK_SIZE, 10 * BLOCK_SIZE) == BLOCK_SIZE);
+    assert(file->ra_window == 0);
+    assert(file->ra_count == 0);
+    assert(memcmp(data + 10 * BLOCK_SIZE, copy, BLOCK_SIZE) == 0);
+
+    debug("Check unread readahead blocks are counted as waste");
+    assert(fs_file_read(file, copy, BLOCK_SIZE, 11 * BLOCK_SIZE) == BLOCK_SIZE);
+    assert(file->ra_window == READAHEAD_MIN);
+    assert(fs_close(file));
+    assert(disk->readahead_hits == 998 - 8);
+    assert(disk->readahead_waste == READAHEAD_MIN - 1);
+
+    free(data);
+    free(copy);
+    fs_unmount(&fs);
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_09_fs_goal() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open("data/image.unit", 1000);
+    assert(disk);
+
+    FileSystem fs = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+
+    char data[BLOCK_SIZE];
+    memset(data, 'a', sizeof(data));
+
+    debug("Check concurrent writers get contiguous files");
+    assert(fs_create(&fs) == 0);
+    assert(fs_create(&fs) == 1);
+    File *f0 = fs_open(&fs, 0);
+    File *f1 = fs_open(&fs, 1);
+    assert(f0 && f1);
+    for (size_t b = 0; b < 32; b++) {
+        assert(fs_file_write(f0, data, BLOCK_SIZE, b * BLOCK_SIZE) == BLOCK_SIZE);
+        assert(fs_file_write(f1, data, BLOCK_SIZE, b * BLOCK_SIZE) == BLOCK_SIZE);
+    }
+    assert(f0->inode.nextents == 1);
+    assert(f1->inode.nextents == 1);
+    assert(f0->prealloc_count == PREALLOC_BLOCKS - 31);
+
+    debug("Check closing releases preallocated blocks");
+    size_t end = f0->inode.extents[0].start + f0->inode.extents[0].length;
+    assert(!fs_is_free_block(&fs, end));
+    assert(fs_close(f0));
+    assert(fs_close(f1));
+    assert(fs_is_free_block(&fs, end));
+
+    debug("Check growing file skips small holes");
+    assert(fs_create(&fs) == 2);
+    assert(fs_write(&fs, 2, data, BLOCK_SIZE, 0) == BLOCK_SIZE);
+    assert(fs_create(&fs) == 3);
+    assert(fs_write(&fs, 3, data, BLOCK_SIZE, 0) == BLOCK_SIZE);
+    assert(fs_remove(&fs, 0));
+    for (size_t b = 1; b < 16; b++)
+        assert(fs_write(&fs, 2, data, BLOCK_SIZE, b * BLOCK_SIZE) == BLOCK_SIZE);
+
+    File *f2 = fs_open(&fs, 2);
+    assert(f2);
+    assert(f2->inode.nextents == 2);
+    assert(fs_close(f2));
+
+    fs_unmount(&fs);
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_10_fs_readahead_async() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open_backend("data/image.unit", 2000, DISK_URING);
+    assert(disk);
+
+    FileSystem fs = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+
+    size_t length = 1000 * BLOCK_SIZE + 100;
+    char *data = malloc(length);
+    char *copy = malloc(length);
+    assert(data && copy);
+    for (size_t i = 0; i < length; i++)
+        data[i] = i % 251;
+
+    assert(fs_create(&fs) == 0);
+    assert(fs_write(&fs, 0, data, length, 0) == length);
+    assert(fs_sync(&fs));
+
+    debug("Check sequential reads are served from asynchronous readahead");
+    File *file = fs_open(&fs, 0);
+    assert(file);
+    size_t offset = 0;
+    ssize_t result;
+    while ((result = fs_file_read(file, copy + offset, 3 * BLOCK_SIZE, offset)) > 0)
+        offset += result;
+    assert(offset == length);
+    assert(memcmp(data, copy, length) == 0);
+    assert(file->ra_window == READAHEAD_MAX);
+    assert(file->ra_async_count == 0);
+    /* only the first window is read synchronously (without io_uring, all 8) */
+    assert(disk->readahead_hits == (disk->uring ? 998 - 1 : 998 - 8));
+    assert(disk->readahead_waste == 0);
+    assert(!disk->uring || disk->uring->completions > 0);
+
+    debug("Check writes drop asynchronous readahead");
+    assert(fs_file_read(file, copy, BLOCK_SIZE, 0) == BLOCK_SIZE);
+    assert(fs_file_read(file, copy, BLOCK_SIZE, BLOCK_SIZE) == BLOCK_SIZE);
+    assert(!disk->uring || file->ra_async_count == 2 * READAHEAD_MIN);
+    assert(fs_file_write(file, data, BLOCK_SIZE, 0) == BLOCK_SIZE);
+    assert(file->ra_async_count == 0);
+    assert(file->ra_nrequests == 0);
+    assert(fs_close(file));
+
+    free(data);
+    free(copy);
+    fs_unmount(&fs);
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_11_fs_journal() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open_backend("data/image.unit", 1000, DISK_FD);
+    assert(disk);
+
+    FileSystem fs = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+    assert(fs.meta_data.version == FS_VERSION_JOURNAL);
+    assert(fs.meta_data.journal_blocks == 31);
+
+    char data[3 * BLOCK_SIZE];
+    char copy[3 * BLOCK_SIZE];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = i % 251;
+
+    debug("Check metadata updates are batched into one commit");
+    for (size_t i = 0; i < 3; i++)
+        assert(fs_create(&fs) == i);
+    assert(fs_write(&fs, 0, data, sizeof(data), 0) == sizeof(data));
+    assert(fs_remove(&fs, 2));
+    assert(fs.journal_commits == 0);
+    assert(fs.journal_count == 1);
+    assert(fs_sync(&fs));
+    assert(fs.journal_commits == 1);
+    assert(fs.journal_head == 2);
+
+    Block block;
+    assert(pread(disk->fd, block.data, BLOCK_SIZE, BLOCK_SIZE) == BLOCK_SIZE);
+    assert(block.inodes[0].valid == false);
+
+    debug("Check committed transaction is replayed after crash");
+    test_crash(&fs, disk);
+    disk = disk_open_backend("data/image.unit", 1000, DISK_FD);
+    assert(disk);
+    assert(fs_mount(&fs, disk));
+    assert(fs.journal_sequence == 2);
+    assert(fs_stat(&fs, 0) == sizeof(data));
+    assert(fs_stat(&fs, 1) == 0);
+    assert(fs_stat(&fs, 2) == -1);
+    assert(fs_read(&fs, 0, copy, sizeof(copy), 0) == sizeof(copy));
+    assert(memcmp(data, copy, sizeof(data)) == 0);
+    assert(pread(disk->fd, block.data, BLOCK_SIZE, BLOCK_SIZE) == BLOCK_SIZE);
+    assert(block.inodes[0].valid == true);
+    assert(fs_is_free_block(&fs, block.inodes[0].extents[0].start) == false);
+
+    debug("Check uncommitted and torn transactions are not replayed");
+    assert(fs_remove(&fs, 1));
+    test_crash(&fs, disk);
+    disk = disk_open_backend("data/image.unit", 1000, DISK_FD);
+    assert(disk);
+    assert(fs_mount(&fs, disk));
+    assert(fs_stat(&fs, 1) == 0);
+
+    assert(fs_remove(&fs, 1));
+    assert(fs_sync(&fs));
+    size_t journal = 1000 - fs.meta_data.bitmap_blocks - fs.meta_data.journal_blocks;
+    memset(block.data, 0xff, BLOCK_SIZE);
+    assert(pwrite(disk->fd, block.data, BLOCK_SIZE, (journal + 1) * BLOCK_SIZE) == BLOCK_SIZE);
+    test_crash(&fs, disk);
+    disk = disk_open_backend("data/image.unit", 1000, DISK_FD);
+    assert(disk);
+    assert(fs_mount(&fs, disk));
+    assert(fs_stat(&fs, 1) == 0);
+    assert(fs_stat(&fs, 0) == sizeof(data));
+
+    debug("Check clean unmount checkpoints journal");
+    uint32_t sequence = fs.journal_sequence;
+    assert(fs_remove(&fs, 0));
+    fs_unmount(&fs);
+    assert(pread(disk->fd, block.data, BLOCK_SIZE, 0) == BLOCK_SIZE);
+    assert(block.super.clean);
+    assert(block.super.journal_sequence == sequence + 1);
+    assert(pread(disk->fd, block.data, BLOCK_SIZE, BLOCK_SIZE) == BLOCK_SIZE);
+    assert(block.inodes[0].valid == false);
+
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_12_fs_directories() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open("data/image.unit", 2000);
+    assert(disk);
+
+    FileSystem fs = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+
+    debug("Check root directory is created on first use");
+    assert(fs_lookup(&fs, "/") == -1);
+    ssize_t a = fs_mkdir(&fs, "/a");
+    assert(a >= 0);
+    ssize_t root = fs_lookup(&fs, "/");
+    assert(root >= 0 && root != a);
+    assert(fs_lookup(&fs, "/a") == a);
+
+    debug("Check path resolution");
+    ssize_t f = fs_create_path(&fs, "/a/f");
+    assert(f >= 0);
+    assert(fs_lookup(&fs, "//a///f/") == f);
+    assert(fs_lookup(&fs, "a/f") == -1);
+    assert(fs_lookup(&fs, "/a/g") == -1);
+    assert(fs_lookup(&fs, "/a/./f") == -1);
+    assert(fs_write(&fs, f, "hello", 5, 0) == 5);
+    assert(fs_stat(&fs, f) == 5);
+
+    debug("Check invalid creates");
+    assert(fs_mkdir(&fs, "/a") == -1);
+    assert(fs_create_path(&fs, "/a/f") == -1);
+    assert(fs_create_path(&fs, "/b/f") == -1);
+    assert(fs_create_path(&fs, "/a/f/g") == -1);
+    assert(fs_create_path(&fs, "/") == -1);
+    assert(fs_create_path(&fs, "/..") == -1);
+    char name[2 * DIR_NAME_MAX] = "/";
+    memset(name + 1, 'x', DIR_NAME_MAX);
+    assert(fs_create_path(&fs, name) == -1);
+    name[DIR_NAME_MAX] = 0;
+    assert(fs_create_path(&fs, name) >= 0);
+    assert(fs_unlink(&fs, name));
+
+    debug("Check large directory is split into hashed leaves");
+    ssize_t big = fs_mkdir(&fs, "/big");
+    assert(big >= 0);
+    for (size_t i = 0; i < 2000; i++) {
+        snprintf(name, sizeof(name), "/big/file%lu", i);
+        assert(fs_create_path(&fs, name) >= 0);
+    }
+    assert(fs_stat(&fs, big) > 30 * BLOCK_SIZE);
+
+    size_t count;
+    DirEntry *entries = fs_readdir(&fs, "/big", &count);
+    assert(entries && count == 2000);
+    char seen[2000] = {0};
+    for (size_t e = 0; e < count; e++) {
+        size_t i;
+        assert(sscanf(entries[e].name, "file%lu", &i) == 1 && i < 2000 && !seen[i]);
+        assert(entries[e].type == INODE_FILE);
+        seen[i] = 1;
+    }
+    free(entries);
+
+    debug("Check lookup reads a constant number of blocks (if blocks are cached)");
+    assert(fs_sync(&fs));
+    if (disk->cache) {
+        size_t reads = disk->cache->hits + disk->cache->misses;
+        assert(fs_lookup(&fs, "/big/file1234") >= 0);
+        assert(disk->cache->hits + disk->cache->misses - reads <= 8);
+    }
+
+    debug("Check directories persist after remount");
+    fs_unmount(&fs);
+    assert(fs_mount(&fs, disk));
+    assert(fs_lookup(&fs, "/") == root);
+    assert(fs_lookup(&fs, "/a/f") == f);
+    assert(fs_lookup(&fs, "/big/file1999") >= 0);
+
+    debug("Check unlink");
+    assert(fs_unlink(&fs, "/") == false);
+    assert(fs_unlink(&fs, "/a") == false);
+    assert(fs_unlink(&fs, "/a/f"));
+    assert(fs_stat(&fs, f) == -1);
+    assert(fs_lookup(&fs, "/a/f") == -1);
+    assert(fs_unlink(&fs, "/a/f") == false);
+    assert(fs_unlink(&fs, "/a"));
+    assert(fs_lookup(&fs, "/a") == -1);
+    for (size_t i = 0; i < 2000; i++) {
+        snprintf(name, sizeof(name), "/big/file%lu", i);
+        assert(fs_unlink(&fs, name));
+    }
+    entries = fs_readdir(&fs, "/big", &count);
+    assert(entries && count == 0);
+    free(entries);
+    assert(fs_unlink(&fs, "/big"));
+    assert(fs_readdir(&fs, "/big", &count) == NULL);
+
+    debug("Check open path cannot be unlinked");
+    f = fs_create_path(&fs, "/f");
+    assert(f >= 0);
+    File *file = fs_open(&fs, f);
+    assert(file);
+    assert(fs_unlink(&fs, "/f") == false);
+    assert(fs_lookup(&fs, "/f") == f);
+    assert(fs_close(file));
+    assert(fs_unlink(&fs, "/f"));
+    assert(fs_lookup(&fs, "/f") == -1);
+
+    debug("Check unlinked inode stays removed after remount");
+    fs_unmount(&fs);
+    assert(fs_mount(&fs, disk));
+    assert(fs_lookup(&fs, "/f") == -1);
+    assert(fs_stat(&fs, f) == -1);
+
+    fs_unmount(&fs);
+    disk_close(disk);
+
+    debug("Check running out of space while splitting leaves directory unchanged");
+    unlink("data/image.unit");
+    disk = disk_open("data/image.unit", 6000);
+    assert(disk);
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+
+    ssize_t full = fs_mkdir(&fs, "/full");
+    assert(full >= 0);
+    size_t entry = 0;
+    while (fs_stat(&fs, full) < (1 + DIR_CHILDREN) * BLOCK_SIZE) {
+        snprintf(name, sizeof(name), "/full/file%lu", entry++);
+        assert(fs_create_path(&fs, name) >= 0);
+    }
+
+    size_t free_blocks = 0;
+    for (size_t b = 0; b < fs.meta_data.blocks; b++)
+        free_blocks += fs_is_free_block(&fs, b);
+    ssize_t filler = fs_create_path(&fs, "/filler");
+    char   *zeros  = calloc(free_blocks - 1, BLOCK_SIZE);
+    assert(filler >= 0 && zeros);
+    assert(fs_write(&fs, filler, zeros, (free_blocks - 1) * BLOCK_SIZE, 0) == (free_blocks - 1) * BLOCK_SIZE);
+    free(zeros);
+
+    ssize_t size;
+    do {
+        size = fs_stat(&fs, full);
+        snprintf(name, sizeof(name), "/full/file%lu", entry++);
+    } while (fs_create_path(&fs, name) >= 0);
+    assert(fs_stat(&fs, full) == size);
+    free_blocks = 0;
+    for (size_t b = 0; b < fs.meta_data.blocks; b++)
+        free_blocks += fs_is_free_block(&fs, b);
+    assert(free_blocks == 1);
+
+    fs_unmount(&fs);
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
+int test_13_fs_directory_crash() {
+    unlink("data/image.unit");
+
+    Disk *disk = disk_open_backend("data/image.unit", 1000, DISK_FD);
+    assert(disk);
+
+    FileSystem fs = {0};
+    assert(fs_format(&fs, disk));
+    assert(fs_mount(&fs, disk));
+
+    debug("Check leaf split is never committed halfway");
+    char name[DIR_NAME_MAX + 8];
+    ssize_t d = fs_mkdir(&fs, "/d");
+    assert(d >= 0);
+    for (size_t i = 0; i < 1200; i++) {
+        snprintf(name, sizeof(name), "/d/synced%lu", i);
+        assert(fs_create_path(&fs, name) >= 0);
+    }
+    assert(fs_sync(&fs));
+
+    /* create until a create that splits a leaf commits a transaction */
+    size_t commits = fs.journal_commits;
+    bool   split   = false;
+    for (size_t i = 0; i < 2000 && !split; i++) {
+        ssize_t size  = fs_stat(&fs, d);
+        size_t  count = fs.journal_commits;
+        snprintf(name, sizeof(name), "/d/unsynced%lu", i);
+        assert(fs_create_path(&fs, name) >= 0);
+        split = fs_stat(&fs, d) != size && fs.journal_commits != count;
+    }
+    assert(fs.journal_commits > commits);
+
+    test_crash(&fs, disk);
+    disk = disk_open_backend("data/image.unit", 1000, DISK_FD);
+    assert(disk);
+    assert(fs_mount(&fs, disk));
+    for (size_t i = 0; i < 1200; i++) {
+        snprintf(name, sizeof(name), "/d/synced%lu", i);
+        assert(fs_lookup(&fs, name) >= 0);
+    }
+
+    size_t    count;
+    DirEntry *entries = fs_readdir(&fs, "/d", &count);
+    assert(entries && count >= 1200);
+    free(entries);
+
+    fs_unmount(&fs);
+    disk_close(disk);
+    return EXIT_SUCCESS;
+}
+
 /* Main execution */
 
 int main(int argc, char *argv[]) {
@@ -174,6 +893,16 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "    1. Test fs_create\n");
         fprintf(stderr, "    2. Test fs_remove\n");
         fprintf(stderr, "    3. Test fs_stat\n");
+        fprintf(stderr, "    4. Test fs_bitmap\n");
+        fprintf(stderr, "    5. Test fs_fast_mount\n");
+        fprintf(stderr, "    6. Test fs_extents\n");
+        fprintf(stderr, "    7. Test fs_open\n");
+        fprintf(stderr, "    8. Test fs_readahead\n");
+        fprintf(stderr, "    9. Test fs_goal\n");
+        fprintf(stderr, "    10. Test fs_readahead_async\n");
+        fprintf(stderr, "    11. Test fs_journal\n");
+        fprintf(stderr, "    12. Test fs_directories\n");
+        fprintf(stderr, "    13. Test fs_directory_crash\n");
         return EXIT_FAILURE;
     }
 
@@ -187,6 +916,16 @@ int main(int argc, char *argv[]) {
         case 1:  status = test_01_fs_create(); break;
         case 2:  status = test_02_fs_remove(); break;
         case 3:  status = test_03_fs_stat(); break;
+        case 4:  status = test_04_fs_bitmap(); break;
+        case 5:  status = test_05_fs_fast_mount(); break;
+        case 6:  status = test_06_fs_extents(); break;
+        case 7:  status = test_07_fs_open(); break;
+        case 8:  status = test_08_fs_readahead(); break;
+        case 9:  status = test_09_fs_goal(); break;
+        case 10: status = test_10_fs_readahead_async(); break;
+        case 11: status = test_11_fs_journal(); break;
+        case 12: status = test_12_fs_directories(); break;
+        case 13: status = test_13_fs_directory_crash(); break;
         default: fprintf(stderr, "Unknown NUMBER: %d\n", number); break;
     }
 
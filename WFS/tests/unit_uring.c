@@ -0,0 +1,206 @@
+/* unit_uring.c: Unit tests for SimpleFS asynchronous I/O queue */
+
+#include "sfs/disk.h"
+#include "sfs/logging.h"
+#include "sfs/uring.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+
+/* Constants */
+
+#define URING_PATH      "unit_uring.image"
+#define URING_REQUESTS  (8)
+
+/* Functions */
+
+void test_cleanup() {
+    unlink(URING_PATH);
+}
+
+void test_count(UringRequest *request) {
+    (*(size_t *)request->arg)++;
+}
+
+int test_00_uring_create() {
+    int fd = open(URING_PATH, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    assert(fd >= 0);
+
+    debug("Check zero depth");
+    assert(uring_create(fd, 0) == NULL);
+
+    debug("Check bad arguments");
+    UringRequest request = {0};
+    assert(uring_queue(NULL, &request) == false);
+    assert(uring_submit(NULL) == false);
+    assert(uring_wait(NULL, &request) == -1);
+
+    Uring *ring = uring_create(fd, URING_MAX_DEPTH * 2);
+    if (!ring) {
+        debug("io_uring unavailable");
+        close(fd);
+        return EXIT_SUCCESS;
+    }
+
+    debug("Check ring attributes");
+    assert(ring->target   == fd);
+    assert(ring->depth    == URING_MAX_DEPTH);
+    assert(ring->inflight == 0);
+    assert(ring->queued   == 0);
+    assert(uring_queue(ring, &request) == false);
+
+    uring_delete(ring);
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+int test_01_uring_io() {
+    int fd = open(URING_PATH, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    assert(fd >= 0);
+
+    Uring *ring = uring_create(fd, URING_REQUESTS / 2);
+    if (!ring) {
+        debug("io_uring unavailable");
+        close(fd);
+        return EXIT_SUCCESS;
+    }
+
+    static char  blocks[URING_REQUESTS][BLOCK_SIZE];
+    UringRequest requests[URING_REQUESTS];
+    struct iovec iov[URING_REQUESTS];
+    size_t       completions = 0;
+
+    debug("Check batch of writes (more than queue depth)");
+    memset(requests, 0, sizeof(requests));
+    for (size_t r = 0; r < URING_REQUESTS; r++) {
+        memset(blocks[r], r + 1, BLOCK_SIZE);
+        requests[r].vec.iov_base = blocks[r];
+        requests[r].vec.iov_len  = BLOCK_SIZE;
+        requests[r].iov          = &requests[r].vec;
+        requests[r].niov         = 1;
+        requests[r].offset       = r * BLOCK_SIZE;
+        requests[r].write        = true;
+        requests[r].callback     = test_count;
+        requests[r].arg          = &completions;
+        assert(uring_queue(ring, &requests[r]));
+        assert(ring->inflight <= URING_REQUESTS / 2);
+    }
+    assert(uring_submit(ring));
+    for (size_t r = 0; r < URING_REQUESTS; r++)
+        assert(uring_wait(ring, &requests[r]) == BLOCK_SIZE);
+    assert(completions == URING_REQUESTS);
+    assert(ring->inflight == 0);
+
+    debug("Check vectored read");
+    memset(blocks, 0, sizeof(blocks));
+    for (size_t r = 0; r < URING_REQUESTS; r++) {
+        iov[r].iov_base = blocks[URING_REQUESTS - r - 1];
+        iov[r].iov_len  = BLOCK_SIZE;
+    }
+    memset(requests, 0, sizeof(UringRequest));
+    requests[0].iov  = iov;
+    requests[0].niov = URING_REQUESTS;
+    assert(uring_queue(ring, &requests[0]));
+    assert(uring_wait(ring, &requests[0]) == URING_REQUESTS * BLOCK_SIZE);
+    for (size_t r = 0; r < URING_REQUESTS; r++) {
+        assert(blocks[URING_REQUESTS - r - 1][0]              == r + 1);
+        assert(blocks[URING_REQUESTS - r - 1][BLOCK_SIZE - 1] == r + 1);
+    }
+
+    debug("Check read past end of file");
+    memset(requests, 0, sizeof(UringRequest));
+    requests[0].iov    = iov;
+    requests[0].niov   = 2;
+    requests[0].offset = (URING_REQUESTS - 1) * BLOCK_SIZE;
+    assert(uring_queue(ring, &requests[0]));
+    assert(uring_wait(ring, &requests[0]) == -1);
+    assert(requests[0].complete);
+
+    uring_delete(ring);
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+int test_02_uring_failure() {
+    int fd = open(URING_PATH, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    assert(fd >= 0);
+
+    Uring *ring = uring_create(fd, URING_REQUESTS);
+    if (!ring) {
+        debug("io_uring unavailable");
+        close(fd);
+        return EXIT_SUCCESS;
+    }
+
+    static char  blocks[URING_REQUESTS][BLOCK_SIZE];
+    UringRequest requests[URING_REQUESTS];
+    size_t       completions = 0;
+
+    debug("Check failed submission fails queued requests (instead of hanging)");
+    memset(requests, 0, sizeof(requests));
+    for (size_t r = 0; r < URING_REQUESTS; r++) {
+        requests[r].vec.iov_base = blocks[r];
+        requests[r].vec.iov_len  = BLOCK_SIZE;
+        requests[r].iov          = &requests[r].vec;
+        requests[r].niov         = 1;
+        requests[r].offset       = r * BLOCK_SIZE;
+        requests[r].write        = true;
+        requests[r].callback     = test_count;
+        requests[r].arg          = &completions;
+        assert(uring_queue(ring, &requests[r]));
+    }
+
+    int ring_fd = ring->fd;
+    ring->fd = -1;
+    assert(uring_submit(ring) == false);
+    ring->fd = ring_fd;
+
+    for (size_t r = 0; r < URING_REQUESTS; r++) {
+        assert(uring_wait(ring, &requests[r]) == -1);
+        assert(requests[r].complete);
+    }
+    assert(completions == URING_REQUESTS);
+    assert(ring->inflight == 0);
+    assert(ring->queued == 0);
+
+    debug("Check queue still works after failure");
+    assert(uring_queue(ring, &requests[0]));
+    assert(uring_wait(ring, &requests[0]) == BLOCK_SIZE);
+
+    uring_delete(ring);
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+/* Main execution */
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s NUMBER\n\n", argv[0]);
+        fprintf(stderr, "Where NUMBER is right of the following:\n");
+        fprintf(stderr, "    0. Test uring_create\n");
+        fprintf(stderr, "    1. Test uring_io\n");
+        fprintf(stderr, "    2. Test uring_failure\n");
+        return EXIT_FAILURE;
+    }
+
+    int number = atoi(argv[1]);
+    int status = EXIT_FAILURE;
+
+    atexit(test_cleanup);
+
+    switch (number) {
+        case 0:  status = test_00_uring_create(); break;
+        case 1:  status = test_01_uring_io(); break;
+        case 2:  status = test_02_uring_failure(); break;
+        default: fprintf(stderr, "Unknown NUMBER: %d\n", number); break;
+    }
+
+    return status;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
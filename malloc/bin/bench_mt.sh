@@ -0,0 +1,64 @@
+#!/bin/bash
+
+# Run the multithreaded workloads in bin/bench_mt against each library (and
+# the system allocator) at 1..N threads and emit CSV on stdout.
+#
+# Usage: bench_mt.sh [MAX_THREADS]
+
+# Constants
+
+WORKLOADS="threadtest cache-thrash cache-scratch larson"
+LIBRARIES="libmalloc-ff.so libmalloc-bf.so libmalloc-wf.so libmalloc-nf.so system"
+MAX_THREADS=${1:-$(nproc)}
+
+# Functions
+
+thread-counts() {
+    threads=1
+    while [ $threads -lt $MAX_THREADS ]; do
+    	echo $threads
+    	threads=$((threads * 2))
+    done
+    echo $MAX_THREADS
+}
+
+bench-library() {
+    library=$1
+    workload=$2
+    threads=$3
+    if [ $library = system ]; then
+    	./bin/bench_mt $workload $threads
+    else
+    	env LD_PRELOAD=./lib/$library ./bin/bench_mt $workload $threads
+    fi
+}
+
+# Main execution
+
+echo "library,workload,threads,ops,seconds,ops_per_sec,efficiency,maxrss_kb,mallocs,frees,remote,heap_size,page_heap"
+for library in $LIBRARIES; do
+    for workload in $WORKLOADS; do
+    	baseline=""
+    	for threads in $(thread-counts | sort -nu); do
+    	    row=$(bench-library $library $workload $threads | awk -v library=$library -v baseline="$baseline" '
+    	    	$1 == "result"     { workload = $2; threads = $3; ops = $4; seconds = $5; rss = $6 }
+    	    	$1 == "mallocs:"   { mallocs = $2 }
+    	    	$1 == "frees:"     { frees = $2 }
+    	    	$1 == "remote:"    { remote = $2 }
+    	    	$1 == "heap"       { heap = $3 }
+    	    	$1 == "page"       { page = $3 }
+    	    	END {
+    	    	    rate = seconds > 0 ? ops / seconds : 0
+    	    	    if (baseline == "") baseline = rate
+    	    	    efficiency = baseline > 0 ? rate / (threads * baseline) : 0
+    	    	    printf "%s,%s,%d,%d,%.6f,%.0f,%.3f,%d,%d,%d,%d,%d,%d\n", library, workload, threads, ops, seconds, rate, efficiency, rss, mallocs, frees, remote, heap, page
+    	    	}')
+    	    echo "$row"
+    	    if [ -z "$baseline" ]; then
+    	    	baseline=$(echo "$row" | cut -d , -f 6)
+    	    fi
+    	done
+    done
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
@@ -23,6 +23,9 @@ frees:       10
 callocs:     0
 reallocs:    0
 reuses:      0
+searched:    0
+search cost: mean 0.00 p99 0 max 0
+insert cost: mean 0.00 p99 0 max 0
 grows:       10
 shrinks:     10
 splits:      0
@@ -41,5 +44,6 @@ trap "rm -f test.log" EXIT INT
 test-library libmalloc-ff.so
 test-library libmalloc-bf.so
 test-library libmalloc-wf.so
+test-library libmalloc-nf.so
 
 # vim: sts=4 sw=4 ts=8 ft=sh
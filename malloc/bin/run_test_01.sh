@@ -23,6 +23,9 @@ frees:       11
 callocs:     0
 reallocs:    0
 reuses:      9
+searched:    9
+search cost: mean 0.82 p99 1 max 1
+insert cost: mean 0.90 p99 1 max 1
 grows:       2
 shrinks:     1
 splits:      9
@@ -41,5 +44,6 @@ trap "rm -f test.log" EXIT INT
 test-library libmalloc-ff.so
 test-library libmalloc-bf.so
 test-library libmalloc-wf.so
+test-library libmalloc-nf.so
 
 # vim: sts=4 sw=4 ts=8 ft=sh
@@ -23,6 +23,9 @@ frees:       6
 callocs:     0
 reallocs:    0
 reuses:      2
+searched:    2
+search cost: mean 0.33 p99 1 max 1
+insert cost: mean 0.60 p99 1 max 1
 grows:       4
 shrinks:     1
 splits:      1
@@ -41,5 +44,6 @@ trap "rm -f test.log" EXIT INT
 test-library libmalloc-ff.so
 test-library libmalloc-bf.so
 test-library libmalloc-wf.so
+test-library libmalloc-nf.so
 
 # vim: sts=4 sw=4 ts=8 ft=sh
@@ -23,6 +23,9 @@ frees:       10
 callocs:     0
 reallocs:    0
 reuses:      18
+searched:    44
+search cost: mean 1.47 p99 10 max 10
+insert cost: mean 4.50 p99 9 max 9
 grows:       12
 shrinks:     0
 splits:      10
@@ -43,6 +46,9 @@ frees:       10
 callocs:     0
 reallocs:    0
 reuses:      17
+searched:    65
+search cost: mean 2.17 p99 6 max 6
+insert cost: mean 2.50 p99 5 max 5
 grows:       13
 shrinks:     0
 splits:      9
@@ -63,6 +69,9 @@ frees:       10
 callocs:     0
 reallocs:    0
 reuses:      18
+searched:    125
+search cost: mean 4.17 p99 10 max 10
+insert cost: mean 4.50 p99 9 max 9
 grows:       12
 shrinks:     0
 splits:      11
@@ -74,6 +83,29 @@ external:    66.67
 EOF
 }
 
+libmalloc-nf.so-output() {
+    cat <<EOF
+blocks:      24
+free blocks: 4
+mallocs:     30
+frees:       10
+callocs:     0
+reallocs:    0
+reuses:      18
+searched:    49
+search cost: mean 1.63 p99 10 max 10
+insert cost: mean 4.50 p99 9 max 9
+grows:       12
+shrinks:     0
+splits:      12
+merges:      0
+requested:   5115
+heap size:   3976
+internal:    0.25
+external:    42.86
+EOF
+}
+
 # Main execution
 
 trap "rm -f test.log" EXIT INT
@@ -81,5 +113,6 @@ trap "rm -f test.log" EXIT INT
 test-library libmalloc-ff.so
 test-library libmalloc-bf.so
 test-library libmalloc-wf.so
+test-library libmalloc-nf.so
 
 # vim: sts=4 sw=4 ts=8 ft=sh
@@ -23,6 +23,9 @@ frees:       6
 callocs:     0
 reallocs:    0
 reuses:      1
+searched:    1
+search cost: mean 0.17 p99 1 max 1
+insert cost: mean 1.00 p99 2 max 2
 grows:       5
 shrinks:     0
 splits:      0
@@ -43,6 +46,9 @@ frees:       6
 callocs:     0
 reallocs:    0
 reuses:      1
+searched:    3
+search cost: mean 0.50 p99 3 max 3
+insert cost: mean 1.33 p99 2 max 2
 grows:       5
 shrinks:     0
 splits:      0
@@ -63,6 +69,9 @@ frees:       6
 callocs:     0
 reallocs:    0
 reuses:      1
+searched:    3
+search cost: mean 0.50 p99 3 max 3
+insert cost: mean 1.17 p99 2 max 2
 grows:       5
 shrinks:     0
 splits:      1
@@ -74,6 +83,29 @@ external:    37.50
 EOF
 }
 
+libmalloc-nf.so-output() {
+    cat <<EOF
+blocks:      2
+free blocks: 2
+mallocs:     6
+frees:       6
+callocs:     0
+reallocs:    0
+reuses:      1
+searched:    1
+search cost: mean 0.17 p99 1 max 1
+insert cost: mean 1.00 p99 2 max 2
+grows:       5
+shrinks:     0
+splits:      0
+merges:      3
+requested:   126
+heap size:   288
+internal:    68.06
+external:    7.14
+EOF
+}
+
 # Main execution
 
 trap "rm -f test.log" EXIT INT
@@ -81,5 +113,6 @@ trap "rm -f test.log" EXIT INT
 test-library libmalloc-ff.so
 test-library libmalloc-bf.so
 test-library libmalloc-wf.so
+test-library libmalloc-nf.so
 
 # vim: sts=4 sw=4 ts=8 ft=sh
@@ -13,5 +13,6 @@ time-library() {
 time-library libmalloc-ff.so
 time-library libmalloc-bf.so
 time-library libmalloc-wf.so
+time-library libmalloc-nf.so
 
 # vim: sts=4 sw=4 ts=8 ft=sh
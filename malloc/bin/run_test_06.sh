@@ -15,7 +15,7 @@ test-library() {
 }
 
 test-libraries() {
-    fits="ff bf wf"
+    fits="ff bf wf nf"
     for fit in $fits; do
     	test-library libmalloc-$fit.so $@
     done
@@ -0,0 +1,118 @@
+#!/bin/bash
+
+# Functions
+
+test-library() {
+    library=$1
+    printf "  Testing %-30s ... " $library
+    if diff -y <(env LD_PRELOAD=./lib/$library ./bin/test_07 2> /dev/null) <($library-output) >& test.log; then
+    	echo "Success"
+    else
+    	echo "Failure"
+    	cat test.log
+    	echo ""
+    fi
+}
+
+libmalloc-ff.so-output() {
+    cat <<EOF
+blocks:      3
+free blocks: 3
+mallocs:     11
+frees:       11
+callocs:     0
+reallocs:    0
+reuses:      5
+searched:    13
+search cost: mean 1.18 p99 2 max 2
+insert cost: mean 1.06 p99 2 max 2
+grows:       6
+shrinks:     1
+splits:      11
+merges:      13
+requested:   2290
+heap size:   4064
+internal:    85.63
+external:    7.26
+EOF
+}
+
+libmalloc-bf.so-output() {
+    cat <<EOF
+blocks:      2
+free blocks: 2
+mallocs:     11
+frees:       11
+callocs:     0
+reallocs:    0
+reuses:      5
+searched:    16
+search cost: mean 1.45 p99 2 max 2
+insert cost: mean 1.00 p99 2 max 2
+grows:       6
+shrinks:     1
+splits:      10
+merges:      13
+requested:   2290
+heap size:   4064
+internal:    91.54
+external:    4.80
+EOF
+}
+
+libmalloc-wf.so-output() {
+    cat <<EOF
+blocks:      3
+free blocks: 3
+mallocs:     11
+frees:       11
+callocs:     0
+reallocs:    0
+reuses:      5
+searched:    16
+search cost: mean 1.45 p99 2 max 2
+insert cost: mean 1.06 p99 2 max 2
+grows:       6
+shrinks:     1
+splits:      11
+merges:      13
+requested:   2290
+heap size:   4064
+internal:    85.63
+external:    7.26
+EOF
+}
+
+libmalloc-nf.so-output() {
+    cat <<EOF
+blocks:      3
+free blocks: 3
+mallocs:     11
+frees:       11
+callocs:     0
+reallocs:    0
+reuses:      5
+searched:    13
+search cost: mean 1.18 p99 2 max 2
+insert cost: mean 1.06 p99 2 max 2
+grows:       6
+shrinks:     1
+splits:      11
+merges:      13
+requested:   2290
+heap size:   4064
+internal:    85.63
+external:    7.26
+EOF
+}
+
+# Main execution
+
+trap "rm -f test.log" EXIT INT
+
+test-library libmalloc-ff.so
+test-library libmalloc-bf.so
+test-library libmalloc-wf.so
+test-library libmalloc-nf.so
+
+# vim: sts=4 sw=4 ts=8 ft=sh
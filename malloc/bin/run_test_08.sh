@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Functions
+
+time-library() {
+    library=$1
+    shift
+    printf "  Timing %-56s ... " "$library $*"
+    { time env LD_PRELOAD=./lib/$library $@ ./bin/test_08 > /dev/null; } |& awk '$1 == "real" { print $2 }'
+}
+
+# Main execution
+
+time-library libmalloc-ff.so
+time-library libmalloc-ff.so MALLOC_HUGEPAGES=1
+time-library libmalloc-ff.so MALLOC_HUGEPAGES=1 MALLOC_POPULATE=1
+
+# vim: sts=4 sw=4 ts=8 ft=sh
@@ -0,0 +1,94 @@
+#!/bin/bash
+
+# Functions
+
+test-library() {
+    library=$1
+    printf "  Testing %-30s ... " $library
+    env LD_PRELOAD=./lib/$library MALLOC_SNAPSHOT=$SCRATCH/$library.snap ./bin/test_09 > /dev/null 2>&1
+    if diff -y <(./bin/heapviz -w 32 $SCRATCH/$library.snap 2> /dev/null) <($library-output) >& test.log; then
+    	echo "Success"
+    else
+    	echo "Failure"
+    	cat test.log
+    	echo ""
+    fi
+}
+
+libmalloc-ff.so-output() {
+    cat <<EOF
+libmalloc-ff.so.snap:
+    heap size:   55696
+    blocks:      257
+    free blocks: 65
+    free bytes:  15104
+    largest:     560
+    external:    96.29
+    map:         |++++++++++++++++++++++++++++++##|
+    free holes:
+        <=        128: ******************************************** 44
+        <=       1024: ********************* 21
+EOF
+}
+
+libmalloc-bf.so-output() {
+    cat <<EOF
+libmalloc-bf.so.snap:
+    heap size:   55696
+    blocks:      257
+    free blocks: 65
+    free bytes:  15104
+    largest:     560
+    external:    96.29
+    map:         |++++++++++++++++++++++++++++++##|
+    free holes:
+        <=        128: ******************************************** 44
+        <=       1024: ********************* 21
+EOF
+}
+
+libmalloc-wf.so-output() {
+    cat <<EOF
+libmalloc-wf.so.snap:
+    heap size:   56592
+    blocks:      264
+    free blocks: 72
+    free bytes:  16000
+    largest:     560
+    external:    96.50
+    map:         |+++++++++++++++++++++++++++++###|
+    free holes:
+        <=         16: ******* 7
+        <=        128: ******************************************** 44
+        <=       1024: ********************* 21
+EOF
+}
+
+libmalloc-nf.so-output() {
+    cat <<EOF
+libmalloc-nf.so.snap:
+    heap size:   55696
+    blocks:      257
+    free blocks: 65
+    free bytes:  14600
+    largest:     560
+    external:    96.16
+    map:         |++++++++++++++++++++++++++++++##|
+    free holes:
+        <=         64: ********************* 21
+        <=        128: *********************** 23
+        <=       1024: ********************* 21
+EOF
+}
+
+# Main execution
+
+SCRATCH=$(mktemp -d)
+trap "rm -fr test.log $SCRATCH" EXIT INT
+
+test-library libmalloc-ff.so
+test-library libmalloc-bf.so
+test-library libmalloc-wf.so
+test-library libmalloc-nf.so
+
+# vim: sts=4 sw=4 ts=8 ft=sh
@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# Functions
+
+fragmentation() {
+    library=$1
+    shift
+    printf "  Fragmentation %-49s ... " "$library $*"
+    env LD_PRELOAD=./lib/$library $@ ./bin/test_10 | awk '$1 == "heap" && $2 == "size:" { heap = $3 } $1 == "free" { holes = $3 } $1 == "external:" { external = $2 } END { printf "heap %8d holes %5d external %s\n", heap, holes, external }'
+}
+
+# Main execution
+
+for library in libmalloc-ff.so libmalloc-bf.so libmalloc-wf.so libmalloc-nf.so; do
+    fragmentation $library
+    fragmentation $library MALLOC_NURSERY=1
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
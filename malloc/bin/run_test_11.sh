@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Functions
+
+time-library() {
+    library=$1
+    size=$2
+    remote=$3
+    printf "  Timing %-56s ... " "$library $size bytes MALLOC_REMOTE=$remote"
+    { time env LD_PRELOAD=./lib/$library MALLOC_REMOTE=$remote ./bin/test_11 $size > /dev/null; } |& awk '$1 == "real" { print $2 }'
+}
+
+# Main execution
+
+for library in libmalloc-ff.so libmalloc-bf.so libmalloc-wf.so libmalloc-nf.so; do
+    for size in 16 64 256 1024 4096; do
+    	time-library $library $size 0
+    	time-library $library $size 1
+    done
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
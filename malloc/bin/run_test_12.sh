@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Functions
+
+time-library() {
+    library=$1
+    size=$2
+    printf "  Timing %-56s ... " "$library $size bytes"
+    { time env LD_PRELOAD=./lib/$library ./bin/test_12 $size > /dev/null || echo Failure; } |& awk '$1 == "real" { print $2 } $1 == "Failure"'
+}
+
+# Main execution
+
+for size in 65536 1048576 16777216 67108864; do
+    time-library libmalloc-ff.so $size
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Functions
+
+test-library() {
+    library=$1
+    printf "  Testing %-30s ... " $library
+    if diff -y <(env LD_PRELOAD=./lib/$library MALLOC_NURSERY=1 ./bin/test_13 2> /dev/null | awk '$1 == "site" && $4 >= 4096 { print $3, $4, $NF }' | sort) <(test-output) >& test.log; then
+    	echo "Success"
+    else
+    	echo "Failure"
+    	cat test.log
+    	echo ""
+    fi
+}
+
+test-output() {
+    cat <<EOF
+allocs 4096 heap
+allocs 8192 nursery
+EOF
+}
+
+# Main execution
+
+for library in libmalloc-ff.so libmalloc-bf.so libmalloc-wf.so libmalloc-nf.so; do
+    test-library $library
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Functions
+
+test-library() {
+    library=$1
+    printf "  Testing %-30s ... " $library
+    if diff -y <(test-input $library 2> /dev/null) <(test-output) >& test.log; then
+    	echo "Success"
+    else
+    	echo "Failure"
+    	cat test.log
+    	echo ""
+    fi
+}
+
+# Every free is deferred, so nothing is returned unless allocations drain them
+test-input() {
+    library=$1
+    env LD_PRELOAD=./lib/$library MALLOC_REMOTE=2 ./bin/test_14 262144 4096 | awk '
+    	$1 == "page" { print "spans page heap bounded:", ($3 <= 16777216 ? "yes" : "no") }'
+    env LD_PRELOAD=./lib/$library MALLOC_REMOTE=2 MALLOC_NURSERY=1 ./bin/test_14 64 65536 | awk '
+    	$1 == "nursery:" { print "nursery bounded:", ($2 <= 2097152 ? "yes" : "no") }
+    	$1 == "site" && $4 == 65536 { print "producer site:", $NF }'
+}
+
+test-output() {
+    cat <<EOF
+spans page heap bounded: yes
+nursery bounded: yes
+producer site: nursery
+EOF
+}
+
+# Main execution
+
+for library in libmalloc-ff.so libmalloc-bf.so libmalloc-wf.so libmalloc-nf.so; do
+    test-library $library
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# Functions
+
+test-library() {
+    library=$1
+    printf "  Testing %-30s ... " $library
+    if diff -y <(test-input $library 2> /dev/null) <(test-output) >& test.log; then
+    	echo "Success"
+    else
+    	echo "Failure"
+    	cat test.log
+    	echo ""
+    fi
+}
+
+# Counts from every destructor pass must reach the totals (and not hang them)
+test-input() {
+    library=$1
+    timeout 10 env LD_PRELOAD=./lib/$library ./bin/test_15 | awk '
+    	$1 == "mallocs:" { print "mallocs counted:", ($2 >= 8 * (1 + 4) + 1 ? "yes" : "no") }
+    	$1 == "frees:"   { print "frees counted:",   ($2 >= 8 * (1 + 4) + 1 ? "yes" : "no") }'
+}
+
+test-output() {
+    cat <<EOF
+mallocs counted: yes
+frees counted: yes
+EOF
+}
+
+# Main execution
+
+for library in libmalloc-ff.so libmalloc-bf.so libmalloc-wf.so libmalloc-nf.so; do
+    test-library $library
+done
+
+# vim: sts=4 sw=4 ts=8 ft=sh
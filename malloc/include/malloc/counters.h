@@ -3,6 +3,7 @@
 #ifndef COUNTERS_H
 #define COUNTERS_H
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -19,21 +20,92 @@ enum {
     REALLOCS,	    /* Number of successful calls to realloc */
     CALLOCS,	    /* Number of successful calls to callocs */
     REUSES,	    /* Number of times a block was reused */
+    SEARCHED,       /* Number of free blocks visited while searching */
     GROWS,	    /* Number of times the heap was grown */
     SHRINKS,        /* Number of times the heap was shrunk */
     SPLITS,	    /* Number of times a block was split */
     MERGES,	    /* Number of times a block was merged */
     REQUESTED,	    /* Total number of bytes requested by user */
     HEAP_SIZE,	    /* Size of the heap */
+    HUGE_SIZE,	    /* Size of the heap reserved in huge page regions */
+    PAGE_HEAP,	    /* Size of the spans mapped by the page heap */
+    NURSERY_SIZE,   /* Size of the spans used by the nursery */
+    REMOTE_FREES,   /* Number of frees deferred to the remote free stack */
     NCOUNTERS,	    /* Number of counters */
 };
 
-extern size_t Counters[NCOUNTERS];  /* Counters array */
+/* Counter Shard (one per thread, padded to a cache line to avoid false sharing) */
+
+typedef struct CounterShard CounterShard;
+struct CounterShard {
+    size_t          values[NCOUNTERS];  /* Counts made by this thread */
+    bool            registered;         /* Whether or not shard is in the registry */
+    bool            retired;            /* Whether or not thread already retired its shard */
+    CounterShard *  next;               /* Next shard in the registry */
+} __attribute__((aligned(64)));
+
+extern __thread CounterShard CounterLocal __attribute__((tls_model("initial-exec")));
+
+/* Counter Macros (compiled out entirely when NSTATS is defined)
+ *
+ * Only the owning thread updates its shard, so a relaxed load and store (no
+ * read-modify-write instruction) is enough for counters_total to read the
+ * values from other threads without a data race.  Counts made after a thread
+ * retired its shard (ie. from a later TLS destructor) go straight into the
+ * retired counts instead. */
+
+#ifdef  NSTATS
+#define COUNTER_ADD(counter, n)     ((void)0)
+#else
+#define COUNTER_ADD(counter, n) \
+    do { \
+        if (__builtin_expect(!CounterLocal.registered, false)) { \
+            counters_register((counter), (n)); \
+        } else { \
+            size_t *counter_value = &CounterLocal.values[(counter)]; \
+            __atomic_store_n(counter_value, __atomic_load_n(counter_value, __ATOMIC_RELAXED) + (n), \
+                             __ATOMIC_RELAXED); \
+        } \
+    } while (0)
+#endif
+
+#define COUNTER_SUB(counter, n) COUNTER_ADD(counter, -(size_t)(n))
+#define COUNTER_INC(counter)    COUNTER_ADD(counter, 1)
+#define COUNTER_DEC(counter)    COUNTER_SUB(counter, 1)
+
+/* Histogram (exact buckets for small values, power-of-two buckets above) */
+
+#define HISTOGRAM_LINEAR    (1<<6)
+#define HISTOGRAM_BUCKETS   (HISTOGRAM_LINEAR + 64 - 6)
+
+typedef struct Histogram Histogram;
+struct Histogram {
+    size_t  calls;                      /* Number of values recorded */
+    size_t  total;                      /* Sum of values recorded */
+    size_t  max;                        /* Largest value recorded */
+    size_t  buckets[HISTOGRAM_BUCKETS]; /* Number of values in each bucket */
+};
+
+#ifdef  NSTATS
+#define HISTOGRAM_RECORD(histogram, value) \
+    ((void)0)
+#else
+#define HISTOGRAM_RECORD(histogram, value) \
+    histogram_record((histogram), (value))
+#endif
+
+/* Aggregated (read-only) view of all shards: Counters[BLOCKS] */
+#define Counters                (counters_total())
 
 /* Counter Functions */
 
-void init_counters();
-void dump_counters();
+void            init_counters();
+void            dump_counters();
+void            counters_register(size_t counter, size_t n);
+const size_t *  counters_total();
+void            histogram_record(Histogram *histogram, size_t value);
+double          histogram_mean(Histogram *histogram);
+size_t          histogram_percentile(Histogram *histogram, size_t percent);
 
 #endif
 
@@ -4,6 +4,13 @@
 #define FREELIST_H
 
 #include "malloc/block.h"
+#include "malloc/counters.h"
+
+/* Free List Globals */
+
+extern Block *      Rover;      /* Next fit rover (kept in the list by block_detach and block_merge) */
+extern Histogram    SearchCost; /* Blocks visited per free list search */
+extern Histogram    InsertCost; /* Blocks visited per free list insert */
 
 /* Free List Functions */
 
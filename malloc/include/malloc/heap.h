@@ -0,0 +1,40 @@
+/* heap.h: Heap Growth */
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Heap Constants */
+
+#define PAGE_SIZE       (1<<12)
+#define HUGE_PAGE_SIZE  (1<<21)
+#define PAGE_ALIGN(size, page) \
+    (((size) + ((page) - 1)) & ~((page) - 1))
+
+/* Heap Options (read from the environment on first use) */
+
+#define HUGEPAGES_ENV   "MALLOC_HUGEPAGES"  /* Grow heap in 2 MB aligned, THP advised regions */
+#define POPULATE_ENV    "MALLOC_POPULATE"   /* Prefault newly reserved regions */
+
+typedef struct HeapOptions HeapOptions;
+struct HeapOptions {
+    bool    hugepages;  /* Reserve huge page regions when growing heap */
+    bool    populate;   /* Prefault huge page regions when reserving them */
+};
+
+extern HeapOptions HeapOpts;
+
+/* Heap Functions */
+
+void *  heap_grow(intptr_t size);
+bool    heap_shrink(intptr_t size);
+void *  heap_base();
+void *  heap_top();
+void *  heap_clean();
+
+#endif
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
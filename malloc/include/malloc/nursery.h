@@ -0,0 +1,43 @@
+/* nursery.h: Lifetime-Aware Nursery */
+
+#ifndef NURSERY_H
+#define NURSERY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Nursery Constants */
+
+#define NURSERY_ENV         "MALLOC_NURSERY"    /* Enable lifetime prediction and nursery */
+#define NURSERY_CHUNK       (1<<20)     /* Size of each nursery span */
+#define NURSERY_MAX_SIZE    (1<<10)     /* Largest request placed in the nursery */
+#define NURSERY_SITES       (1<<8)      /* Number of call sites tracked */
+#define NURSERY_SAMPLES     (1<<10)     /* Number of sampled live objects tracked */
+#define NURSERY_SAMPLE_RATE (1<<4)      /* Sample one in this many allocations */
+#define NURSERY_MIN_SAMPLES (1<<3)      /* Samples required before predicting */
+#define NURSERY_SHORT_LIFE  (1<<10)     /* Lifetime (in allocations) that is short */
+#define NURSERY_SHORT_RATIO (90)        /* Percent of samples that must be short */
+
+/* Site Structure */
+
+typedef struct site Site;
+struct site {
+    uintptr_t   address;    /* Return address of allocation call */
+    size_t      allocs;     /* Number of allocations from site */
+    size_t      samples;    /* Number of sampled lifetimes */
+    size_t      shorts;     /* Number of sampled lifetimes that were short */
+    size_t      lifetime;   /* Sum of sampled lifetimes */
+};
+
+/* Nursery Functions */
+
+bool    nursery_enabled();
+void *  nursery_allocate(size_t size, void *site);
+void    nursery_sample(void *ptr, void *site);
+bool    nursery_release(void *ptr);
+void    nursery_dump(int fd);
+
+#endif
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
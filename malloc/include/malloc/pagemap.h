@@ -0,0 +1,33 @@
+/* pagemap.h: Page Map Radix Tree */
+
+#ifndef PAGEMAP_H
+#define PAGEMAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Page Map Constants */
+
+#define PAGE_SHIFT          (12)
+#define PAGEMAP_BITS        (48 - PAGE_SHIFT)                   /* Bits in a page number */
+#define PAGEMAP_ROOT_BITS   (PAGEMAP_BITS / 2)                  /* Bits indexing the root */
+#define PAGEMAP_LEAF_BITS   (PAGEMAP_BITS - PAGEMAP_ROOT_BITS)  /* Bits indexing a leaf */
+
+/* Page Map Macros */
+
+#define PAGE_NUMBER(ptr) \
+    ((uintptr_t)(ptr) >> PAGE_SHIFT)
+
+#define PAGE_ADDRESS(page) \
+    ((void *)((uintptr_t)(page) << PAGE_SHIFT))
+
+/* Page Map Functions */
+
+bool    pagemap_reserve(uintptr_t page, size_t pages);
+void *  pagemap_get(uintptr_t page);
+void    pagemap_set(uintptr_t page, void *value);
+
+#endif
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,46 @@
+/* remote.h: Heap Lock and Remote Frees */
+
+#ifndef REMOTE_H
+#define REMOTE_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Remote Constants */
+
+#define REMOTE_ENV  "MALLOC_REMOTE"     /* Remote free policy (see below) */
+
+enum {
+    REMOTE_WAIT,        /* Wait for the heap lock (no remote frees) */
+    REMOTE_CONTENDED,   /* Defer frees that find the heap lock held (default) */
+    REMOTE_ALWAYS,      /* Defer every free (for testing) */
+};
+
+/* Remote Structure (overlays the first word of a freed object) */
+
+typedef struct remote Remote;
+struct remote {
+    Remote *    next;       /* Next object waiting to be freed */
+};
+
+/* Heap Lock Functions */
+
+void    heap_lock();
+bool    heap_trylock();
+void    heap_unlock();
+
+/* Hold heap lock until the end of the enclosing scope */
+static inline void heap_unlock_scope(bool *locked) { heap_unlock(); }
+
+#define HEAP_LOCK() \
+    __attribute__((cleanup(heap_unlock_scope))) bool heap_locked = (heap_lock(), true); (void)heap_locked
+
+/* Remote Free Functions */
+
+int     remote_policy();
+void    remote_push(void *ptr);
+size_t  remote_drain(void (*release)(void *ptr));
+
+#endif
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
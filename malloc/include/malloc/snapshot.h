@@ -0,0 +1,46 @@
+/* snapshot.h: Heap Layout Snapshot */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Snapshot Constants */
+
+#define SNAPSHOT_MAGIC      (0x70616568)    /* "heap" */
+#define SNAPSHOT_VERSION    (1)
+#define SNAPSHOT_ENV        "MALLOC_SNAPSHOT"   /* Path to write snapshot to at exit */
+#define SNAPSHOT_FREE       (1<<0)          /* Record flag: block is in the free list */
+
+/* Snapshot Structures
+ *
+ * A snapshot is a SnapshotHeader followed by one SnapshotRecord for every
+ * block in the heap in physical (address) order.
+ */
+
+typedef struct SnapshotHeader SnapshotHeader;
+struct SnapshotHeader {
+    uint32_t    magic;      /* Snapshot magic number */
+    uint32_t    version;    /* Snapshot format version */
+    uint64_t    base;       /* Address of first block */
+    uint64_t    top;        /* Address of end of last block */
+    uint64_t    records;    /* Number of records that follow */
+};
+
+typedef struct SnapshotRecord SnapshotRecord;
+struct SnapshotRecord {
+    uint64_t    offset;     /* Offset of block header from base */
+    uint64_t    capacity;   /* Number of bytes allocated to block */
+    uint64_t    size;       /* Number of bytes used by block */
+    uint32_t    flags;      /* Record flags */
+    uint32_t    reserved;   /* Padding */
+};
+
+/* Snapshot Functions */
+
+bool    heap_snapshot(int fd);
+
+#endif
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,56 @@
+/* span.h: Span Page Heap */
+
+#ifndef SPAN_H
+#define SPAN_H
+
+#include "malloc/pagemap.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Span Constants */
+
+#define SPAN_THRESHOLD      (1<<17)     /* Requests at least this large get their own span */
+#define SPAN_GROW_PAGES     (1<<8)      /* Minimum number of pages to map at once */
+#define SPAN_CACHE_PAGES    (1<<10)     /* Maximum number of free pages kept mapped */
+
+/* Span Kinds */
+
+enum {
+    SPAN_LARGE,         /* Span holds a single large request */
+    SPAN_NURSERY,       /* Span holds many short-lived blocks (every page is mapped) */
+};
+
+/* Span Structure */
+
+typedef struct span Span;
+struct span {
+    uintptr_t   start;  /* First page number of span */
+    size_t      pages;  /* Number of contiguous pages in span */
+    size_t      size;   /* Number of bytes used by span */
+    bool        free;   /* Whether or not span is in the free span list */
+    Span *      prev;   /* Pointer to previous free span */
+    Span *      next;   /* Pointer to next free span */
+    int         kind;   /* What the span is used for */
+    size_t      live;   /* Number of live blocks carved from span */
+    bool        zero;   /* Whether or not pages are untouched since mapped */
+};
+
+/* Span Macros */
+
+#define SPAN_DATA(span) \
+    PAGE_ADDRESS((span)->start)
+
+#define SPAN_CAPACITY(span) \
+    ((span)->pages << PAGE_SHIFT)
+
+/* Span Functions */
+
+Span *  span_allocate(size_t size, size_t alignment);
+void    span_release(Span *span);
+Span *  span_lookup(void *ptr);
+
+#endif
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
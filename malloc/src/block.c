@@ -3,6 +3,7 @@
 #include "malloc/block.h"
 #include "malloc/freelist.h"
 #include "malloc/counters.h"
+#include "malloc/heap.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -10,7 +11,7 @@
 #include <unistd.h>
 
 /**
- * Allocate a new block on the heap using sbrk:
+ * Allocate a new block on the heap using heap_grow:
  *
  *  1. Determined aligned amount of memory to allocate.
  *  2. Allocate memory on the heap.
@@ -22,7 +23,7 @@
 Block *	block_allocate(size_t size) {
     // Allocate block
     intptr_t allocated = sizeof(Block) + ALIGN(size);
-    Block *  block     = sbrk(allocated);
+    Block *  block     = heap_grow(allocated);
     if (block == SBRK_FAILURE) {
     	return NULL;
     }
@@ -34,9 +35,9 @@ Block *	block_allocate(size_t size) {
     block->next     = block;
 
     // Update counters
-    Counters[HEAP_SIZE] += allocated;
-    Counters[BLOCKS]++;
-    Counters[GROWS]++;
+    COUNTER_ADD(HEAP_SIZE, allocated);
+    COUNTER_INC(BLOCKS);
+    COUNTER_INC(GROWS);
     return block;
 }
 
@@ -60,16 +61,16 @@ bool	block_release(Block *block) {
         return false;
 
     // find heap line
-    size_t heap_location = (size_t)sbrk(0);
+    size_t heap_location = (size_t)heap_top();
 
     // check if end of heap / dealloc
     if (end_block == heap_location){
-        if(sbrk(-1 * allocated) == SBRK_FAILURE)
+        if(!heap_shrink(allocated))
             return false;
 
-        Counters[BLOCKS]--;
-        Counters[SHRINKS]++;
-        Counters[HEAP_SIZE] -= allocated;
+        COUNTER_DEC(BLOCKS);
+        COUNTER_INC(SHRINKS);
+        COUNTER_SUB(HEAP_SIZE, allocated);
         return true;
     }
 
@@ -84,6 +85,11 @@ bool	block_release(Block *block) {
  * @return  Pointer to detached block.
  **/
 Block * block_detach(Block *block) {
+    // Keep the next fit rover in the list
+    if (Rover == block) {
+        Rover = block->next;
+    }
+
     // TODO: Detach block from neighbors by updating previous and next block
     Block* before = block->prev;
     Block* after = block->next;
@@ -121,8 +127,8 @@ bool	block_merge(Block *dst, Block *src) {
 
     if (end_dest == start_src){
 
-        Counters[MERGES]++;
-        Counters[BLOCKS]--;
+        COUNTER_INC(MERGES);
+        COUNTER_DEC(BLOCKS);
         dst->capacity = dst->capacity + src->capacity + sizeof(Block);
 
         if (dst->next == dst){
@@ -135,6 +141,11 @@ bool	block_merge(Block *dst, Block *src) {
 
             Block *next = src->next;
             next->prev = dst;
+
+            // Destination took the place of source in the list
+            if (Rover == src) {
+                Rover = dst;
+            }
         }   
 
         return true;
@@ -181,8 +192,8 @@ Block * block_split(Block *block, size_t size) {
     block->capacity = ALIGN(size);
     block->size = size;
 
-    Counters[SPLITS]++;
-    Counters[BLOCKS]++;
+    COUNTER_INC(SPLITS);
+    COUNTER_INC(BLOCKS);
 
     return block;
 
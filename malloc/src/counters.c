@@ -3,8 +3,13 @@
 #include "malloc/block.h"
 #include "malloc/counters.h"
 #include "malloc/freelist.h"
+#include "malloc/heap.h"
+#include "malloc/nursery.h"
+#include "malloc/snapshot.h"
 
 #include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -12,11 +17,105 @@
 /* Global Variables */
 
 extern Block FreeList;
-size_t Counters[NCOUNTERS] = {0};
 int    DumpFD              = -1;
 
+__thread CounterShard CounterLocal __attribute__((tls_model("initial-exec")));
+
+static CounterShard *   Shards = NULL;                  /* Registry of live thread shards */
+static size_t           Retired[NCOUNTERS] = {0};       /* Counts of threads that exited */
+static size_t           Totals[NCOUNTERS] = {0};        /* Last aggregated counts */
+static pthread_mutex_t  ShardsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t    ShardsKey;
+
+/* Internal Functions */
+
+/**
+ * Fold the shard of an exiting thread into the retired counts and remove it
+ * from the registry (for good: the shard is marked retired so that counts
+ * made by later TLS destructors never link it again).
+ *
+ * @param   arg     Pointer to exiting thread's shard.
+ **/
+static void counters_retire(void *arg) {
+    CounterShard *shard = arg;
+
+    pthread_mutex_lock(&ShardsLock);
+    for (CounterShard **curr = &Shards; *curr; curr = &(*curr)->next) {
+        if (*curr == shard) {
+            *curr = shard->next;
+            break;
+        }
+    }
+
+    for (size_t counter = 0; counter < NCOUNTERS; counter++) {
+        Retired[counter]       += shard->values[counter];
+        shard->values[counter]  = 0;
+    }
+    shard->registered = false;
+    shard->retired    = true;
+    pthread_mutex_unlock(&ShardsLock);
+}
+
+/**
+ * Create the key used to retire shards when threads exit (only once).
+ **/
+static void counters_key() {
+    assert(pthread_key_create(&ShardsKey, counters_retire) == 0);
+}
+
 /* Functions */
 
+/**
+ * Add the calling thread's shard to the registry and make its first count.
+ *
+ * Note, if the thread already retired its shard (ie. it allocates from a TLS
+ * destructor that runs after counters_retire), the count is added straight
+ * to the retired counts, since the shard goes away with the thread.
+ *
+ * @param   counter     Counter to update.
+ * @param   n           Amount to add to counter.
+ **/
+void counters_register(size_t counter, size_t n) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, counters_key);
+
+    pthread_mutex_lock(&ShardsLock);
+    if (CounterLocal.retired) {
+        Retired[counter] += n;
+        pthread_mutex_unlock(&ShardsLock);
+        return;
+    }
+
+    CounterLocal.values[counter] += n;
+    CounterLocal.next       = Shards;
+    CounterLocal.registered = true;
+    Shards                  = &CounterLocal;
+    pthread_mutex_unlock(&ShardsLock);
+
+    pthread_setspecific(ShardsKey, &CounterLocal);
+}
+
+/**
+ * Aggregate the retired counts and the shards of all live threads.
+ *
+ * Note, this is only done when the counters are read (ie. by dump_counters or
+ * the unit tests), so counting itself never touches shared cache lines.
+ *
+ * @return  Pointer to aggregated counts (valid until the next call).
+ **/
+const size_t *counters_total() {
+    pthread_mutex_lock(&ShardsLock);
+    for (size_t counter = 0; counter < NCOUNTERS; counter++) {
+        Totals[counter] = Retired[counter];
+        for (CounterShard *shard = Shards; shard; shard = shard->next) {
+            Totals[counter] += __atomic_load_n(&shard->values[counter], __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&ShardsLock);
+
+    return Totals;
+}
+
 /**
  * Initialize counters by doing the following:
  *
@@ -37,6 +136,62 @@ void init_counters() {
     }
 }
 
+/**
+ * Record value in histogram.
+ *
+ * @param   histogram   Pointer to histogram.
+ * @param   value       Value to record.
+ **/
+void histogram_record(Histogram *histogram, size_t value) {
+    size_t bucket = value < HISTOGRAM_LINEAR ? value :
+        HISTOGRAM_LINEAR + (63 - __builtin_clzl(value)) - 6;
+
+    histogram->buckets[bucket]++;
+    histogram->calls++;
+    histogram->total += value;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+/**
+ * Compute mean of the values recorded in histogram.
+ *
+ * @param   histogram   Pointer to histogram.
+ * @return  Mean of recorded values (0 if none were recorded).
+ **/
+double histogram_mean(Histogram *histogram) {
+    return histogram->calls ? (double)histogram->total / histogram->calls : 0.0;
+}
+
+/**
+ * Compute percentile of the values recorded in histogram.
+ *
+ * Note, values past HISTOGRAM_LINEAR are only known to their power-of-two
+ * bucket, so the upper bound of the bucket (capped at the maximum) is used.
+ *
+ * @param   histogram   Pointer to histogram.
+ * @param   percent     Percentile to compute (ie. 99).
+ * @return  Smallest value at or above the specified percent of the values.
+ **/
+size_t histogram_percentile(Histogram *histogram, size_t percent) {
+    size_t rank = (histogram->calls * percent + 99) / 100;
+    size_t seen = 0;
+
+    for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (seen >= rank && seen) {
+            if (bucket < HISTOGRAM_LINEAR) {
+                return bucket;
+            }
+            size_t upper = (2UL << (bucket - HISTOGRAM_LINEAR + 6)) - 1;
+            return upper < histogram->max ? upper : histogram->max;
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Compute internal fragmentation in heap using the formula:
  *
@@ -86,6 +241,9 @@ double  external_fragmentation() {
  * Display all counters to the DumpFD global file descriptor saved in
  * init_counters.
  *
+ * If the SNAPSHOT_ENV environment variable is set, a snapshot of the heap
+ * layout is also written to the path it names.
+ *
  * Note, the function should close the DumpFD global file descriptor at the end
  * of the function.
  **/
@@ -93,6 +251,15 @@ void dump_counters() {
     char buffer[BUFSIZ];
     assert(DumpFD >= 0);
 
+    char *path = getenv(SNAPSHOT_ENV);
+    if (path) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            heap_snapshot(fd);
+            close(fd);
+        }
+    }
+
     fdprintf(DumpFD, buffer, "blocks:      %lu\n"   , Counters[BLOCKS]);
     fdprintf(DumpFD, buffer, "free blocks: %lu\n"   , free_list_length());
     fdprintf(DumpFD, buffer, "mallocs:     %lu\n"   , Counters[MALLOCS]);
@@ -100,14 +267,34 @@ void dump_counters() {
     fdprintf(DumpFD, buffer, "callocs:     %lu\n"   , Counters[CALLOCS]);
     fdprintf(DumpFD, buffer, "reallocs:    %lu\n"   , Counters[REALLOCS]);
     fdprintf(DumpFD, buffer, "reuses:      %lu\n"   , Counters[REUSES]);
+    fdprintf(DumpFD, buffer, "searched:    %lu\n"   , Counters[SEARCHED]);
+    fdprintf(DumpFD, buffer, "search cost: mean %.2lf p99 %lu max %lu\n",
+        histogram_mean(&SearchCost), histogram_percentile(&SearchCost, 99), SearchCost.max);
+    fdprintf(DumpFD, buffer, "insert cost: mean %.2lf p99 %lu max %lu\n",
+        histogram_mean(&InsertCost), histogram_percentile(&InsertCost, 99), InsertCost.max);
     fdprintf(DumpFD, buffer, "grows:       %lu\n"   , Counters[GROWS]);
     fdprintf(DumpFD, buffer, "shrinks:     %lu\n"   , Counters[SHRINKS]);
     fdprintf(DumpFD, buffer, "splits:      %lu\n"   , Counters[SPLITS]);
     fdprintf(DumpFD, buffer, "merges:      %lu\n"   , Counters[MERGES]);
     fdprintf(DumpFD, buffer, "requested:   %lu\n"   , Counters[REQUESTED]);
     fdprintf(DumpFD, buffer, "heap size:   %lu\n"   , Counters[HEAP_SIZE]);
+    if (HeapOpts.hugepages) {
+        fdprintf(DumpFD, buffer, "huge size:   %lu\n"   , Counters[HUGE_SIZE]);
+    }
+    if (Counters[PAGE_HEAP]) {
+        fdprintf(DumpFD, buffer, "page heap:   %lu\n"   , Counters[PAGE_HEAP]);
+    }
+    if (nursery_enabled()) {
+        fdprintf(DumpFD, buffer, "nursery:     %lu\n"   , Counters[NURSERY_SIZE]);
+    }
+    if (Counters[REMOTE_FREES]) {
+        fdprintf(DumpFD, buffer, "remote:      %lu\n"   , Counters[REMOTE_FREES]);
+    }
     fdprintf(DumpFD, buffer, "internal:    %4.2lf\n", internal_fragmentation());
     fdprintf(DumpFD, buffer, "external:    %4.2lf\n", external_fragmentation());
+    if (nursery_enabled()) {
+        nursery_dump(DumpFD);
+    }
 
     close(DumpFD);
 }
@@ -0,0 +1,98 @@
+/* cxx.c: C++ Allocation Operators
+ *
+ * The C++ operator new and operator delete functions are defined here under
+ * their Itanium ABI (mangled) names so that preloading the library routes C++
+ * allocations through the same heap as malloc and free without requiring a
+ * C++ compiler to build the library.
+ **/
+
+#include "malloc/block.h"
+
+#include <stdlib.h>
+
+/* External Prototypes */
+
+void *malloc_site(size_t size, void *site);
+void *aligned_alloc_site(size_t alignment, size_t size, void *site);
+void  free_sized(void *ptr, size_t size);
+void  free_aligned_sized(void *ptr, size_t alignment, size_t size);
+
+/* Provided by libstdc++ when the program is a C++ program */
+void  _ZSt17__throw_bad_allocv(void) __attribute__((weak, noreturn));
+
+/* Call site of operator new (so each C++ call site is predicted separately) */
+#define CXX_SITE    __builtin_return_address(0)
+
+/* Internal Functions */
+
+/**
+ * Allocate memory on behalf of one of the operator new variants.
+ *
+ * Note, operator new must return a unique pointer even for zero byte requests
+ * and must throw std::bad_alloc on failure unless it is a nothrow variant.
+ *
+ * @param   size        Amount of bytes to allocate.
+ * @param   alignment   Required alignment (0 for default alignment).
+ * @param   nothrow     Whether or not to return NULL on failure.
+ * @param   site        Return address of the operator new that was called.
+ * @return  Pointer to the requested amount of memory.
+ **/
+static void *cxx_allocate(size_t size, size_t alignment, bool nothrow, void *site) {
+    if (!size) {
+        size = 1;
+    }
+
+    void *ptr = alignment ? aligned_alloc_site(alignment, size, site) : malloc_site(size, site);
+    if (!ptr && !nothrow) {
+        if (_ZSt17__throw_bad_allocv) {
+            _ZSt17__throw_bad_allocv();
+        }
+        abort();
+    }
+
+    return ptr;
+}
+
+/* operator new */
+
+void *_Znwm(size_t size)                                        { return cxx_allocate(size, 0, false, CXX_SITE); }
+void *_Znam(size_t size)                                        { return cxx_allocate(size, 0, false, CXX_SITE); }
+void *_ZnwmRKSt9nothrow_t(size_t size, const void *tag)         { return cxx_allocate(size, 0, true, CXX_SITE); }
+void *_ZnamRKSt9nothrow_t(size_t size, const void *tag)         { return cxx_allocate(size, 0, true, CXX_SITE); }
+
+void *_ZnwmSt11align_val_t(size_t size, size_t alignment)       { return cxx_allocate(size, alignment, false, CXX_SITE); }
+void *_ZnamSt11align_val_t(size_t size, size_t alignment)       { return cxx_allocate(size, alignment, false, CXX_SITE); }
+void *_ZnwmSt11align_val_tRKSt9nothrow_t(size_t size, size_t alignment, const void *tag) {
+    return cxx_allocate(size, alignment, true, CXX_SITE);
+}
+void *_ZnamSt11align_val_tRKSt9nothrow_t(size_t size, size_t alignment, const void *tag) {
+    return cxx_allocate(size, alignment, true, CXX_SITE);
+}
+
+/* operator delete */
+
+void _ZdlPv(void *ptr)                                          { free(ptr); }
+void _ZdaPv(void *ptr)                                          { free(ptr); }
+void _ZdlPvRKSt9nothrow_t(void *ptr, const void *tag)           { free(ptr); }
+void _ZdaPvRKSt9nothrow_t(void *ptr, const void *tag)           { free(ptr); }
+
+void _ZdlPvm(void *ptr, size_t size)                            { free_sized(ptr, size); }
+void _ZdaPvm(void *ptr, size_t size)                            { free_sized(ptr, size); }
+
+void _ZdlPvSt11align_val_t(void *ptr, size_t alignment)         { free(ptr); }
+void _ZdaPvSt11align_val_t(void *ptr, size_t alignment)         { free(ptr); }
+void _ZdlPvSt11align_val_tRKSt9nothrow_t(void *ptr, size_t alignment, const void *tag) {
+    free(ptr);
+}
+void _ZdaPvSt11align_val_tRKSt9nothrow_t(void *ptr, size_t alignment, const void *tag) {
+    free(ptr);
+}
+
+void _ZdlPvmSt11align_val_t(void *ptr, size_t size, size_t alignment) {
+    free_aligned_sized(ptr, alignment, size);
+}
+void _ZdaPvmSt11align_val_t(void *ptr, size_t size, size_t alignment) {
+    free_aligned_sized(ptr, alignment, size);
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
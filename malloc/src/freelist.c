@@ -10,7 +10,25 @@
 
 /* Global Variables */
 
-Block FreeList = {-1, -1, &FreeList, &FreeList};
+Block   FreeList = {-1, -1, &FreeList, &FreeList};
+Block * Rover    = &FreeList;   /* Where the next fit search resumes */
+
+Histogram SearchCost = {0};
+Histogram InsertCost = {0};
+
+/* Internal Functions */
+
+/**
+ * Record the number of blocks visited by a free list search.
+ * @param   block   Pointer to block found by search (or NULL).
+ * @param   visited Number of blocks visited.
+ * @return  Pointer to block found by search (or NULL).
+ **/
+static Block *free_list_searched(Block *block, size_t visited) {
+    COUNTER_ADD(SEARCHED, visited);
+    HISTOGRAM_RECORD(&SearchCost, visited);
+    return block;
+}
 
 /* Functions */
 
@@ -22,12 +40,14 @@ Block FreeList = {-1, -1, &FreeList, &FreeList};
  **/
 Block * free_list_search_ff(size_t size) {
     // TODO: Implement first fit algorithm
+    size_t visited = 0;
     for (Block *curr = FreeList.next; curr != &FreeList; curr = curr->next){
+        visited++;
         if (curr->capacity >= size){
-            return curr;
+            return free_list_searched(curr, visited);
         }
     }
-    return NULL;
+    return free_list_searched(NULL, visited);
 }
 
 
@@ -41,10 +61,12 @@ Block * free_list_search_bf(size_t size) {
     // TODO: Implement best fit algorithm
 
     Block *closest = NULL;
+    size_t visited = 0;
 
     for (Block *curr = FreeList.next; curr != &FreeList; curr = curr->next){
+        visited++;
         if (curr->capacity == size)
-            return curr;
+            return free_list_searched(curr, visited);
         if (!closest)
             if (curr->capacity > size)
                 closest = curr;
@@ -53,10 +75,7 @@ Block * free_list_search_bf(size_t size) {
                 closest = curr;
     }
 
-    if (!closest)
-        return NULL;
-    
-    return closest;
+    return free_list_searched(closest, visited);
 }
 
 /**
@@ -69,8 +88,10 @@ Block * free_list_search_wf(size_t size) {
     // TODO: Implement worst fit algorithm
 
     Block *worst = NULL;
+    size_t visited = 0;
 
     for (Block *curr = FreeList.next; curr != &FreeList; curr = curr->next){
+        visited++;
         if (!worst)
             if (curr->capacity >= size)
                  worst = curr;
@@ -80,16 +101,42 @@ Block * free_list_search_wf(size_t size) {
         }
     }
 
-    if (!worst)
-        return NULL;
+    return free_list_searched(worst, visited);
+}
 
-    return worst;
+/**
+ * Search for an existing block in free list with at least the specified size
+ * using the next fit algorithm.
+ *
+ * Note, the search resumes at the Rover (where the previous search stopped)
+ * and wraps around the list once, so small leftover blocks at the front of
+ * the list are not visited by every search.
+ *
+ * @param   size    Amount of memory required.
+ * @return  Pointer to existing block (otherwise NULL if none are available).
+ **/
+Block * free_list_search_nf(size_t size) {
+    Block *curr    = Rover;
+    size_t visited = 0;
+
+    do {
+        if (curr != &FreeList) {
+            visited++;
+            if (curr->capacity >= size) {
+                Rover = curr;
+                return free_list_searched(curr, visited);
+            }
+        }
+        curr = curr->next;
+    } while (curr != Rover);
+
+    return free_list_searched(NULL, visited);
 }
 
 /**
  * Search for an existing block in free list with at least the specified size.
  *
- * Note, this is a wrapper function that calls one of the three algorithms
+ * Note, this is a wrapper function that calls one of the four algorithms
  * above based on the compile-time setting.
  *
  * @param   size    Amount of memory required.
@@ -103,10 +150,12 @@ Block * free_list_search(size_t size) {
     block = free_list_search_wf(size);
 #elif	defined FIT && FIT == 2
     block = free_list_search_bf(size);
+#elif	defined FIT && FIT == 3
+    block = free_list_search_nf(size);
 #endif
 
     if (block) {
-        Counters[REUSES]++;
+        COUNTER_INC(REUSES);
     }
     return block;
 }
@@ -127,14 +176,20 @@ void	free_list_insert(Block *block) {
 
     // (1) scan free list and attempt to merge specified block
 
+    size_t visited = 0;
     for (Block *curr = FreeList.next; curr != &FreeList; curr = curr->next){
+        visited++;
         bool result = block_merge(curr, block);
         if (!result)
             result = block_merge(block, curr);
-        if (result)
+        if (result) {
+            HISTOGRAM_RECORD(&InsertCost, visited);
             return;
+        }
     } 
 
+    HISTOGRAM_RECORD(&InsertCost, visited);
+
 
     // (2) if merge not possible, append to the tail
 
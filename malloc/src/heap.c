@@ -0,0 +1,204 @@
+/* heap.c: Heap Growth
+ *
+ * The heap is a single contiguous region that is grown and shrunk with sbrk.
+ * By default, every block allocation and release moves the program break
+ * directly.
+ *
+ * When huge pages are enabled, the program break is instead moved in 2 MB
+ * aligned steps and each new region is advised to be backed by transparent
+ * huge pages.  The space between the end of the last block (HeapTop) and the
+ * program break (HeapEnd) is kept in reserve for future blocks, and only whole
+ * huge pages are ever given back to the kernel so that trimming never splits
+ * a huge page.
+ **/
+
+#include "malloc/block.h"
+#include "malloc/counters.h"
+#include "malloc/heap.h"
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Global Variables */
+
+HeapOptions HeapOpts = {0};
+
+static char *HeapBase = NULL;   /* Start of first block */
+static char *HeapTop = NULL;    /* End of last block */
+static char *HeapEnd = NULL;    /* Program break */
+static char *HeapClean = NULL;  /* Memory from here on has never been handed out */
+
+/* Internal Functions */
+
+/**
+ * Read heap options from the environment (only once).
+ **/
+static void heap_init() {
+    static bool initialized = false;
+
+    if (!initialized) {
+        char *value;
+
+        HeapOpts.hugepages = (value = getenv(HUGEPAGES_ENV)) && atoi(value);
+        HeapOpts.populate  = (value = getenv(POPULATE_ENV))  && atoi(value);
+
+        HeapBase    = sbrk(0);
+        HeapTop     = HeapBase;
+        HeapEnd     = HeapBase;
+        HeapClean   = HeapBase;
+        initialized = true;
+    }
+}
+
+/**
+ * Advise the kernel to back the newly reserved region with huge pages and
+ * optionally prefault it:
+ *
+ *  1. Only the 2 MB aligned portion of the region can be huge page backed.
+ *
+ *  2. Prefaulting populates the whole region so that later block allocations
+ *  never take a page fault.
+ *
+ * @param   start   Start of newly reserved region.
+ * @param   end     End of newly reserved region (2 MB aligned).
+ **/
+static void heap_advise(char *start, char *end) {
+    char *aligned = (char *)PAGE_ALIGN((uintptr_t)start, HUGE_PAGE_SIZE);
+    if (aligned < end && madvise(aligned, end - aligned, MADV_HUGEPAGE) == 0) {
+        COUNTER_ADD(HUGE_SIZE, end - aligned);
+    }
+
+    if (HeapOpts.populate) {
+        char *page = (char *)PAGE_ALIGN((uintptr_t)start, PAGE_SIZE);
+#ifdef  MADV_POPULATE_WRITE
+        if (page < end && madvise(page, end - page, MADV_POPULATE_WRITE) == 0) {
+            return;
+        }
+#endif
+        for (; page < end; page += PAGE_SIZE) {
+            *(volatile char *)page = 0;
+        }
+    }
+}
+
+/* Functions */
+
+/**
+ * Grow the heap by the specified number of bytes.
+ *
+ * @param   size    Number of bytes to add to the end of the heap.
+ * @return  Pointer to start of new region (SBRK_FAILURE on failure).
+ **/
+void *  heap_grow(intptr_t size) {
+    heap_init();
+
+    if (size < 0) {
+        return SBRK_FAILURE;
+    }
+
+    if (!HeapOpts.hugepages) {
+        char *start = sbrk(size);
+        if (start != SBRK_FAILURE) {
+            HeapTop = HeapEnd = start + size;
+            if (HeapClean < HeapTop) {
+                HeapClean = HeapTop;
+            }
+        }
+        return start;
+    }
+
+    // Reserve more huge pages if the reserve cannot fit the request
+    if (size > HeapEnd - HeapTop) {
+        char *end = (char *)PAGE_ALIGN((uintptr_t)HeapTop + size, HUGE_PAGE_SIZE);
+        if (sbrk(end - HeapEnd) == SBRK_FAILURE) {
+            return SBRK_FAILURE;
+        }
+
+        heap_advise(HeapEnd, end);
+        HeapEnd = end;
+    }
+
+    char *start = HeapTop;
+    HeapTop += size;
+    if (HeapClean < HeapTop) {
+        HeapClean = HeapTop;
+    }
+    return start;
+}
+
+/**
+ * Shrink the heap by the specified number of bytes.
+ *
+ * Note, with huge pages enabled the program break is only moved once there is
+ * more than one whole huge page in reserve past the end of the last block.
+ *
+ * @param   size    Number of bytes to remove from the end of the heap.
+ * @return  Whether or not the heap was shrunk.
+ **/
+bool    heap_shrink(intptr_t size) {
+    heap_init();
+
+    if (!HeapOpts.hugepages) {
+        if (sbrk(-size) == SBRK_FAILURE) {
+            return false;
+        }
+        HeapTop = HeapEnd = HeapTop - size;
+
+        // The kernel only takes back whole pages past the program break
+        char *page = (char *)PAGE_ALIGN((uintptr_t)HeapEnd, PAGE_SIZE);
+        if (HeapClean > page) {
+            HeapClean = page;
+        }
+        return true;
+    }
+
+    HeapTop -= size;
+
+    char *keep = (char *)PAGE_ALIGN((uintptr_t)HeapTop, HUGE_PAGE_SIZE) + HUGE_PAGE_SIZE;
+    if (keep < HeapEnd && sbrk(-(HeapEnd - keep)) != SBRK_FAILURE) {
+        COUNTER_SUB(HUGE_SIZE, HeapEnd - keep);
+        HeapEnd = keep;
+        if (HeapClean > HeapEnd) {
+            HeapClean = HeapEnd;
+        }
+    }
+    return true;
+}
+
+/**
+ * Return the start of the heap (ie. the header of the first block).
+ *
+ * @return  Pointer to the start of the first block in the heap.
+ **/
+void *  heap_base() {
+    heap_init();
+
+    return HeapBase;
+}
+
+/**
+ * Return the end of the heap (ie. the end of the last block).
+ *
+ * @return  Pointer to the end of the last block in the heap.
+ **/
+void *  heap_top() {
+    heap_init();
+
+    return HeapOpts.hugepages ? HeapTop : sbrk(0);
+}
+
+/**
+ * Return the clean mark of the heap: memory at or after it has never been
+ * handed out since the kernel provided it (or took it back), so it is still
+ * zero.
+ *
+ * @return  Pointer to the start of memory known to be zero.
+ **/
+void *  heap_clean() {
+    heap_init();
+
+    return HeapClean;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,310 @@
+/* nursery.c: Lifetime-Aware Nursery
+ *
+ * When enabled, every allocation is attributed to its call site (the return
+ * address of the public entry point that was called, such as malloc, calloc,
+ * or operator new) and a sample of the allocated objects is tracked until
+ * they are freed to learn how long objects from each site tend to live (in
+ * number of allocations).  Once a site is known to produce short-lived objects,
+ * its small requests are bump allocated from a nursery span instead of the
+ * sbrk heap, so they no longer leave holes between long-lived blocks.  A
+ * nursery span is recycled (or released back to the page heap) as a whole once
+ * all of its blocks have been freed.
+ **/
+
+#include "malloc/block.h"
+#include "malloc/counters.h"
+#include "malloc/nursery.h"
+#include "malloc/span.h"
+
+#include <string.h>
+#include <unistd.h>
+
+/* Constants */
+
+#define NURSERY_DUMP_SITES  (1<<4)      /* Number of sites reported by nursery_dump */
+
+/* Sample Structure */
+
+typedef struct sample Sample;
+struct sample {
+    void *      ptr;        /* Sampled object */
+    Site *      site;       /* Site that allocated object */
+    size_t      birth;      /* Clock when object was allocated */
+};
+
+/* Global Variables */
+
+static int      Enabled = -1;
+static size_t   Clock   = 0;            /* Number of allocations seen */
+static Site     Sites[NURSERY_SITES];
+static Sample   Samples[NURSERY_SAMPLES];
+static Span *   Current = NULL;         /* Nursery span being bump allocated */
+
+/* Macros */
+
+#define NURSERY_HASH(value) \
+    ((((uintptr_t)(value)) >> 4) * 0x9E3779B97F4A7C15UL >> 32)
+
+/* Internal Functions */
+
+/**
+ * Lookup (or insert) the entry for the specified call site.
+ *
+ * @param   address     Return address of allocation call.
+ * @return  Pointer to site entry (NULL if table is full).
+ **/
+static Site *nursery_site(uintptr_t address) {
+    size_t hash = NURSERY_HASH(address);
+
+    for (size_t probe = 0; probe < NURSERY_SITES; probe++) {
+        Site *site = &Sites[(hash + probe) % NURSERY_SITES];
+        if (site->address == address) {
+            return site;
+        }
+        if (!site->address) {
+            site->address = address;
+            return site;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Return whether or not objects from the site are predicted to be short-lived.
+ *
+ * @param   site        Pointer to site entry.
+ * @return  Whether or not enough samples were short-lived.
+ **/
+static bool nursery_predict(Site *site) {
+    return site && site->samples >= NURSERY_MIN_SAMPLES &&
+           site->shorts * 100 >= site->samples * NURSERY_SHORT_RATIO;
+}
+
+/**
+ * Record the lifetime of a sampled object.
+ *
+ * @param   site        Pointer to site that allocated object.
+ * @param   lifetime    Number of allocations object lived for.
+ **/
+static void nursery_record(Site *site, size_t lifetime) {
+    site->samples++;
+    site->lifetime += lifetime;
+    if (lifetime < NURSERY_SHORT_LIFE) {
+        site->shorts++;
+    }
+}
+
+/**
+ * Set or clear the page map entries for the interior pages of a nursery span
+ * (span_release only expects the first and last pages to be mapped).
+ *
+ * @param   span        Pointer to nursery span.
+ * @param   value       Value to store for each interior page.
+ **/
+static void nursery_map(Span *span, void *value) {
+    for (uintptr_t page = span->start + 1; page + 1 < span->start + span->pages; page++) {
+        pagemap_set(page, value);
+    }
+}
+
+/**
+ * Allocate a new nursery span from the page heap.
+ *
+ * @return  Pointer to new nursery span (NULL on failure).
+ **/
+static Span *nursery_grow() {
+    Span *span = span_allocate(NURSERY_CHUNK, 0);
+    if (!span) {
+        return NULL;
+    }
+
+    span->kind = SPAN_NURSERY;
+    span->size = 0;
+    span->live = 0;
+    nursery_map(span, span);
+
+    COUNTER_ADD(NURSERY_SIZE, SPAN_CAPACITY(span));
+    return span;
+}
+
+/**
+ * Release nursery span back to the page heap.
+ *
+ * @param   span        Pointer to empty nursery span.
+ **/
+static void nursery_shrink(Span *span) {
+    nursery_map(span, NULL);
+    COUNTER_SUB(NURSERY_SIZE, SPAN_CAPACITY(span));
+    span_release(span);
+}
+
+/* Functions */
+
+/**
+ * Return whether or not the nursery is enabled (read from the environment
+ * only once).
+ *
+ * @return  Whether or not the nursery is enabled.
+ **/
+bool    nursery_enabled() {
+    if (Enabled < 0) {
+        char *value = getenv(NURSERY_ENV);
+        Enabled = value && atoi(value);
+    }
+
+    return Enabled;
+}
+
+/**
+ * Allocate a block from the nursery if the call site is predicted to produce
+ * short-lived objects:
+ *
+ *  1. Advance the clock and count the allocation against its site.
+ *
+ *  2. If the current nursery span is full, recycle it if it is empty,
+ *  otherwise retire it and allocate a new nursery span.
+ *
+ *  3. Bump allocate a block from the current nursery span.
+ *
+ * @param   size        Number of bytes requested.
+ * @param   address     Return address of allocation call.
+ * @return  Pointer to data portion of block (NULL if not placed in nursery).
+ **/
+void *  nursery_allocate(size_t size, void *address) {
+    if (!nursery_enabled()) {
+        return NULL;
+    }
+
+    Clock++;
+    Site *site = nursery_site((uintptr_t)address);
+    if (site) {
+        site->allocs++;
+    }
+
+    if (size > NURSERY_MAX_SIZE || !nursery_predict(site)) {
+        return NULL;
+    }
+
+    size_t allocated = sizeof(Block) + ALIGN(size);
+    if (!Current || Current->size + allocated > SPAN_CAPACITY(Current)) {
+        if (Current && !Current->live) {
+            Current->size = 0;
+        } else if (!(Current = nursery_grow())) {
+            return NULL;
+        }
+    }
+
+    Block *block    = (Block *)((char *)SPAN_DATA(Current) + Current->size);
+    block->capacity = ALIGN(size);
+    block->size     = size;
+    block->prev     = block;
+    block->next     = block;
+
+    Current->size  += allocated;
+    Current->live++;
+    return block->data;
+}
+
+/**
+ * Sample the newly allocated object (one in every NURSERY_SAMPLE_RATE
+ * allocations) so its lifetime can be measured when it is freed.
+ *
+ * Note, if the slot for the object is taken by an object that has already
+ * outlived NURSERY_SHORT_LIFE, that object is recorded as long-lived and
+ * replaced.
+ *
+ * @param   ptr         Pointer to newly allocated object.
+ * @param   address     Return address of allocation call.
+ **/
+void    nursery_sample(void *ptr, void *address) {
+    if (!nursery_enabled() || Clock % NURSERY_SAMPLE_RATE) {
+        return;
+    }
+
+    Site *site = nursery_site((uintptr_t)address);
+    if (!site) {
+        return;
+    }
+
+    Sample *sample = &Samples[NURSERY_HASH(ptr) % NURSERY_SAMPLES];
+    if (sample->ptr) {
+        if (Clock - sample->birth < NURSERY_SHORT_LIFE) {
+            return;
+        }
+        nursery_record(sample->site, Clock - sample->birth);
+    }
+
+    sample->ptr   = ptr;
+    sample->site  = site;
+    sample->birth = Clock;
+}
+
+/**
+ * Record the lifetime of the object being freed (if it was sampled) and
+ * release it if it belongs to a nursery span.
+ *
+ * @param   ptr         Pointer to object being freed.
+ * @return  Whether or not the object was released by the nursery.
+ **/
+bool    nursery_release(void *ptr) {
+    if (!nursery_enabled()) {
+        return false;
+    }
+
+    Sample *sample = &Samples[NURSERY_HASH(ptr) % NURSERY_SAMPLES];
+    if (sample->ptr == ptr) {
+        nursery_record(sample->site, Clock - sample->birth);
+        sample->ptr = NULL;
+    }
+
+    Span *span = pagemap_get(PAGE_NUMBER(ptr));
+    if (!span || span->free || span->kind != SPAN_NURSERY) {
+        return false;
+    }
+
+    // Trim nursery span wholesale once all of its blocks are freed
+    if (--span->live == 0) {
+        if (span == Current) {
+            span->size = 0;
+        } else {
+            nursery_shrink(span);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Display the learned statistics of the busiest call sites.
+ *
+ * @param   fd          File descriptor to write statistics to.
+ **/
+void    nursery_dump(int fd) {
+    char  buffer[BUFSIZ];
+    bool  dumped[NURSERY_SITES] = {false};
+
+    for (size_t n = 0; n < NURSERY_DUMP_SITES; n++) {
+        Site *busiest = NULL;
+        for (size_t i = 0; i < NURSERY_SITES; i++) {
+            if (!dumped[i] && Sites[i].allocs && (!busiest || Sites[i].allocs > busiest->allocs)) {
+                busiest = &Sites[i];
+            }
+        }
+
+        if (!busiest) {
+            break;
+        }
+        dumped[busiest - Sites] = true;
+
+        fdprintf(fd, buffer, "site %#14lx: allocs %8lu samples %6lu short %3lu%% life %8lu %s\n",
+            busiest->address,
+            busiest->allocs,
+            busiest->samples,
+            busiest->samples ? busiest->shorts * 100 / busiest->samples : 0,
+            busiest->samples ? busiest->lifetime / busiest->samples : 0,
+            nursery_predict(busiest) ? "nursery" : "heap");
+    }
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
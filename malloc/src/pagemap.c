@@ -0,0 +1,78 @@
+/* pagemap.c: Page Map Radix Tree
+ *
+ * The PageMap is a two-level radix tree that maps a page number to the
+ * metadata of whatever owns that page.  The root is a static array indexed by
+ * the high bits of the page number and each leaf is mapped on demand the first
+ * time a page it covers is reserved, so lookups are always two loads.
+ **/
+
+#include "malloc/pagemap.h"
+
+#include <sys/mman.h>
+
+/* Global Variables */
+
+static void **PageMap[1<<PAGEMAP_ROOT_BITS] = {0};
+
+/* Macros */
+
+#define PAGEMAP_ROOT(page)  ((page) >> PAGEMAP_LEAF_BITS)
+#define PAGEMAP_LEAF(page)  ((page) & ((1UL<<PAGEMAP_LEAF_BITS) - 1))
+
+/* Functions */
+
+/**
+ * Make sure the leaves covering the specified range of pages exist.
+ *
+ * @param   page    First page number in range.
+ * @param   pages   Number of pages in range.
+ * @return  Whether or not every leaf in the range could be allocated.
+ **/
+bool    pagemap_reserve(uintptr_t page, size_t pages) {
+    for (uintptr_t root = PAGEMAP_ROOT(page); root <= PAGEMAP_ROOT(page + pages - 1); root++) {
+        if (root >= (1<<PAGEMAP_ROOT_BITS)) {
+            return false;
+        }
+
+        if (!PageMap[root]) {
+            void *leaf = mmap(NULL, sizeof(void *) << PAGEMAP_LEAF_BITS,
+                              PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (leaf == MAP_FAILED) {
+                return false;
+            }
+            PageMap[root] = leaf;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Lookup the value associated with the specified page.
+ *
+ * @param   page    Page number to lookup.
+ * @return  Value associated with page (NULL if none).
+ **/
+void *  pagemap_get(uintptr_t page) {
+    if (PAGEMAP_ROOT(page) >= (1<<PAGEMAP_ROOT_BITS)) {
+        return NULL;
+    }
+
+    void **leaf = PageMap[PAGEMAP_ROOT(page)];
+    return leaf ? leaf[PAGEMAP_LEAF(page)] : NULL;
+}
+
+/**
+ * Associate the value with the specified page.
+ *
+ * Note, the page must have been reserved by pagemap_reserve.
+ *
+ * @param   page    Page number to update.
+ * @param   value   Value to associate with page.
+ **/
+void    pagemap_set(uintptr_t page, void *value) {
+    PageMap[PAGEMAP_ROOT(page)][PAGEMAP_LEAF(page)] = value;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
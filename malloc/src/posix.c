@@ -2,24 +2,27 @@
 
 #include "malloc/counters.h"
 #include "malloc/freelist.h"
+#include "malloc/heap.h"
+#include "malloc/nursery.h"
+#include "malloc/remote.h"
+#include "malloc/span.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <string.h>
 
+/* Internal Functions */
+
+static void free_pointer(void *ptr);
+
 /**
- * Allocate specified amount memory.
+ * Allocate a block with the specified size from the free list (or by growing
+ * the heap).
+ *
  * @param   size    Amount of bytes to allocate.
- * @return  Pointer to the requested amount of memory.
+ * @return  Pointer to the data portion of the block.
  **/
-void *malloc(size_t size) {
-    // Initialize counters
-    init_counters();
-
-    // Handle empty size
-    if (!size) {
-        return NULL;
-    }
-
+static void *malloc_block(size_t size) {
     // TODO: Search free list for any available block with matching size
         
     Block *block = free_list_search(size); 
@@ -42,16 +45,157 @@ void *malloc(size_t size) {
     assert(block->next     == block);
     assert(block->prev     == block);
 
-    // Update counters
-    Counters[MALLOCS]++;
-    Counters[REQUESTED] += size;
-
     // Return data address associated with block
     return block->data;
 }
 
+/**
+ * Allocate a span with the specified size and alignment from the page heap.
+ * @param   size        Amount of bytes to allocate.
+ * @param   alignment   Required alignment (0 for page alignment).
+ * @return  Pointer to the data portion of the span.
+ **/
+static void *malloc_span(size_t size, size_t alignment) {
+    Span *span = span_allocate(size, alignment);
+    return span ? SPAN_DATA(span) : NULL;
+}
+
+/**
+ * Release a block by trimming the heap or inserting it into the free list.
+ * @param   block   Pointer to block to release.
+ **/
+static void free_block(Block *block) {
+    // TODO: Try to release block, otherwise insert it into the free list
+    if (!block_release(block)) {
+        free_list_insert(block);
+    }
+}
+
+/**
+ * Release previously allocated memory (with the heap lock held).
+ *
+ * Note, the page map classifies the pointer as either a nursery block, a span,
+ * or a block in the sbrk heap.
+ *
+ * @param   ptr     Pointer to previously allocated memory.
+ **/
+static void free_pointer(void *ptr) {
+    // Update counters
+    COUNTER_INC(FREES);
+
+    if (nursery_release(ptr)) {
+        return;
+    }
+
+    Span *span = span_lookup(ptr);
+    if (span) {
+        span_release(span);
+    } else {
+        free_block(BLOCK_FROM_POINTER(ptr));
+    }
+}
+
+/**
+ * Acquire the heap lock to release the pointer, or push the pointer onto the
+ * remote free stack instead, as determined by the remote free policy.
+ *
+ * @param   ptr     Pointer to previously allocated memory.
+ * @return  Whether or not the heap lock was acquired.
+ **/
+static bool free_lock(void *ptr) {
+    int policy = remote_policy();
+
+    if (policy != REMOTE_ALWAYS && heap_trylock()) {
+        return true;
+    }
+
+    if (policy == REMOTE_WAIT) {
+        heap_lock();
+        return true;
+    }
+
+    remote_push(ptr);
+    return false;
+}
+
+/**
+ * Return whether or not newly allocated memory is known to still be zero:
+ * either a span that has not been touched since it was mapped, or a block
+ * that was grown entirely past the heap's clean mark.
+ *
+ * @param   ptr     Pointer to newly allocated memory.
+ * @param   clean   Clean mark of the heap before the allocation.
+ * @return  Whether or not the memory needs to be zeroed.
+ **/
+static bool calloc_zeroed(void *ptr, char *clean) {
+    Span *span = span_lookup(ptr);
+    if (span) {
+        return span->zero;
+    }
+
+    Block *block = BLOCK_FROM_POINTER(ptr);
+    return (char *)block >= clean && (char *)block < (char *)heap_top();
+}
+
+/* Functions */
+
+/**
+ * Allocate specified amount of memory on behalf of the specified call site
+ * (used by every public allocation entry point).
+ *
+ * Note, requests of at least SPAN_THRESHOLD bytes are served by the page
+ * heap, requests from call sites predicted to be short-lived by the nursery,
+ * and everything else by a block in the sbrk heap.
+ *
+ * @param   size    Amount of bytes to allocate.
+ * @param   site    Return address of the public entry point that was called.
+ * @return  Pointer to the requested amount of memory.
+ **/
+void *malloc_site(size_t size, void *site) {
+    HEAP_LOCK();
+
+    // Initialize counters
+    init_counters();
+
+    // Release objects freed by other threads while the lock was held
+    remote_drain(free_pointer);
+
+    // Handle empty size
+    if (!size) {
+        return NULL;
+    }
+
+    void *ptr = nursery_allocate(size, site);
+    if (!ptr) {
+        ptr = (size >= SPAN_THRESHOLD) ? malloc_span(size, 0) : malloc_block(size);
+    }
+    if (!ptr) {
+        return NULL;
+    }
+    nursery_sample(ptr, site);
+
+    // Update counters
+    COUNTER_INC(MALLOCS);
+    COUNTER_ADD(REQUESTED, size);
+    return ptr;
+}
+
+/**
+ * Allocate specified amount memory.
+ * @param   size    Amount of bytes to allocate.
+ * @return  Pointer to the requested amount of memory.
+ **/
+void *malloc(size_t size) {
+    return malloc_site(size, __builtin_return_address(0));
+}
+
 /**
  * Release previously allocated memory.
+ *
+ * Note, if another thread holds the heap lock, the pointer is pushed onto the
+ * remote free stack instead of waiting for the lock (see free_lock).
+ * Otherwise, the stack is drained along with the pointer.
+ *
  * @param   ptr     Pointer to previously allocated memory.
  **/
 void free(void *ptr) {
@@ -59,20 +203,229 @@ void free(void *ptr) {
         return;
     }
 
+    if (!free_lock(ptr)) {
+        return;
+    }
+
+    free_pointer(ptr);
+    remote_drain(free_pointer);
+    heap_unlock();
+}
+
+/**
+ * Return number of usable bytes in previously allocated memory.
+ * @param   ptr     Pointer to previously allocated memory.
+ * @return  Number of bytes that may be used at ptr.
+ **/
+size_t malloc_usable_size(void *ptr) {
+    if (!ptr) {
+        return 0;
+    }
+
+    HEAP_LOCK();
+
+    Span *span = span_lookup(ptr);
+    if (span) {
+        return SPAN_CAPACITY(span);
+    }
+
+    Block *block = BLOCK_FROM_POINTER(ptr);
+    return block->capacity;
+}
+
+/**
+ * Release previously allocated memory whose size is known to the caller.
+ *
+ * Note, the size must be the same amount that was originally requested (or
+ * at least fit in the capacity of the block).  Since requests smaller than
+ * SPAN_THRESHOLD always live in the sbrk heap (unless the nursery is
+ * enabled), the page map lookup is skipped for them.
+ *
+ * @param   ptr     Pointer to previously allocated memory.
+ * @param   size    Amount of bytes originally requested.
+ **/
+void free_sized(void *ptr, size_t size) {
+    if (!ptr) {
+        return;
+    }
+
+    if (size >= SPAN_THRESHOLD || nursery_enabled()) {
+        free(ptr);
+        return;
+    }
+
+    if (!free_lock(ptr)) {
+        return;
+    }
+
     // Update counters
-    Counters[FREES]++;
+    COUNTER_INC(FREES);
 
-    // TODO: Try to release block, otherwise insert it into the free list
-    Block* block = BLOCK_FROM_POINTER(ptr);
-    if (!block_release(block)) {
-        free_list_insert(block);
+    Block *block = BLOCK_FROM_POINTER(ptr);
+    assert(block->capacity >= size);
+    free_block(block);
+    remote_drain(free_pointer);
+    heap_unlock();
+}
+
+/**
+ * Release previously allocated aligned memory whose size and alignment are
+ * known to the caller.
+ *
+ * @param   ptr         Pointer to previously allocated memory.
+ * @param   alignment   Alignment originally requested.
+ * @param   size        Amount of bytes originally requested.
+ **/
+void free_aligned_sized(void *ptr, size_t alignment, size_t size) {
+    if (!ptr) {
+        return;
+    }
+
+    assert(((intptr_t)ptr & (alignment - 1)) == 0);
+    free_sized(ptr, size);
+}
+
+/**
+ * Allocate specified amount of memory aligned to the specified boundary on
+ * behalf of the specified call site:
+ *
+ *  1. Allocate enough memory to fit both an aligned data address and its
+ *  header.
+ *
+ *  2. Split the leading fragment off into its own block and insert it into
+ *  the free list.
+ *
+ * @param   alignment   Power of two boundary to align data address to.
+ * @param   size        Amount of bytes to allocate.
+ * @param   site        Return address of the public entry point that was called.
+ * @return  Pointer to the requested amount of aligned memory.
+ **/
+void *aligned_alloc_site(size_t alignment, size_t size, void *site) {
+    if (!alignment || (alignment & (alignment - 1))) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (alignment <= ALIGNMENT) {
+        return malloc_site(size, site);
+    }
+
+    HEAP_LOCK();
+
+    // Initialize counters
+    init_counters();
+
+    // Release objects freed by other threads while the lock was held
+    remote_drain(free_pointer);
+
+    // Large requests get their own aligned span
+    if (size >= SPAN_THRESHOLD) {
+        void *ptr = malloc_span(size, alignment);
+        if (!ptr) {
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        COUNTER_INC(MALLOCS);
+        COUNTER_ADD(REQUESTED, size);
+        return ptr;
+    }
+
+    // Allocate room for a leading fragment, a header, and the aligned data
+    size_t padding = alignment + sizeof(Block) + ALIGNMENT;
+    if (size > SIZE_MAX - padding) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    void * ptr     = malloc_block(size + padding);
+    if (!ptr) {
+        return NULL;
+    }
+
+    COUNTER_INC(MALLOCS);
+    COUNTER_ADD(REQUESTED, size);
+
+    Block *block = BLOCK_FROM_POINTER(ptr);
+    block->size  = size;
+    if (((intptr_t)ptr & (alignment - 1)) == 0) {
+        return ptr;
+    }
+
+    // Split off leading fragment and give it back to the free list
+    intptr_t aligned = ((intptr_t)ptr + padding - 1) & ~(alignment - 1);
+    Block *  split   = BLOCK_FROM_POINTER(aligned);
+
+    split->capacity = block->capacity - (aligned - (intptr_t)ptr);
+    split->size     = size;
+    split->prev     = split;
+    split->next     = split;
+
+    block->capacity = (intptr_t)split - (intptr_t)block->data;
+    block->size     = block->capacity;
+
+    COUNTER_INC(SPLITS);
+    COUNTER_INC(BLOCKS);
+
+    free_list_insert(block);
+    return split->data;
+}
+
+/**
+ * Allocate specified amount of memory aligned to the specified boundary.
+ * @param   alignment   Power of two boundary to align data address to.
+ * @param   size        Amount of bytes to allocate.
+ * @return  Pointer to the requested amount of aligned memory.
+ **/
+void *aligned_alloc(size_t alignment, size_t size) {
+    return aligned_alloc_site(alignment, size, __builtin_return_address(0));
+}
+
+/**
+ * Allocate specified amount of memory aligned to the specified boundary and
+ * store its address in memptr.
+ *
+ * @param   memptr      Where to store address of allocated memory.
+ * @param   alignment   Power of two multiple of sizeof(void *).
+ * @param   size        Amount of bytes to allocate.
+ * @return  0 on success, otherwise EINVAL or ENOMEM.
+ **/
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    if (!alignment || alignment % sizeof(void *) || (alignment & (alignment - 1))) {
+        return EINVAL;
+    }
+
+    // Report failure through the return value only (errno is left untouched)
+    int   saved = errno;
+    void *ptr   = aligned_alloc_site(alignment, size, __builtin_return_address(0));
+    errno = saved;
+    if (!ptr && size) {
+        return ENOMEM;
     }
 
+    *memptr = ptr;
+    return 0;
+}
+
+/**
+ * Allocate specified amount of memory aligned to the specified boundary
+ * (obsolete interface kept for older programs).
+ *
+ * @param   alignment   Power of two boundary to align data address to.
+ * @param   size        Amount of bytes to allocate.
+ * @return  Pointer to the requested amount of aligned memory.
+ **/
+void *memalign(size_t alignment, size_t size) {
+    return aligned_alloc_site(alignment, size, __builtin_return_address(0));
 }
 
 /**
  * Allocate memory with specified number of elements and with each element set
  * to 0.
+ *
+ * Note, memory that is fresh from the kernel is already zero, so it is only
+ * cleared if it has been handed out before.
+ *
  * @param   nmemb   Number of elements.
  * @param   size    Size of each element.
  * @return  Pointer to requested amount of memory.
@@ -81,14 +434,22 @@ void *calloc(size_t nmemb, size_t size) {
     if (!nmemb || !size)
         return NULL;
 
-    Counters[CALLOCS]++;
+    size_t total;
+    if (__builtin_mul_overflow(nmemb, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    HEAP_LOCK();
+    COUNTER_INC(CALLOCS);
 
-    void *ptr = malloc(nmemb * size);
+    char *clean = heap_clean();
+    void *ptr   = malloc_site(total, __builtin_return_address(0));
     if (!ptr)
-        return false;
+        return NULL;
 
-    if(!memset(ptr, 0, nmemb*size))
-            return false;
+    if (!calloc_zeroed(ptr, clean))
+        memset(ptr, 0, total);
     return ptr;
 }
 
@@ -102,33 +463,43 @@ void *calloc(size_t nmemb, size_t size) {
 void *realloc(void *ptr, size_t size) {
     // TODO: Implement realloc
 
-    Counters[REALLOCS]++;
+    HEAP_LOCK();
+    COUNTER_INC(REALLOCS);
 
     if (!ptr)
-        return malloc(size);
+        return malloc_site(size, __builtin_return_address(0));
 
     if (size == 0){
         free(ptr);
         return NULL;
     }
 
-    Block* pointer = BLOCK_FROM_POINTER(ptr);
-
-    if (pointer->capacity >= size){
-        pointer->size = size;
-        return pointer->data; 
-    }
-
-    if (pointer->capacity < size){
-        free(ptr);
-        return malloc(size);
+    // Resize in place if it still fits (and still belongs in the same heap)
+    size_t old_size;
+    Span * span = span_lookup(ptr);
+    if (span) {
+        if (SPAN_CAPACITY(span) >= size && size >= SPAN_THRESHOLD) {
+            span->size = size;
+            return ptr;
+        }
+        old_size = span->size;
+    } else {
+        Block* pointer = BLOCK_FROM_POINTER(ptr);
+        if (pointer->capacity >= size){
+            pointer->size = size;
+            return pointer->data; 
+        }
+        old_size = pointer->size;
     }
 
-  //  if (size > (BLOCK_FROM_POINTER(ptr))->size){
-  //     (BLOCK_FROM_POINTER(ptr))->size = size;
-  //  }
+    // Otherwise move the data to a new allocation
+    void *new_ptr = malloc_site(size, __builtin_return_address(0));
+    if (!new_ptr)
+        return NULL;
 
-    return NULL;
+    memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+    free(ptr);
+    return new_ptr;
 }
 
 /* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
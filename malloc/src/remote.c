@@ -0,0 +1,108 @@
+/* remote.c: Heap Lock and Remote Frees
+ *
+ * All of the heaps are protected by a single (recursive) lock.  A thread that
+ * frees memory while another thread holds the lock does not wait for it:
+ * instead, it pushes the object onto a lock-free stack of remote frees with a
+ * single compare-and-swap.  Whichever thread takes the lock next to allocate or
+ * free drains the whole stack in one batch.
+ *
+ * Note, there is a single shared heap (rather than one heap per thread), so
+ * the stack belongs to that heap and the lock holder acts as its owner.
+ **/
+
+#define _GNU_SOURCE
+
+#include "malloc/counters.h"
+#include "malloc/remote.h"
+
+#include <pthread.h>
+
+/* Global Variables */
+
+static pthread_mutex_t HeapLock   = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static Remote *        RemoteHead = NULL;
+static int             Policy     = -1;
+
+/* Heap Lock Functions */
+
+/**
+ * Acquire heap lock (waiting if another thread holds it).
+ **/
+void    heap_lock() {
+    pthread_mutex_lock(&HeapLock);
+}
+
+/**
+ * Try to acquire heap lock without waiting.
+ * @return  Whether or not the heap lock was acquired.
+ **/
+bool    heap_trylock() {
+    return pthread_mutex_trylock(&HeapLock) == 0;
+}
+
+/**
+ * Release heap lock.
+ **/
+void    heap_unlock() {
+    pthread_mutex_unlock(&HeapLock);
+}
+
+/* Remote Free Functions */
+
+/**
+ * Return the remote free policy (read from the environment only once).
+ *
+ * @return  REMOTE_WAIT, REMOTE_CONTENDED, or REMOTE_ALWAYS.
+ **/
+int     remote_policy() {
+    if (Policy < 0) {
+        char *value = getenv(REMOTE_ENV);
+        Policy = value ? atoi(value) : REMOTE_CONTENDED;
+    }
+
+    return Policy;
+}
+
+/**
+ * Push object onto the remote free stack (without holding the heap lock).
+ *
+ * Note, the link to the next object is stored in the first word of the
+ * object's data, so no memory needs to be allocated.
+ *
+ * @param   ptr     Pointer to previously allocated memory.
+ **/
+void    remote_push(void *ptr) {
+    Remote *remote = ptr;
+
+    remote->next = __atomic_load_n(&RemoteHead, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&RemoteHead, &remote->next, remote,
+                                        true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/**
+ * Detach the whole remote free stack and release each object on it (must be
+ * called with the heap lock held).
+ *
+ * @param   release Function that frees an object with the heap lock held.
+ * @return  Number of objects released.
+ **/
+size_t  remote_drain(void (*release)(void *ptr)) {
+    if (!__atomic_load_n(&RemoteHead, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    Remote *remote  = __atomic_exchange_n(&RemoteHead, NULL, __ATOMIC_ACQUIRE);
+    size_t  drained = 0;
+
+    while (remote) {
+        Remote *next = remote->next;
+        release(remote);
+        remote = next;
+        drained++;
+    }
+
+    COUNTER_ADD(REMOTE_FREES, drained);
+    return drained;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,102 @@
+/* snapshot.c: Heap Layout Snapshot
+ *
+ * A snapshot walks the heap physically, from the header of the first block to
+ * the end of the last block, and records the capacity, size, and status of
+ * every block so that the layout can be analyzed offline (see bin/heapviz).
+ **/
+
+#include "malloc/block.h"
+#include "malloc/heap.h"
+#include "malloc/snapshot.h"
+
+#include <unistd.h>
+
+/* Constants */
+
+#define SNAPSHOT_BUFFER     (1<<7)  /* Number of records to buffer per write */
+
+/* Internal Functions */
+
+/**
+ * Return the block physically following the specified block.
+ *
+ * @param   block   Pointer to block.
+ * @return  Pointer to next block in memory.
+ **/
+static Block *snapshot_next(Block *block) {
+    return (Block *)(block->data + block->capacity);
+}
+
+/**
+ * Write exactly size bytes from buffer to the file descriptor.
+ *
+ * @param   fd      File descriptor to write to.
+ * @param   buffer  Data to write.
+ * @param   size    Number of bytes to write.
+ * @return  Whether or not all the bytes were written.
+ **/
+static bool snapshot_write(int fd, const void *buffer, size_t size) {
+    const char *data = buffer;
+
+    while (size) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+/* Functions */
+
+/**
+ * Write a snapshot of the heap layout to the specified file descriptor:
+ *
+ *  1. Walk the heap once to count the blocks and write the header.
+ *
+ *  2. Walk the heap again and write a record for each block (a block is free
+ *  if it is linked into the free list, since allocated blocks always point to
+ *  themselves).
+ *
+ * Note, this does not allocate any memory.
+ *
+ * @param   fd      File descriptor to write snapshot to.
+ * @return  Whether or not the snapshot was written successfully.
+ **/
+bool    heap_snapshot(int fd) {
+    Block *base = heap_base();
+    Block *top  = heap_top();
+
+    SnapshotHeader header = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, (uintptr_t)base, (uintptr_t)top, 0};
+    for (Block *curr = base; curr < top; curr = snapshot_next(curr)) {
+        header.records++;
+    }
+
+    if (!snapshot_write(fd, &header, sizeof(header))) {
+        return false;
+    }
+
+    SnapshotRecord records[SNAPSHOT_BUFFER];
+    size_t         nrecords = 0;
+    for (Block *curr = base; curr < top; curr = snapshot_next(curr)) {
+        records[nrecords].offset   = (uintptr_t)curr - (uintptr_t)base;
+        records[nrecords].capacity = curr->capacity;
+        records[nrecords].size     = curr->size;
+        records[nrecords].flags    = (curr->next != curr) ? SNAPSHOT_FREE : 0;
+        records[nrecords].reserved = 0;
+
+        if (++nrecords == SNAPSHOT_BUFFER) {
+            if (!snapshot_write(fd, records, sizeof(records))) {
+                return false;
+            }
+            nrecords = 0;
+        }
+    }
+
+    return snapshot_write(fd, records, nrecords * sizeof(SnapshotRecord));
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,328 @@
+/* span.c: Span Page Heap
+ *
+ * Large requests are served from spans of contiguous pages mapped directly
+ * from the kernel instead of from the sbrk heap.  Every span records its first
+ * and last page in the PageMap, which lets any pointer be classified in O(1)
+ * and lets a released span find and coalesce with its free neighbors at page
+ * granularity.  Free spans are kept in the FreeSpans list (an unordered
+ * doubly-linked circular list) until too many free pages are cached, at which
+ * point released spans are returned to the kernel instead.
+ **/
+
+#include "malloc/counters.h"
+#include "malloc/heap.h"
+#include "malloc/span.h"
+
+#include <sys/mman.h>
+
+/* Global Variables */
+
+Span          FreeSpans   = {0, 0, 0, false, &FreeSpans, &FreeSpans, SPAN_LARGE, 0, false};
+size_t        FreePages   = 0;
+
+static Span * Descriptors = NULL;   /* Stack of unused span descriptors */
+
+/* Internal Functions */
+
+/**
+ * Allocate a span descriptor (mapping another page of descriptors if
+ * necessary).
+ *
+ * @return  Pointer to unused span descriptor (NULL on failure).
+ **/
+static Span *span_descriptor() {
+    if (!Descriptors) {
+        Span *page = mmap(NULL, PAGE_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (page == MAP_FAILED) {
+            return NULL;
+        }
+
+        for (size_t i = 0; i < PAGE_SIZE / sizeof(Span); i++) {
+            page[i].next = Descriptors;
+            Descriptors  = &page[i];
+        }
+    }
+
+    Span *span  = Descriptors;
+    Descriptors = span->next;
+    return span;
+}
+
+/**
+ * Return span descriptor to the stack of unused descriptors.
+ *
+ * @param   span    Pointer to span descriptor to recycle.
+ **/
+static void span_recycle(Span *span) {
+    span->next  = Descriptors;
+    Descriptors = span;
+}
+
+/**
+ * Record span as the owner of its first and last pages.
+ *
+ * @param   span    Pointer to span to record.
+ **/
+static void span_map(Span *span) {
+    pagemap_set(span->start, span);
+    pagemap_set(span->start + span->pages - 1, span);
+}
+
+/**
+ * Forget span as the owner of its first and last pages.
+ *
+ * @param   span    Pointer to span to forget.
+ **/
+static void span_unmap(Span *span) {
+    pagemap_set(span->start, NULL);
+    pagemap_set(span->start + span->pages - 1, NULL);
+}
+
+/**
+ * Append span to the tail of the free span list.
+ *
+ * @param   span    Pointer to span to insert.
+ **/
+static void span_link(Span *span) {
+    Span *tail = FreeSpans.prev;
+
+    tail->next     = span;
+    span->prev     = tail;
+    span->next     = &FreeSpans;
+    FreeSpans.prev = span;
+
+    span->free     = true;
+    span->size     = 0;
+    FreePages     += span->pages;
+}
+
+/**
+ * Remove span from the free span list.
+ *
+ * @param   span    Pointer to span to remove.
+ **/
+static void span_unlink(Span *span) {
+    span->prev->next = span->next;
+    span->next->prev = span->prev;
+    span->next       = span;
+    span->prev       = span;
+
+    span->free       = false;
+    FreePages       -= span->pages;
+}
+
+/**
+ * Split span so that it only has the specified number of pages, placing the
+ * remaining pages into a new free span.
+ *
+ * @param   span    Pointer to (unlinked) span to split.
+ * @param   pages   Number of pages span should keep.
+ * @return  Pointer to new free span with remaining pages (NULL if no split).
+ **/
+static Span *span_split(Span *span, size_t pages) {
+    if (span->pages <= pages) {
+        return NULL;
+    }
+
+    Span *rest = span_descriptor();
+    if (!rest) {
+        return NULL;
+    }
+
+    rest->start = span->start + pages;
+    rest->pages = span->pages - pages;
+    rest->zero  = span->zero;
+    span->pages = pages;
+
+    span_map(span);
+    span_map(rest);
+    span_link(rest);
+    COUNTER_INC(SPLITS);
+    return rest;
+}
+
+/**
+ * Coalesce (unlinked) span with any free spans immediately before or after
+ * it.
+ *
+ * @param   span    Pointer to span to coalesce.
+ * @return  Pointer to coalesced span.
+ **/
+static Span *span_coalesce(Span *span) {
+    Span *left = pagemap_get(span->start - 1);
+    if (left && left->free && left->start + left->pages == span->start) {
+        span_unlink(left);
+        span_unmap(left);
+        span_unmap(span);
+        left->pages += span->pages;
+        left->zero   = left->zero && span->zero;
+        span_recycle(span);
+        span = left;
+        span_map(span);
+        COUNTER_INC(MERGES);
+    }
+
+    Span *right = pagemap_get(span->start + span->pages);
+    if (right && right->free && right->start == span->start + span->pages) {
+        span_unlink(right);
+        span_unmap(right);
+        span_unmap(span);
+        span->pages += right->pages;
+        span->zero   = span->zero && right->zero;
+        span_recycle(right);
+        span_map(span);
+        COUNTER_INC(MERGES);
+    }
+
+    return span;
+}
+
+/**
+ * Map a new region of pages from the kernel into a span.
+ *
+ * @param   pages   Minimum number of pages required.
+ * @return  Pointer to new (unlinked) span (NULL on failure).
+ **/
+static Span *span_grow(size_t pages) {
+    if (pages < SPAN_GROW_PAGES) {
+        pages = SPAN_GROW_PAGES;
+    }
+
+    void *data = mmap(NULL, pages << PAGE_SHIFT, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    Span *span = span_descriptor();
+    if (!span || !pagemap_reserve(PAGE_NUMBER(data), pages)) {
+        if (span) {
+            span_recycle(span);
+        }
+        munmap(data, pages << PAGE_SHIFT);
+        return NULL;
+    }
+
+    span->start = PAGE_NUMBER(data);
+    span->pages = pages;
+    span->size  = 0;
+    span->free  = false;
+    span->prev  = span;
+    span->next  = span;
+    span->zero  = true;
+    span_map(span);
+
+    COUNTER_ADD(PAGE_HEAP, pages << PAGE_SHIFT);
+    COUNTER_INC(GROWS);
+    return span_coalesce(span);
+}
+
+/* Functions */
+
+/**
+ * Allocate a span with enough pages for the specified size:
+ *
+ *  1. Search the free spans for the smallest one that fits (including any
+ *  slack needed for alignment), otherwise map a new span.
+ *
+ *  2. Give any leading pages needed for alignment back to the free spans.
+ *
+ *  3. Split off any trailing pages into a new free span.
+ *
+ * @param   size        Number of bytes required.
+ * @param   alignment   Required alignment of span data (0 for page aligned).
+ * @return  Pointer to allocated span (NULL on failure).
+ **/
+Span *  span_allocate(size_t size, size_t alignment) {
+    if (size > SIZE_MAX - alignment - PAGE_SIZE) {
+        return NULL;
+    }
+
+    size_t pages = PAGE_ALIGN(size, PAGE_SIZE) >> PAGE_SHIFT;
+    size_t slack = alignment > PAGE_SIZE ? (alignment >> PAGE_SHIFT) - 1 : 0;
+
+    // Search for best fit
+    Span *span = NULL;
+    for (Span *curr = FreeSpans.next; curr != &FreeSpans; curr = curr->next) {
+        if (curr->pages >= pages + slack && (!span || curr->pages < span->pages)) {
+            span = curr;
+        }
+    }
+
+    if (span) {
+        span_unlink(span);
+        COUNTER_INC(REUSES);
+    } else if (!(span = span_grow(pages + slack))) {
+        return NULL;
+    }
+
+    // Give back leading pages
+    uintptr_t aligned = slack ? PAGE_ALIGN(span->start, alignment >> PAGE_SHIFT) : span->start;
+    if (aligned != span->start) {
+        Span *rest = span_split(span, aligned - span->start);
+        if (!rest) {
+            span_link(span);
+            return NULL;
+        }
+
+        span_unlink(rest);
+        span_link(span);
+        span = rest;
+    }
+
+    // Give back trailing pages
+    span_split(span, pages);
+
+    span->size = size;
+    span->kind = SPAN_LARGE;
+    span->live = 0;
+    return span;
+}
+
+/**
+ * Release span back to the page heap:
+ *
+ *  1. Mark the span as dirty and coalesce it with any free neighbors.
+ *
+ *  2. Return the span to the kernel if too many free pages are cached,
+ *  otherwise insert the span into the free span list.
+ *
+ * @param   span    Pointer to span to release.
+ **/
+void    span_release(Span *span) {
+    span->zero = false;
+    span = span_coalesce(span);
+
+    if (FreePages + span->pages > SPAN_CACHE_PAGES) {
+        span_unmap(span);
+        munmap(SPAN_DATA(span), SPAN_CAPACITY(span));
+        COUNTER_SUB(PAGE_HEAP, SPAN_CAPACITY(span));
+        COUNTER_INC(SHRINKS);
+        span_recycle(span);
+        return;
+    }
+
+    span_link(span);
+}
+
+/**
+ * Lookup the in-use span whose data starts at the specified pointer.
+ *
+ * @param   ptr     Pointer to classify.
+ * @return  Pointer to owning span (NULL if pointer is not a span).
+ **/
+Span *  span_lookup(void *ptr) {
+    if ((uintptr_t)ptr & (PAGE_SIZE - 1)) {
+        return NULL;
+    }
+
+    Span *span = pagemap_get(PAGE_NUMBER(ptr));
+    if (!span || span->free || span->kind != SPAN_LARGE || span->start != PAGE_NUMBER(ptr)) {
+        return NULL;
+    }
+
+    return span;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
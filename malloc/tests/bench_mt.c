@@ -0,0 +1,170 @@
+/* bench_mt.c: multithreaded allocator scalability workloads
+ *
+ * Usage: bench_mt WORKLOAD THREADS
+ *
+ * Runs a fixed amount of work per thread (so ideal scaling keeps ops/sec
+ * proportional to the number of threads) and prints a single line:
+ *
+ *  result WORKLOAD THREADS OPS SECONDS MAXRSS_KB
+ **/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/* Constants */
+
+#define THREADTEST_ROUNDS   (1<<6)      /* Rounds of allocating and freeing a batch */
+#define THREADTEST_BATCH    (1<<10)     /* Objects allocated per round */
+#define THRASH_OBJECTS      (1<<15)     /* Objects allocated, written, and freed */
+#define THRASH_WRITES       (1<<5)      /* Writes to each object */
+#define LARSON_SLOTS        (1<<10)     /* Slots owned by each thread per round */
+#define LARSON_ROUNDS       (1<<4)      /* Rounds (slots move to the next thread each round) */
+#define LARSON_REPLACES     (1<<12)     /* Replacements per round */
+#define MAX_THREADS         (1<<8)
+
+/* Workload Structure */
+
+typedef struct Workload Workload;
+struct Workload {
+    const char *name;
+    void *      (*run)(void *arg);
+};
+
+/* Global Variables */
+
+static size_t               Threads = 1;
+static char *               Scratch[MAX_THREADS];   /* Objects handed to each thread by cache-scratch */
+static char **              Slots = NULL;           /* Slots shared by larson threads */
+static pthread_barrier_t    Barrier;
+
+/* Internal Functions */
+
+static uint32_t next_random(uint32_t *state) {
+    *state = *state * 1103515245 + 12345;
+    return *state >> 8;
+}
+
+/* Workloads */
+
+/* threadtest: each thread allocates and frees batches of small objects */
+void *threadtest(void *arg) {
+    char **objects = malloc(THREADTEST_BATCH * sizeof(char *));
+
+    for (size_t round = 0; round < THREADTEST_ROUNDS; round++) {
+        for (size_t i = 0; i < THREADTEST_BATCH; i++) {
+            objects[i] = malloc(8 + (i % 8) * 8);
+            objects[i][0] = i;
+        }
+        for (size_t i = 0; i < THREADTEST_BATCH; i++) {
+            free(objects[i]);
+        }
+    }
+
+    free(objects);
+    return (void *)(uintptr_t)(THREADTEST_ROUNDS * THREADTEST_BATCH);
+}
+
+/* cache-thrash: each thread repeatedly writes to its own small object */
+void *cache_thrash(void *arg) {
+    for (size_t i = 0; i < THRASH_OBJECTS; i++) {
+        volatile char *object = malloc(8);
+        for (size_t w = 0; w < THRASH_WRITES; w++) {
+            object[w % 8]++;
+        }
+        free((void *)object);
+    }
+
+    return (void *)(uintptr_t)THRASH_OBJECTS;
+}
+
+/* cache-scratch: like cache-thrash, but first frees an object allocated by
+ * the main thread next to the objects of the other threads */
+void *cache_scratch(void *arg) {
+    free(Scratch[(uintptr_t)arg]);
+    return (void *)(uintptr_t)((uintptr_t)cache_thrash(arg) + 1);
+}
+
+/* larson: threads replace random objects in their slots, which are handed
+ * to the next thread every round (so most frees are of remote objects) */
+void *larson(void *arg) {
+    uintptr_t id    = (uintptr_t)arg;
+    uint32_t  state = id + 1;
+
+    for (size_t round = 0; round < LARSON_ROUNDS; round++) {
+        char **slots = Slots + ((id + round) % Threads) * LARSON_SLOTS;
+        for (size_t i = 0; i < LARSON_REPLACES; i++) {
+            size_t slot = next_random(&state) % LARSON_SLOTS;
+            free(slots[slot]);
+            slots[slot]    = malloc(16 + next_random(&state) % 512);
+            slots[slot][0] = i;
+        }
+        pthread_barrier_wait(&Barrier);
+    }
+
+    return (void *)(uintptr_t)(LARSON_ROUNDS * LARSON_REPLACES);
+}
+
+static Workload Workloads[] = {
+    {"threadtest",      threadtest},
+    {"cache-thrash",    cache_thrash},
+    {"cache-scratch",   cache_scratch},
+    {"larson",          larson},
+    {NULL,              NULL},
+};
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s WORKLOAD THREADS\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Workload *workload = Workloads;
+    while (workload->name && strcmp(workload->name, argv[1])) {
+        workload++;
+    }
+
+    Threads = strtoul(argv[2], NULL, 10);
+    if (!workload->name || !Threads || Threads > MAX_THREADS) {
+        fprintf(stderr, "Unknown WORKLOAD or invalid THREADS\n");
+        return EXIT_FAILURE;
+    }
+
+    // Set up shared state before the clock starts
+    for (size_t t = 0; t < Threads; t++) {
+        Scratch[t] = malloc(8);
+    }
+    Slots = calloc(Threads * LARSON_SLOTS, sizeof(char *));
+    pthread_barrier_init(&Barrier, NULL, Threads);
+
+    struct timespec start, stop;
+    pthread_t       threads[MAX_THREADS];
+    size_t          ops = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uintptr_t t = 0; t < Threads; t++) {
+        pthread_create(&threads[t], NULL, workload->run, (void *)t);
+    }
+    for (size_t t = 0; t < Threads; t++) {
+        void *result;
+        pthread_join(threads[t], &result);
+        ops += (uintptr_t)result;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    double seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+    printf("result %s %lu %lu %.6f %ld\n", workload->name, Threads, ops, seconds, usage.ru_maxrss);
+    fflush(stdout);
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -30,6 +30,8 @@ int main(int argc, char *argv[]) {
     	assert(pc == p2);
     } else if (strstr(argv[1], "wf")) {
     	assert(pc == p1);
+    } else if (strstr(argv[1], "nf")) {
+    	assert(pc == p0);
     }
 
     free(pa);
@@ -0,0 +1,81 @@
+/* test_07.c: aligned, sized, and C++ allocation entry points */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Constants */
+
+#define N    4
+
+/* Entry points not declared by older C libraries */
+
+typedef void  (*FreeSized)(void *, size_t);
+typedef void  (*FreeAlignedSized)(void *, size_t, size_t);
+typedef void *(*New)(size_t);
+typedef void *(*NewAligned)(size_t, size_t);
+typedef void  (*DeleteSized)(void *, size_t);
+typedef void  (*DeleteAlignedSized)(void *, size_t, size_t);
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    FreeSized          free_sized         = (FreeSized)dlsym(RTLD_DEFAULT, "free_sized");
+    FreeAlignedSized   free_aligned_sized = (FreeAlignedSized)dlsym(RTLD_DEFAULT, "free_aligned_sized");
+    New                new                = (New)dlsym(RTLD_DEFAULT, "_Znwm");
+    NewAligned         new_aligned        = (NewAligned)dlsym(RTLD_DEFAULT, "_ZnwmSt11align_val_t");
+    DeleteSized        delete_sized       = (DeleteSized)dlsym(RTLD_DEFAULT, "_ZdlPvm");
+    DeleteAlignedSized delete_aligned     = (DeleteAlignedSized)dlsym(RTLD_DEFAULT, "_ZdlPvmSt11align_val_t");
+
+    assert(free_sized && free_aligned_sized);
+    assert(new && new_aligned && delete_sized && delete_aligned);
+
+    for (int i = 0; i < N; i++) {
+        size_t alignment = 64 << i;
+        size_t size      = 100 * (i + 1);
+
+        fprintf(stderr, "p = aligned_alloc(%lu, %lu)\n", alignment, size);
+        char *p = aligned_alloc(alignment, size);
+        assert(p && ((uintptr_t)p % alignment) == 0);
+
+        fprintf(stderr, "q = malloc(%lu)\n", size);
+        char *q = malloc(size);
+        assert(q);
+
+        fprintf(stderr, "free_aligned_sized(%p, %lu, %lu)\n", p, alignment, size);
+        free_aligned_sized(p, alignment, size);
+
+        fprintf(stderr, "free_sized(%p, %lu)\n", q, size);
+        free_sized(q, size);
+    }
+
+    void *r = NULL;
+    assert(posix_memalign(&r, 0, 10) == EINVAL);
+    assert(posix_memalign(&r, 0, 0) == EINVAL);
+    assert(r == NULL);
+
+    errno = 0;
+    assert(posix_memalign(&r, 4096, 10) == 0);
+    assert(errno == 0);
+    assert(((uintptr_t)r % 4096) == 0);
+    free(r);
+
+    fprintf(stderr, "s = new(24)\n");
+    void *s = new(24);
+    assert(s);
+
+    fprintf(stderr, "t = new(256, align_val_t(128))\n");
+    void *t = new_aligned(256, 128);
+    assert(t && ((uintptr_t)t % 128) == 0);
+
+    delete_aligned(t, 256, 128);
+    delete_sized(s, 24);
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
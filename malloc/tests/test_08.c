@@ -0,0 +1,52 @@
+/* test_08.c: chase pointers through lots of small nodes */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Constants */
+
+#define N       (1<<20)
+#define STEPS   (1<<22)
+
+/* Structures */
+
+typedef struct Node Node;
+struct Node {
+    Node *  next;
+    size_t  value;
+};
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    Node **nodes = malloc(sizeof(Node *) * N);
+    for (int i = 0; i < N; i++) {
+        nodes[i] = malloc(sizeof(Node));
+        nodes[i]->value = i;
+    }
+
+    // Link nodes in a random order so each step lands on a different page
+    srand(0);
+    for (int i = N - 1; i > 0; i--) {
+        int   j    = rand() % (i + 1);
+        Node *swap = nodes[i];
+        nodes[i]   = nodes[j];
+        nodes[j]   = swap;
+    }
+
+    for (int i = 0; i < N; i++) {
+        nodes[i]->next = nodes[(i + 1) % N];
+    }
+
+    Node * curr = nodes[0];
+    size_t sum  = 0;
+    for (int i = 0; i < STEPS; i++) {
+        sum += curr->value;
+        curr = curr->next;
+    }
+
+    fprintf(stderr, "sum = %lu\n", sum);
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,40 @@
+/* test_09.c: fragment the heap with interleaved sizes */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Constants */
+
+#define N    (1<<8)
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    char *p[N];
+
+    for (int i = 0; i < N; i++) {
+        size_t s = 16 << (i % 6);
+        fprintf(stderr, "p[%d] = malloc(%lu)\n", i, s);
+        p[i] = malloc(s);
+    }
+
+    for (int i = 0; i < N; i += 3) {
+        fprintf(stderr, "free(%p)\n", p[i]);
+        free(p[i]);
+    }
+
+    for (int i = 0; i < N; i += 3) {
+        size_t s = 24 << (i % 4);
+        fprintf(stderr, "p[%d] = malloc(%lu)\n", i, s);
+        p[i] = malloc(s);
+    }
+
+    for (int i = 1; i < N; i += 4) {
+        fprintf(stderr, "free(%p)\n", p[i]);
+        free(p[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
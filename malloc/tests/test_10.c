@@ -0,0 +1,37 @@
+/* test_10.c: interleave short-lived temporaries with long-lived objects */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Constants */
+
+#define N       (1<<12)     /* Number of long-lived objects */
+#define TEMPS   (1<<6)      /* Number of temporaries alive at once */
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    char *objects[N];
+    char *temps[TEMPS] = {NULL};
+
+    for (int i = 0; i < N; i++) {
+        for (int t = 0; t < 4; t++) {
+            int slot = (i * 4 + t) % TEMPS;
+            free(temps[slot]);
+            temps[slot] = malloc(32 + 32 * ((i * 7 + t * 5) % 16));
+            memset(temps[slot], t, 32);
+        }
+
+        objects[i] = malloc(48 + 16 * (i % 3));
+        memset(objects[i], i, 48);
+    }
+
+    for (int t = 0; t < TEMPS; t++) {
+        free(temps[t]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,69 @@
+/* test_11.c: producer thread allocates objects that a consumer thread frees */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Constants */
+
+#define N       (1<<18)     /* Number of objects passed between threads */
+#define QUEUE   (1<<10)     /* Capacity of single producer, single consumer queue */
+
+/* Global Variables */
+
+static void *   Queue[QUEUE];
+static size_t   Head = 0;   /* Next slot to consume */
+static size_t   Tail = 0;   /* Next slot to produce */
+static size_t   Size = 64;  /* Size of each object */
+
+/* Threads */
+
+void *producer(void *arg) {
+    for (size_t i = 0; i < N; i++) {
+        char *object = malloc(Size);
+        memset(object, i, Size);
+
+        while (i - __atomic_load_n(&Head, __ATOMIC_ACQUIRE) >= QUEUE) {
+            sched_yield();
+        }
+
+        Queue[i % QUEUE] = object;
+        __atomic_store_n(&Tail, i + 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+void *consumer(void *arg) {
+    for (size_t i = 0; i < N; i++) {
+        while (__atomic_load_n(&Tail, __ATOMIC_ACQUIRE) == i) {
+            sched_yield();
+        }
+
+        free(Queue[i % QUEUE]);
+        __atomic_store_n(&Head, i + 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    pthread_t threads[2];
+
+    if (argc == 2) {
+        Size = strtoul(argv[1], NULL, 10);
+    }
+
+    pthread_create(&threads[0], NULL, producer, NULL);
+    pthread_create(&threads[1], NULL, consumer, NULL);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,36 @@
+/* test_12.c: calloc large buffers and only touch a few of their pages */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Constants */
+
+#define ROUNDS  (1<<6)      /* Number of buffers allocated */
+#define STRIDE  (1<<16)     /* Distance between touched bytes */
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    size_t size = argc == 2 ? strtoul(argv[1], NULL, 10) : 1<<24;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        char *buffer = calloc(size, 1);
+        if (!buffer) {
+            return EXIT_FAILURE;
+        }
+
+        for (size_t i = round % STRIDE; i < size; i += STRIDE) {
+            if (buffer[i]) {
+                fprintf(stderr, "buffer[%lu] = %d\n", i, buffer[i]);
+                return EXIT_FAILURE;
+            }
+            buffer[i] = 1;
+        }
+
+        free(buffer);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,46 @@
+/* test_13.c: C++ temporaries and long-lived C++ objects from separate sites */
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Constants */
+
+#define N       (1<<12)     /* Number of long-lived objects */
+
+/* Entry points not declared by C libraries */
+
+typedef void *(*New)(size_t);
+typedef void  (*Delete)(void *);
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    New     new     = (New)dlsym(RTLD_DEFAULT, "_Znwm");
+    Delete  delete  = (Delete)dlsym(RTLD_DEFAULT, "_ZdlPv");
+    char *  objects[N];
+
+    if (!new || !delete) {
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < N; i++) {
+        for (int t = 0; t < 2; t++) {
+            char *temp = new(64);       /* Short-lived site */
+            memset(temp, t, 64);
+            delete(temp);
+        }
+
+        objects[i] = new(64);           /* Long-lived site */
+        memset(objects[i], i, 64);
+    }
+
+    for (int i = 0; i < N; i++) {
+        delete(objects[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -0,0 +1,73 @@
+/* test_14.c: consumer thread frees spans or small objects from a producer */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Constants */
+
+#define QUEUE   (1<<3)      /* Capacity of single producer, single consumer queue */
+#define TOUCH   (1<<6)      /* Number of bytes written to each object */
+
+/* Global Variables */
+
+static void *   Queue[QUEUE];
+static size_t   Head  = 0;      /* Next slot to consume */
+static size_t   Tail  = 0;      /* Next slot to produce */
+static size_t   Size  = 1<<18;  /* Size of each object */
+static size_t   Count = 1<<12;  /* Number of objects passed between threads */
+
+/* Threads */
+
+void *producer(void *arg) {
+    for (size_t i = 0; i < Count; i++) {
+        char *object = malloc(Size);
+        memset(object, i, Size < TOUCH ? Size : TOUCH);
+
+        while (i - __atomic_load_n(&Head, __ATOMIC_ACQUIRE) >= QUEUE) {
+            sched_yield();
+        }
+
+        Queue[i % QUEUE] = object;
+        __atomic_store_n(&Tail, i + 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+void *consumer(void *arg) {
+    for (size_t i = 0; i < Count; i++) {
+        while (__atomic_load_n(&Tail, __ATOMIC_ACQUIRE) == i) {
+            sched_yield();
+        }
+
+        free(Queue[i % QUEUE]);
+        __atomic_store_n(&Head, i + 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    pthread_t threads[2];
+
+    if (argc >= 2) {
+        Size = strtoul(argv[1], NULL, 10);
+    }
+    if (argc >= 3) {
+        Count = strtoul(argv[2], NULL, 10);
+    }
+
+    pthread_create(&threads[0], NULL, producer, NULL);
+    pthread_create(&threads[1], NULL, consumer, NULL);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
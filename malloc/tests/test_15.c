@@ -0,0 +1,62 @@
+/* test_15.c: threads allocate from TLS destructors after retiring their counters */
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Constants */
+
+#define THREADS (1<<3)      /* Number of threads run one after another */
+#define SIZE    (1<<6)      /* Size of each object */
+
+/* Global Variables */
+
+static pthread_key_t Key;
+
+/* Functions */
+
+void destructor(void *arg) {
+    size_t pass = (size_t)arg;
+    char *object = malloc(SIZE);
+    memset(object, pass, SIZE);
+    free(object);
+
+    // re-arm the key so the last destructor pass also allocates
+    if (pass < PTHREAD_DESTRUCTOR_ITERATIONS) {
+        pthread_setspecific(Key, (void *)(pass + 1));
+    }
+}
+
+/* Threads */
+
+void *worker(void *arg) {
+    free(malloc(SIZE));
+    pthread_setspecific(Key, (void *)1);
+    return NULL;
+}
+
+/* Main Execution */
+
+int main(int argc, char *argv[]) {
+    pthread_t thread;
+
+    // count before creating the key, so its destructor runs after retirement
+    free(malloc(SIZE));
+    if (pthread_key_create(&Key, destructor) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    // a new thread may reuse the stack (and TLS) of the one before it
+    for (int i = 0; i < THREADS; i++) {
+        if (pthread_create(&thread, NULL, worker, NULL) != 0 ||
+            pthread_join(thread, NULL) != 0) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */
@@ -13,6 +13,7 @@ extern Block FreeList;
 extern Block *free_list_search_ff(size_t size);
 extern Block *free_list_search_bf(size_t size);
 extern Block *free_list_search_wf(size_t size);
+extern Block *free_list_search_nf(size_t size);
 
 /* Functions */
 
@@ -95,6 +96,58 @@ int test_04_free_list_length() {
     return EXIT_SUCCESS;
 }
 
+int test_05_free_list_search_nf() {
+    Block b2 = {.capacity = ALIGN(200), .size = 200, .prev = NULL     , .next = &FreeList };
+    Block b1 = {.capacity = ALIGN(300), .size = 300, .prev = NULL     , .next = &b2 };
+    Block b0 = {.capacity = ALIGN(100), .size = 100, .prev = &FreeList, .next = &b1 };
+    b1.prev = &b0; b2.prev = &b1;
+    FreeList.next = &b0; FreeList.prev = &b2;
+    Rover = &FreeList;
+
+    assert(free_list_search_nf(1000) == NULL);
+    assert(Rover == &FreeList);
+    assert(free_list_search_nf(100)  == &b0);
+    assert(free_list_search_nf(200)  == &b1);
+    assert(free_list_search_nf(100)  == &b1);
+    assert(Counters[SEARCHED] == 3 + 1 + 2 + 1);
+
+    Rover = &b2;
+    assert(free_list_search_nf(300)  == &b1);
+    assert(Rover == &b1);
+
+    assert(block_detach(&b1) == &b1);
+    assert(Rover == &b2);
+    assert(free_list_search_nf(100)  == &b2);
+    return EXIT_SUCCESS;
+}
+
+int test_06_free_list_costs() {
+    Block b2 = {.capacity = ALIGN(200), .size = 200, .prev = NULL     , .next = &FreeList };
+    Block b1 = {.capacity = ALIGN(300), .size = 300, .prev = NULL     , .next = &b2 };
+    Block b0 = {.capacity = ALIGN(100), .size = 100, .prev = &FreeList, .next = &b1 };
+    b1.prev = &b0; b2.prev = &b1;
+    FreeList.next = &b0; FreeList.prev = &b2;
+
+    assert(free_list_search_ff(100)  == &b0);
+    assert(free_list_search_ff(300)  == &b1);
+    assert(free_list_search_bf(1000) == NULL);
+    assert(SearchCost.calls == 3);
+    assert(SearchCost.total == 1 + 2 + 3);
+    assert(SearchCost.max   == 3);
+    assert(histogram_mean(&SearchCost) == 2.0);
+    assert(histogram_percentile(&SearchCost, 50) == 2);
+    assert(histogram_percentile(&SearchCost, 99) == 3);
+
+    Histogram h = {0};
+    for (size_t value = 0; value < 1000; value++) {
+        histogram_record(&h, value);
+    }
+    assert(histogram_percentile(&h, 5)  == 49);
+    assert(histogram_percentile(&h, 99) == 999);
+    assert(histogram_percentile(&h, 50) == 511);
+    return EXIT_SUCCESS;
+}
+
 /* Main execution */
 
 int main(int argc, char *argv[]) {
@@ -106,6 +159,8 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "    2. Test free_list_search_wf\n");
         fprintf(stderr, "    3. Test free_list_insert\n");
         fprintf(stderr, "    4. Test free_list_length\n");
+        fprintf(stderr, "    5. Test free_list_search_nf\n");
+        fprintf(stderr, "    6. Test free_list_costs\n");
         return EXIT_FAILURE;
     }
 
@@ -118,6 +173,8 @@ int main(int argc, char *argv[]) {
         case 2:  status = test_02_free_list_search_wf(); break;
         case 3:  status = test_03_free_list_insert(); break;
         case 4:  status = test_04_free_list_length(); break;
+        case 5:  status = test_05_free_list_search_nf(); break;
+        case 6:  status = test_06_free_list_costs(); break;
         default: fprintf(stderr, "Unknown NUMBER: %d\n", number); break;
     }
 
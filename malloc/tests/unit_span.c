@@ -0,0 +1,124 @@
+/* unit_span.c: Unit tests for page map and span page heap */
+
+#include "malloc/block.h"
+#include "malloc/counters.h"
+#include "malloc/heap.h"
+#include "malloc/span.h"
+
+#include <assert.h>
+#include <limits.h>
+
+/* Externals */
+
+extern Span   FreeSpans;
+extern size_t FreePages;
+
+/* Functions */
+
+int test_00_pagemap() {
+    uintptr_t page = PAGE_NUMBER(&FreeSpans);
+
+    assert(pagemap_get(page) == NULL);
+    assert(pagemap_reserve(page, 2));
+    pagemap_set(page, &FreeSpans);
+    assert(pagemap_get(page)     == &FreeSpans);
+    assert(pagemap_get(page + 1) == NULL);
+    pagemap_set(page, NULL);
+    assert(pagemap_get(page)     == NULL);
+
+    assert(pagemap_get(UINTPTR_MAX >> PAGE_SHIFT) == NULL);
+    return EXIT_SUCCESS;
+}
+
+int test_01_span_allocate() {
+    size_t s0 = SPAN_THRESHOLD + 1;
+    Span * p0 = span_allocate(s0, 0);
+
+    assert(p0);
+    assert(p0->size  == s0);
+    assert(p0->pages == PAGE_ALIGN(s0, PAGE_SIZE) / PAGE_SIZE);
+    assert(p0->free  == false);
+    assert(Counters[PAGE_HEAP] == SPAN_GROW_PAGES * PAGE_SIZE);
+    assert(Counters[GROWS]     == 1);
+    assert(FreePages == SPAN_GROW_PAGES - p0->pages);
+
+    size_t s1 = SPAN_THRESHOLD;
+    Span * p1 = span_allocate(s1, 1<<20);
+    assert(p1);
+    assert(((uintptr_t)SPAN_DATA(p1) & ((1<<20) - 1)) == 0);
+    assert(p1->pages == s1 / PAGE_SIZE);
+
+    assert(span_allocate(LONG_MAX, 0) == NULL);
+    return EXIT_SUCCESS;
+}
+
+int test_02_span_release() {
+    Span *p0 = span_allocate(SPAN_THRESHOLD, 0);
+    Span *p1 = span_allocate(SPAN_THRESHOLD, 0);
+    Span *p2 = span_allocate(SPAN_THRESHOLD, 0);
+    assert(p0 && p1 && p2);
+    assert(Counters[GROWS] == 1);
+    assert(p1->start == p0->start + p0->pages);
+    assert(p2->start == p1->start + p1->pages);
+
+    span_release(p0);
+    assert(FreePages == SPAN_GROW_PAGES - 2 * (SPAN_THRESHOLD / PAGE_SIZE));
+    assert(Counters[MERGES] == 0);
+
+    span_release(p2);
+    assert(Counters[MERGES] == 1);
+
+    span_release(p1);
+    assert(Counters[MERGES] == 3);
+    assert(FreePages == SPAN_GROW_PAGES);
+    assert(FreeSpans.next == FreeSpans.prev);
+    assert(FreeSpans.next->pages == SPAN_GROW_PAGES);
+    return EXIT_SUCCESS;
+}
+
+int test_03_span_lookup() {
+    Span *p0 = span_allocate(SPAN_THRESHOLD, 0);
+    assert(p0);
+
+    char *data = SPAN_DATA(p0);
+    assert(span_lookup(data) == p0);
+    assert(span_lookup(data + 1) == NULL);
+    assert(span_lookup(data + PAGE_SIZE) == NULL);
+
+    Block *b0 = block_allocate(100);
+    assert(b0);
+    assert(span_lookup(b0->data) == NULL);
+
+    span_release(p0);
+    assert(span_lookup(data) == NULL);
+    return EXIT_SUCCESS;
+}
+
+/* Main execution */
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s NUMBER\n\n", argv[0]);
+        fprintf(stderr, "Where NUMBER is right of the following:\n");
+        fprintf(stderr, "    0. Test pagemap\n");
+        fprintf(stderr, "    1. Test span_allocate\n");
+        fprintf(stderr, "    2. Test span_release\n");
+        fprintf(stderr, "    3. Test span_lookup\n");
+        return EXIT_FAILURE;
+    }
+
+    int number = atoi(argv[1]);
+    int status = EXIT_FAILURE;
+
+    switch (number) {
+        case 0:  status = test_00_pagemap(); break;
+        case 1:  status = test_01_span_allocate(); break;
+        case 2:  status = test_02_span_release(); break;
+        case 3:  status = test_03_span_lookup(); break;
+        default: fprintf(stderr, "Unknown NUMBER: %d\n", number); break;
+    }
+
+    return status;
+}
+
+/* vim: set expandtab sts=4 sw=4 ts=8 ft=c: */